@@ -0,0 +1,113 @@
+/*
+* Copyright 2016-2017 Morgan Stanley
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef BENCHMARK_BENCHMARK_HPP_
+#define BENCHMARK_BENCHMARK_HPP_
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include "gtest/gtest.h"
+
+namespace winss {
+/**
+ * Gets the number of heap allocations made by the benchmark process.
+ *
+ * \return The number of calls to operator new.
+ */
+size_t AllocationCount();
+
+/**
+ * A test fixture for timing a block of code and reporting its rate.
+ *
+ * The results are written to the console and recorded as test properties
+ * so that they are kept when running with --gtest_output=xml.
+ */
+class Benchmark : public testing::Test {
+ protected:
+    /**
+     * Times the given function.
+     *
+     * \param func The function to time.
+     * \return The elapsed time in seconds.
+     */
+    template<typename Func>
+    double Time(Func func) {
+        auto start = std::chrono::steady_clock::now();
+        func();
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        return elapsed.count();
+    }
+
+    /**
+     * Counts the heap allocations made by the given function.
+     *
+     * \param func The function to count allocations of.
+     * \return The number of allocations.
+     */
+    template<typename Func>
+    size_t CountAllocations(Func func) {
+        size_t start = winss::AllocationCount();
+        func();
+        return winss::AllocationCount() - start;
+    }
+
+    /**
+     * Reports a rate for the given operation count.
+     *
+     * \param name The name of what was counted.
+     * \param count The number of operations.
+     * \param seconds The elapsed time in seconds.
+     */
+    void Report(const std::string& name, size_t count, double seconds) {
+        double rate = seconds > 0 ? count / seconds : 0;
+
+        std::cout
+            << "[ BENCH    ] "
+            << name
+            << ": "
+            << count
+            << " in "
+            << seconds * 1000
+            << " ms ("
+            << rate
+            << "/s)"
+            << std::endl;
+
+        RecordProperty(name + "_per_sec", static_cast<int>(rate));
+    }
+
+    /**
+     * Reports a single measured value.
+     *
+     * \param name The name of the value.
+     * \param value The value.
+     */
+    void ReportValue(const std::string& name, double value) {
+        std::cout
+            << "[ BENCH    ] "
+            << name
+            << ": "
+            << value
+            << std::endl;
+
+        RecordProperty(name, static_cast<int>(value));
+    }
+};
+}  // namespace winss
+
+#endif  // BENCHMARK_BENCHMARK_HPP_
@@ -0,0 +1,472 @@
+/*
+* Copyright 2016-2017 Morgan Stanley
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include "winss/winss.hpp"
+#include "winss/event_wrapper.hpp"
+#include "winss/not_owning_ptr.hpp"
+#include "winss/utils.hpp"
+#include "winss/log/log.hpp"
+#include "winss/log/log_settings.hpp"
+#include "winss/log/log_stream_wrapper.hpp"
+#include "winss/log/log_timestamp.hpp"
+#include "../test/mock_interface.hpp"
+#include "../test/mock_windows_interface.hpp"
+#include "../test/mock_path_mutex.hpp"
+#include "benchmark.hpp"
+
+namespace fs = std::experimental::filesystem;
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::Return;
+
+namespace winss {
+static const size_t kLines = 200000;
+static const size_t kLineLength = 100;
+static const size_t kTimestampLines = 1000000;
+static const size_t kSamples = 4096;
+
+/**
+ * A log reader which cycles through synthetic lines of the given lengths
+ * until exhausted.
+ *
+ * The time between reads is recorded as the write latency of the previous
+ * line since the log writes each line before reading the next.
+ */
+class SyntheticLogStreamReader : public winss::LogStreamReader {
+ private:
+    std::string line;
+    std::vector<size_t> lengths;
+    size_t remaining;
+    size_t next = 0;
+    std::chrono::steady_clock::time_point last;
+    std::vector<std::chrono::nanoseconds::rep> latencies;
+
+ public:
+    SyntheticLogStreamReader(const std::vector<size_t>& lengths,
+        size_t count) : line(*std::max_element(lengths.begin(),
+        lengths.end()), 'x'), lengths(lengths), remaining(count) {
+        latencies.reserve(count);
+    }
+
+    bool IsEOF() const override {
+        return remaining == 0;
+    }
+
+    winss::LogLine GetLine() override {
+        auto now = std::chrono::steady_clock::now();
+        if (next > 0) {
+            latencies.push_back(std::chrono::duration_cast<
+                std::chrono::nanoseconds>(now - last).count());
+        }
+
+        last = now;
+        --remaining;
+        size_t length = lengths[next++ % lengths.size()];
+        return winss::LogLine{ line.data(), length };
+    }
+
+    /**
+     * Gets the bytes of the lines read including line endings.
+     *
+     * \return The number of bytes.
+     */
+    size_t Bytes() const {
+        size_t bytes = 0;
+        for (size_t i = 0; i < next; ++i) {
+            bytes += lengths[i % lengths.size()] + 1;
+        }
+
+        return bytes;
+    }
+
+    /**
+     * Gets the given percentile of the write latencies.
+     *
+     * \param percentile The percentile between 0 and 1.
+     * \return The latency in nanoseconds.
+     */
+    double Latency(double percentile) {
+        if (latencies.empty()) {
+            return 0;
+        }
+
+        size_t index = static_cast<size_t>(
+            percentile * (latencies.size() - 1));
+        std::nth_element(latencies.begin(), latencies.begin() + index,
+            latencies.end());
+        return static_cast<double>(latencies[index]);
+    }
+};
+
+/**
+ * A log writer which only counts the bytes so the log itself is measured
+ * without any file I/O.
+ */
+class NullLogStreamWriter : public winss::LogStreamWriter {
+ private:
+    std::streamoff pos = 0;
+
+ public:
+    NullLogStreamWriter() : winss::LogStreamWriter() {}
+
+    bool Open(fs::path log_path) override {
+        pos = 0;
+        return true;
+    }
+
+    void Write(const std::string& line) override {
+        pos += line.length();
+    }
+
+    void Write(const char* data, size_t length) override {
+        pos += length;
+    }
+
+    void WriteLine() override {
+        ++pos;
+    }
+
+    std::streamoff GetPos() override {
+        return pos;
+    }
+
+    void Flush() override {}
+
+    void Close() override {}
+};
+
+class BenchmarkLog : public LogTmpl<winss::MockPathMutex> {
+ public:
+    BenchmarkLog(winss::NotOwningPtr<winss::LogStreamReader> reader,
+        winss::NotOwningPtr<winss::LogStreamWriter> writer,
+        const winss::LogSettings& settings) :
+        winss::LogTmpl<winss::MockPathMutex>::LogTmpl(reader, writer,
+            settings) {}
+
+    winss::MockPathMutex* GetMutex() {
+        return &mutex;
+    }
+};
+
+class LogBenchmark : public winss::Benchmark {
+ protected:
+    fs::path log_dir;
+
+    void SetUp() override {
+        log_dir = fs::temp_directory_path() / "winss_log_benchmark";
+        fs::remove_all(log_dir);
+        fs::create_directories(log_dir);
+    }
+
+    void TearDown() override {
+        fs::remove_all(log_dir);
+    }
+
+    /**
+     * Gets the settings for a benchmark run.
+     *
+     * \param buffer_size The writer buffer size or 0 to flush every line.
+     * \return The log settings without rotation.
+     */
+    winss::LogSettings Settings(size_t buffer_size) const {
+        winss::LogSettings settings{};
+        settings.file_size = 16777215;
+        settings.buffer_size = static_cast<unsigned int>(buffer_size);
+        settings.log_dir = log_dir;
+        return settings;
+    }
+
+    /**
+     * Gets line lengths which are all the same.
+     *
+     * \param length The line length.
+     * \return The line lengths.
+     */
+    static std::vector<size_t> FixedLengths(size_t length = kLineLength) {
+        return std::vector<size_t>{ length };
+    }
+
+    /**
+     * Gets line lengths which are uniformly distributed.
+     *
+     * \param min The shortest line length.
+     * \param max The longest line length.
+     * \return The line lengths.
+     */
+    static std::vector<size_t> UniformLengths(size_t min, size_t max) {
+        std::mt19937 random(1);
+        std::uniform_int_distribution<size_t> distribution(min, max);
+        std::vector<size_t> lengths(kSamples);
+        for (size_t& length : lengths) {
+            length = distribution(random);
+        }
+
+        return lengths;
+    }
+
+    /**
+     * Gets line lengths which are mostly short with occasional long lines
+     * such as stack traces or serialized payloads.
+     *
+     * \param length The usual line length.
+     * \param long_length The long line length.
+     * \param every One in how many lines are long.
+     * \return The line lengths.
+     */
+    static std::vector<size_t> LongTailLengths(size_t length,
+        size_t long_length, size_t every) {
+        std::vector<size_t> lengths(every, length);
+        lengths.back() = long_length;
+        return lengths;
+    }
+
+    /**
+     * Logs synthetic lines and reports the lines and bytes per second, the
+     * allocations per line and the write latency.
+     *
+     * \param name The name of the run.
+     * \param settings The log settings.
+     * \param writer The log writer.
+     * \param lengths The line lengths to cycle through.
+     * \param lines The number of lines to log.
+     */
+    void Ingest(const std::string& name, const winss::LogSettings& settings,
+        winss::LogStreamWriter* writer, const std::vector<size_t>& lengths,
+        size_t lines) {
+        winss::SyntheticLogStreamReader reader(lengths, lines);
+
+        winss::BenchmarkLog log(winss::NotOwned(&reader),
+            winss::NotOwned(writer), settings);
+        EXPECT_CALL(*log.GetMutex(), Lock()).WillOnce(Return(true));
+
+        int result = 0;
+        size_t allocations = 0;
+        double seconds = Time([&]() {
+            allocations = CountAllocations([&]() {
+                result = log.Start();
+            });
+        });
+
+        EXPECT_EQ(0, result);
+
+        double bytes = static_cast<double>(reader.Bytes());
+        Report(name, lines, seconds);
+        ReportValue(name + "_mb_per_sec",
+            seconds > 0 ? bytes / (1024 * 1024) / seconds : 0);
+        ReportValue(name + "_ns_per_line", seconds * 1e9 / lines);
+        ReportValue(name + "_allocs_per_1k_lines",
+            allocations * 1000.0 / lines);
+        ReportValue(name + "_p99_write_ns", reader.Latency(0.99));
+    }
+
+    /**
+     * Logs synthetic lines to a real log directory.
+     *
+     * \param name The name of the run.
+     * \param settings The log settings.
+     * \param lines The number of lines to log.
+     * \param lengths The line lengths to cycle through.
+     */
+    void Ingest(const std::string& name, const winss::LogSettings& settings,
+        size_t lines = kLines,
+        const std::vector<size_t>& lengths = FixedLengths()) {
+        winss::EventWrapper close_event;
+        winss::LogStreamWriter writer(settings.buffer_size,
+            settings.flush_interval, close_event);
+        Ingest(name, settings, &writer, lengths, lines);
+    }
+
+    /**
+     * Logs synthetic lines without any file I/O.
+     *
+     * \param name The name of the run.
+     * \param settings The log settings.
+     * \param lengths The line lengths to cycle through.
+     */
+    void IngestNull(const std::string& name,
+        const winss::LogSettings& settings,
+        const std::vector<size_t>& lengths = FixedLengths()) {
+        winss::NullLogStreamWriter writer;
+        Ingest(name, settings, &writer, lengths, kTimestampLines);
+    }
+};
+
+TEST_F(LogBenchmark, ReadLines) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    windows->SetupDefaults();
+
+    HANDLE input = reinterpret_cast<HANDLE>(10000);
+    std::string line(kLineLength, 'x');
+    line += "\r\n";
+    size_t total = kLines * line.length();
+    size_t offset = 0;
+
+    EXPECT_CALL(*windows, GetStdHandle(STD_INPUT_HANDLE))
+        .WillOnce(Return(input));
+    EXPECT_CALL(*windows, ReadFile(input, _, _, _, nullptr))
+        .WillRepeatedly(Invoke([&](HANDLE, LPVOID buffer, DWORD to_read,
+            LPDWORD read, LPOVERLAPPED) {
+        if (offset == total) {
+            return false;
+        }
+
+        char* out = static_cast<char*>(buffer);
+        size_t length = std::min<size_t>(to_read, total - offset);
+        for (size_t i = 0; i < length; ++i) {
+            out[i] = line[(offset + i) % line.length()];
+        }
+
+        offset += length;
+        *read = static_cast<DWORD>(length);
+        return true;
+    }));
+
+    winss::LogStreamReader reader;
+    size_t lines = 0;
+    size_t allocations = 0;
+
+    double seconds = Time([&]() {
+        allocations = CountAllocations([&]() {
+            while (reader.GetLine().data != nullptr) {
+                ++lines;
+            }
+        });
+    });
+
+    EXPECT_EQ(kLines, lines);
+    Report("read_lines", lines, seconds);
+    ReportValue("read_lines_mb_per_sec",
+        seconds > 0 ? total / (1024.0 * 1024) / seconds : 0);
+    ReportValue("read_lines_allocs_per_1k_lines",
+        lines > 0 ? allocations * 1000.0 / lines : 0);
+}
+
+TEST_F(LogBenchmark, LineFlush) {
+    Ingest("line_flush", Settings(0));
+}
+
+TEST_F(LogBenchmark, Buffered4K) {
+    Ingest("buffered_4k", Settings(4096));
+}
+
+TEST_F(LogBenchmark, Buffered64K) {
+    Ingest("buffered_64k", Settings(65536));
+}
+TEST_F(LogBenchmark, Rotating) {
+    winss::LogSettings settings = Settings(65536);
+    settings.file_size = 65536;
+    settings.number = 5;
+    Ingest("rotating_64k", settings);
+
+    size_t files = static_cast<size_t>(std::distance(
+        fs::directory_iterator(log_dir), fs::directory_iterator()));
+    EXPECT_EQ(settings.number + 1, files);
+}
+
+TEST_F(LogBenchmark, NoTimestamp) {
+    Ingest("no_timestamp", Settings(65536), kTimestampLines);
+}
+
+TEST_F(LogBenchmark, Timestamp) {
+    winss::LogSettings settings = Settings(65536);
+    settings.timestamp = true;
+    Ingest("timestamp", settings, kTimestampLines);
+}
+
+TEST_F(LogBenchmark, FormatTimestamp) {
+    winss::LogTimestamp timestamp;
+    char buffer[winss::LogTimestamp::kLength];
+    auto now = std::chrono::system_clock::now();
+    size_t allocations = 0;
+
+    double seconds = Time([&]() {
+        allocations = CountAllocations([&]() {
+            for (size_t i = 0; i < kTimestampLines; ++i) {
+                timestamp.Format(now + std::chrono::microseconds(i), buffer);
+            }
+        });
+    });
+
+    Report("format_cached", kTimestampLines, seconds);
+    ReportValue("format_cached_allocs", static_cast<double>(allocations));
+
+    seconds = Time([&]() {
+        allocations = CountAllocations([&]() {
+            for (size_t i = 0; i < kTimestampLines; ++i) {
+                winss::Utils::ConvertToISOString(
+                    now + std::chrono::microseconds(i));
+            }
+        });
+    });
+
+    Report("format_iso_string", kTimestampLines, seconds);
+    ReportValue("format_iso_string_allocs",
+        static_cast<double>(allocations));
+}
+
+TEST_F(LogBenchmark, NullFixed) {
+    IngestNull("null_fixed", Settings(0));
+}
+
+TEST_F(LogBenchmark, NullUniform) {
+    IngestNull("null_uniform", Settings(0), UniformLengths(20, 400));
+}
+
+TEST_F(LogBenchmark, NullLongTail) {
+    IngestNull("null_long_tail", Settings(0),
+        LongTailLengths(80, 16384, 100));
+}
+
+TEST_F(LogBenchmark, NullTimestamp) {
+    winss::LogSettings settings = Settings(0);
+    settings.timestamp = true;
+    IngestNull("null_timestamp", settings);
+}
+
+TEST_F(LogBenchmark, NullJson) {
+    winss::LogSettings settings = Settings(0);
+    settings.json = true;
+    settings.service = "benchmark";
+    IngestNull("null_json", settings);
+}
+
+TEST_F(LogBenchmark, NullRotating) {
+    winss::LogSettings settings = Settings(0);
+    settings.file_size = 1048576;
+    IngestNull("null_rotating_1m", settings);
+}
+
+TEST_F(LogBenchmark, FileUniform) {
+    Ingest("file_uniform", Settings(65536), kLines,
+        UniformLengths(20, 400));
+}
+
+TEST_F(LogBenchmark, FileLongTail) {
+    Ingest("file_long_tail", Settings(65536), kLines,
+        LongTailLengths(80, 16384, 100));
+}
+}  // namespace winss
@@ -0,0 +1,345 @@
+/*
+* Copyright 2016-2017 Morgan Stanley
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include "winss/winss.hpp"
+#include "winss/not_owning_ptr.hpp"
+#include "winss/pipe_name.hpp"
+#include "winss/pipe_instance.hpp"
+#include "winss/pipe_server.hpp"
+#include "../test/mock_interface.hpp"
+#include "../test/mock_windows_interface.hpp"
+#include "../test/mock_pipe_name.hpp"
+#include "../test/mock_wait_multiplexer.hpp"
+#include "benchmark.hpp"
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::NiceMock;
+using ::testing::Return;
+
+namespace winss {
+static const size_t kRounds = 20;
+static const size_t kBroadcasts = 10;
+static const size_t kBurst = 50;
+static const size_t kStormClients = 500;
+
+/**
+ * An outbound pipe server with clients which are connected straight away.
+ */
+class BenchmarkOutboundPipeServer :
+    public winss::OutboundPipeServerTmpl<winss::OutboundPipeInstance> {
+ public:
+    explicit BenchmarkOutboundPipeServer(const PipeServerConfig& config) :
+        winss::OutboundPipeServerTmpl<winss::OutboundPipeInstance>
+        ::OutboundPipeServerTmpl(config) {}
+
+    /**
+     * Adds connected clients to the server.
+     *
+     * \param count The number of clients.
+     */
+    void AddClients(size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            winss::OutboundPipeInstance instance;
+            instance.CreateFile(pipe_name);
+            instance.SetConnected();
+            winss::HandleWrapper handle = instance.GetHandle();
+            instances.emplace(handle, std::move(instance));
+        }
+    }
+
+    /**
+     * Completes the writes of every client like the triggered handler.
+     *
+     * \return True if any client has more to write otherwise false.
+     */
+    bool Complete() {
+        bool more = false;
+        for (auto it = instances.begin(); it != instances.end(); ++it) {
+            if (it->second.FinishWrite()) {
+                it->second.Write();
+                more = true;
+            } else {
+                it->second.Read();
+            }
+        }
+
+        return more;
+    }
+};
+
+/**
+ * A pipe server where clients can connect and disconnect on demand.
+ */
+class BenchmarkPipeServer :
+    public winss::PipeServer<winss::OutboundPipeInstance> {
+ public:
+    explicit BenchmarkPipeServer(const PipeServerConfig& config) :
+        winss::PipeServer<winss::OutboundPipeInstance>::PipeServer(config) {}
+
+    /**
+     * Gets the handles of the instances which are waiting for clients.
+     *
+     * \return The handles of the waiting instances.
+     */
+    std::vector<winss::HandleWrapper> Waiting() const {
+        std::vector<winss::HandleWrapper> handles;
+        for (auto it = instances.begin(); it != instances.end(); ++it) {
+            if (!it->second.IsConnected()) {
+                handles.push_back(it->first);
+            }
+        }
+
+        return handles;
+    }
+
+    /**
+     * Connects a client to a waiting instance.
+     *
+     * \param handle The handle of the waiting instance.
+     */
+    void Connect(const winss::HandleWrapper& handle) {
+        Triggered(handle);
+    }
+
+    /**
+     * Disconnects every connected client.
+     */
+    void DisconnectAll() {
+        std::vector<winss::HandleWrapper> handles;
+        for (auto it = instances.begin(); it != instances.end(); ++it) {
+            if (it->second.IsConnected()) {
+                it->second.Closing();
+                handles.push_back(it->first);
+            }
+        }
+
+        for (const winss::HandleWrapper& handle : handles) {
+            Triggered(handle);
+        }
+    }
+};
+
+class PipeServerBenchmark : public winss::Benchmark {
+ protected:
+    /**
+     * Broadcasts small events to the given number of listeners and counts
+     * the allocations made by each broadcast.
+     *
+     * Each round starts a write to every listener and then broadcasts while
+     * those writes are in flight so only the queueing is measured.
+     *
+     * \param listeners The number of connected clients.
+     */
+    void Broadcast(size_t listeners) {
+        MockInterface<winss::MockWindowsInterface> windows;
+        windows->SetupDefaults();
+
+        HANDLE pipe = reinterpret_cast<HANDLE>(10000);
+
+        EXPECT_CALL(*windows, CreateFile(_, _, _, _, _, _, _))
+            .WillRepeatedly(Return(pipe));
+        EXPECT_CALL(*windows, WriteFile(pipe, _, _, _, _))
+            .WillRepeatedly(Return(true));
+        EXPECT_CALL(*windows, ReadFile(pipe, _, _, _, _))
+            .WillRepeatedly(Return(true));
+        ON_CALL(*windows, CloseHandle(pipe)).WillByDefault(Return(true));
+
+        NiceMock<winss::MockWaitMultiplexer> multiplexer;
+        winss::MockPipeName pipe_name("benchmark");
+        BenchmarkOutboundPipeServer server({
+            pipe_name, winss::NotOwned(&multiplexer)
+        });
+
+        server.AddClients(listeners);
+
+        std::vector<char> data = { 'u' };
+        size_t allocations = 0;
+        double seconds = 0;
+
+        for (size_t i = 0; i < kRounds; ++i) {
+            server.Send(data);
+
+            seconds += Time([&]() {
+                allocations += CountAllocations([&]() {
+                    for (size_t j = 0; j < kBroadcasts; ++j) {
+                        server.Send(data);
+                    }
+                });
+            });
+
+            while (server.Complete()) {}
+        }
+
+        size_t broadcasts = kRounds * kBroadcasts;
+        std::string name = "broadcast_" + std::to_string(listeners);
+        Report(name, broadcasts, seconds);
+        ReportValue(name + "_allocs_per_broadcast",
+            static_cast<double>(allocations) / broadcasts);
+    }
+
+    /**
+     * Connects a storm of clients which all arrive at once.
+     *
+     * Clients which find no instance waiting get ERROR_PIPE_BUSY and retry
+     * once the server has opened more instances. The storm is repeated
+     * after every client disconnects to measure the instances reused.
+     *
+     * \param listen_count The instances kept waiting for clients.
+     */
+    void Storm(size_t listen_count) {
+        MockInterface<winss::MockWindowsInterface> windows;
+        windows->SetupDefaults();
+
+        size_t pipes = 0;
+        DWORD last_error = 0;
+
+        EXPECT_CALL(*windows, CreateNamedPipe(_, _, _, _, _, _, _, _))
+            .WillRepeatedly(Invoke([&](char*, DWORD, DWORD, DWORD, DWORD,
+                DWORD, DWORD, LPSECURITY_ATTRIBUTES) {
+            return reinterpret_cast<HANDLE>(100000 + ++pipes);
+        }));
+        EXPECT_CALL(*windows, ConnectNamedPipe(_, _))
+            .WillRepeatedly(Invoke([&](HANDLE, LPOVERLAPPED) {
+            last_error = ERROR_IO_PENDING;
+            return false;
+        }));
+        EXPECT_CALL(*windows, GetLastError())
+            .WillRepeatedly(Invoke([&]() { return last_error; }));
+        EXPECT_CALL(*windows, GetOverlappedResult(_, _, _, _))
+            .WillRepeatedly(Return(true));
+        EXPECT_CALL(*windows, DisconnectNamedPipe(_))
+            .WillRepeatedly(Return(true));
+        ON_CALL(*windows, CloseHandle(_)).WillByDefault(Return(true));
+
+        NiceMock<winss::MockWaitMultiplexer> multiplexer;
+        winss::MockPipeName pipe_name("benchmark");
+        BenchmarkPipeServer server({
+            pipe_name, winss::NotOwned(&multiplexer), 0,
+            winss::BACKLOG_DROP_OLDEST, listen_count
+        });
+
+        multiplexer.mock_init_callbacks.at(0)(multiplexer);
+
+        std::string name = "accept_" + std::to_string(listen_count);
+
+        for (int round = 0; round < 2; ++round) {
+            size_t pipes_before = pipes;
+            size_t accepted = 0;
+            size_t busy = 0;
+
+            double seconds = Time([&]() {
+                while (accepted < kStormClients) {
+                    std::vector<winss::HandleWrapper> waiting =
+                        server.Waiting();
+                    size_t count = std::min(waiting.size(),
+                        kStormClients - accepted);
+
+                    for (size_t i = 0; i < count; ++i) {
+                        server.Connect(waiting[i]);
+                    }
+
+                    accepted += count;
+                    busy += kStormClients - accepted;
+                }
+            });
+
+            std::string round_name = name + (round == 0 ? "" : "_reused");
+            Report(round_name, kStormClients, seconds);
+            ReportValue(round_name + "_busy", static_cast<double>(busy));
+            ReportValue(round_name + "_created",
+                static_cast<double>(pipes - pipes_before));
+
+            server.DisconnectAll();
+        }
+    }
+};
+
+TEST_F(PipeServerBenchmark, Accept1) {
+    Storm(1);
+}
+
+TEST_F(PipeServerBenchmark, Accept8) {
+    Storm(8);
+}
+
+TEST_F(PipeServerBenchmark, Accept64) {
+    Storm(64);
+}
+
+TEST_F(PipeServerBenchmark, BurstWrites) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    windows->SetupDefaults();
+
+    HANDLE pipe = reinterpret_cast<HANDLE>(10000);
+    size_t writes = 0;
+
+    EXPECT_CALL(*windows, CreateFile(_, _, _, _, _, _, _))
+        .WillRepeatedly(Return(pipe));
+    EXPECT_CALL(*windows, WriteFile(pipe, _, _, _, _))
+        .WillRepeatedly(Invoke([&](HANDLE, LPCVOID, DWORD, LPDWORD,
+            LPOVERLAPPED) {
+        writes++;
+        return true;
+    }));
+    EXPECT_CALL(*windows, ReadFile(pipe, _, _, _, _))
+        .WillRepeatedly(Return(true));
+    ON_CALL(*windows, CloseHandle(pipe)).WillByDefault(Return(true));
+
+    NiceMock<winss::MockWaitMultiplexer> multiplexer;
+    winss::MockPipeName pipe_name("benchmark");
+    BenchmarkOutboundPipeServer server({
+        pipe_name, winss::NotOwned(&multiplexer)
+    });
+
+    server.AddClients(100);
+
+    const char events[] = { 's', 'u', 'd', 'D' };
+    double seconds = Time([&]() {
+        for (size_t i = 0; i < kBurst; ++i) {
+            server.Send({ events[i % sizeof(events)] });
+        }
+
+        while (server.Complete()) {}
+    });
+
+    Report("burst_100", kBurst, seconds);
+    ReportValue("burst_100_writes_per_client",
+        static_cast<double>(writes) / 100);
+}
+
+TEST_F(PipeServerBenchmark, Broadcast1) {
+    Broadcast(1);
+}
+
+TEST_F(PipeServerBenchmark, Broadcast10) {
+    Broadcast(10);
+}
+
+TEST_F(PipeServerBenchmark, Broadcast100) {
+    Broadcast(100);
+}
+
+TEST_F(PipeServerBenchmark, Broadcast1000) {
+    Broadcast(1000);
+}
+}  // namespace winss
@@ -0,0 +1,274 @@
+/*
+* Copyright 2016-2017 Morgan Stanley
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+
+#include <windows.h>
+#include <filesystem>
+#include <chrono>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include "winss/winss.hpp"
+#include "winss/event_wrapper.hpp"
+#include "winss/handle_wrapper.hpp"
+#include "winss/not_owning_ptr.hpp"
+#include "winss/svscan/svscan.hpp"
+#include "winss/svscan/startup_scheduler.hpp"
+#include "../test/mock_interface.hpp"
+#include "../test/mock_filesystem_interface.hpp"
+#include "../test/mock_windows_interface.hpp"
+#include "../test/mock_wait_multiplexer.hpp"
+#include "../test/mock_path_mutex.hpp"
+#include "../test/mock_process.hpp"
+#include "benchmark.hpp"
+
+namespace fs = std::experimental::filesystem;
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::NiceMock;
+using ::testing::Return;
+
+namespace winss {
+/** The simulated time CreateProcess takes in ms. */
+const DWORD kCreateLatency = 2;
+
+/**
+ * A service which only tracks its flag so the scan itself is measured
+ * rather than the supervisors or the mock framework.
+ */
+class BenchmarkService {
+ private:
+    std::string name;
+    bool flagged = false;
+
+ public:
+    BenchmarkService(const std::string& name,
+        winss::LogAggregatorInterface*, winss::StartupSchedulerInterface*) :
+        name(name) {}
+
+    void Reset() {
+        flagged = false;
+    }
+
+    void Check() {
+        flagged = true;
+    }
+
+    bool Close(bool ignore_flagged) {
+        return flagged && !ignore_flagged;
+    }
+};
+class LockedPathMutex : public NiceMock<winss::MockPathMutex> {
+ public:
+    LockedPathMutex(fs::path path, std::string name) :
+        NiceMock<winss::MockPathMutex>(path, name) {
+        ON_CALL(*this, HasLock()).WillByDefault(Return(true));
+    }
+};
+class BenchmarkSvScan : public winss::SvScanTmpl<winss::BenchmarkService,
+    winss::LockedPathMutex, winss::NiceMockProcess> {
+ public:
+    BenchmarkSvScan(winss::NotOwningPtr<winss::WaitMultiplexer> multiplexer,
+        winss::EventWrapper close_event) : winss::SvScanTmpl<
+        winss::BenchmarkService, winss::LockedPathMutex,
+        winss::NiceMockProcess>::SvScanTmpl(multiplexer, ".", 0, false,
+        close_event) {}
+
+    size_t ServiceCount() const {
+        return services.size();
+    }
+};
+
+class StartupSvScan : public winss::SvScanTmpl<winss::Service,
+    winss::LockedPathMutex, winss::NiceMockProcess> {
+ public:
+    StartupSvScan(winss::NotOwningPtr<winss::WaitMultiplexer> multiplexer,
+        winss::EventWrapper close_event,
+        winss::StartupSchedulerInterface* scheduler) : winss::SvScanTmpl<
+        winss::Service, winss::LockedPathMutex,
+        winss::NiceMockProcess>::SvScanTmpl(multiplexer, ".", 0, false,
+        close_event, nullptr, false, scheduler) {}
+};
+
+class SvScanBenchmark : public winss::Benchmark {
+ protected:
+    /**
+     * Creates service directory names.
+     *
+     * \param count The number of service directories.
+     * \return The service directory names.
+     */
+    static std::vector<fs::path> ServiceDirs(size_t count) {
+        std::vector<fs::path> dirs;
+        dirs.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            std::ostringstream name;
+            name << "service" << std::setw(5) << std::setfill('0') << i;
+            dirs.emplace_back(name.str());
+        }
+
+        return dirs;
+    }
+
+    /**
+     * Starts the supervisors of a directory of services where every
+     * CreateProcess takes the simulated latency.
+     *
+     * \param count The number of service directories.
+     * \param concurrency The startup workers or 0 to start serially.
+     * \param rate The startup rate limit or 0 for no limit.
+     */
+    void Startup(size_t count, size_t concurrency, size_t rate) {
+        MockInterface<winss::MockFilesystemInterface> file;
+        MockInterface<winss::MockWindowsInterface> windows;
+        NiceMock<winss::MockWaitMultiplexer> multiplexer;
+        winss::EventWrapper close_event;
+
+        EXPECT_CALL(*file, GetDirectories(_))
+            .WillRepeatedly(Return(ServiceDirs(count)));
+
+        ON_CALL(*windows, CreateProcess(_, _, _, _, _, _, _, _, _, _))
+            .WillByDefault(Invoke([](const char*, char*,
+                SECURITY_ATTRIBUTES*, SECURITY_ATTRIBUTES*, bool, DWORD,
+                void*, const char*, STARTUPINFO*,
+                PROCESS_INFORMATION* proc_info) {
+            std::this_thread::sleep_for(
+                std::chrono::milliseconds(kCreateLatency));
+            proc_info->hProcess = reinterpret_cast<HANDLE>(1);
+            return true;
+        }));
+        ON_CALL(*windows, CloseHandle(_)).WillByDefault(Return(true));
+        ON_CALL(*windows, TerminateProcess(_, _)).WillByDefault(Return(true));
+
+        winss::HandleWrapper finished;
+        winss::TriggeredCallback complete;
+        ON_CALL(multiplexer, AddTriggeredCallback(_, _))
+            .WillByDefault(Invoke([&finished, &complete](
+                const winss::HandleWrapper& handle,
+                winss::TriggeredCallback callback) {
+            finished = handle;
+            complete = callback;
+        }));
+
+        std::unique_ptr<winss::StartupScheduler> scheduler;
+        if (concurrency > 0) {
+            scheduler.reset(new winss::StartupScheduler(
+                winss::NotOwned(&multiplexer), concurrency, rate));
+        }
+
+        StartupSvScan svscan(winss::NotOwned(&multiplexer), close_event,
+            scheduler.get());
+
+        double seconds = Time([&]() {
+            svscan.Scan(false);
+
+            while (scheduler != nullptr && scheduler->Outstanding() > 0) {
+                finished.Wait(INFINITE);
+                complete(multiplexer, finished);
+            }
+        });
+
+        std::string name = "startup_";
+        if (concurrency > 0) {
+            name += "jobs" + std::to_string(concurrency) + "_";
+        }
+
+        if (rate > 0) {
+            name += "rate" + std::to_string(rate) + "_";
+        }
+
+        Report(name + std::to_string(count), count, seconds);
+    }
+
+    /**
+     * Scans a directory of services, rescans it both on demand and on the
+     * timer when every service is already known and then closes all the
+     * services.
+     *
+     * \param count The number of service directories.
+     */
+    void Scan(size_t count) {
+        MockInterface<winss::MockFilesystemInterface> file;
+        NiceMock<winss::MockWaitMultiplexer> multiplexer;
+        winss::EventWrapper close_event;
+
+        EXPECT_CALL(*file, GetDirectories(_))
+            .WillRepeatedly(Return(ServiceDirs(count)));
+
+        BenchmarkSvScan svscan(winss::NotOwned(&multiplexer), close_event);
+        std::string name = "scan_" + std::to_string(count);
+
+        double seconds = Time([&]() {
+            svscan.Scan(false);
+        });
+
+        EXPECT_EQ(count, svscan.ServiceCount());
+        Report(name, count, seconds);
+
+        seconds = Time([&]() {
+            svscan.Scan(false);
+        });
+
+        EXPECT_EQ(count, svscan.ServiceCount());
+        Report("re" + name, count, seconds);
+
+        seconds = Time([&]() {
+            svscan.Scan(true);
+        });
+
+        EXPECT_EQ(count, svscan.ServiceCount());
+        Report("full_re" + name, count, seconds);
+
+        seconds = Time([&]() {
+            svscan.CloseAllServices(true);
+        });
+
+        EXPECT_EQ(0, svscan.ServiceCount());
+        Report("close_all_" + std::to_string(count), count, seconds);
+    }
+};
+
+TEST_F(SvScanBenchmark, Scan100) {
+    Scan(100);
+}
+
+TEST_F(SvScanBenchmark, Scan1000) {
+    Scan(1000);
+}
+
+TEST_F(SvScanBenchmark, Scan10000) {
+    Scan(10000);
+}
+
+TEST_F(SvScanBenchmark, StartupSerial) {
+    Startup(200, 0, 0);
+}
+
+TEST_F(SvScanBenchmark, StartupJobs) {
+    Startup(200, 8, 0);
+    Startup(200, 32, 0);
+}
+
+TEST_F(SvScanBenchmark, StartupRate) {
+    Startup(200, 32, 500);
+}
+}  // namespace winss
@@ -0,0 +1,252 @@
+/*
+* Copyright 2016-2017 Morgan Stanley
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include "winss/winss.hpp"
+#include "winss/wait_multiplexer.hpp"
+#include "winss/handle_wrapper.hpp"
+#include "winss/event_wrapper.hpp"
+#include "../test/mock_interface.hpp"
+#include "../test/mock_windows_interface.hpp"
+#include "benchmark.hpp"
+
+using ::testing::_;
+using ::testing::Invoke;
+
+namespace winss {
+static const size_t kDispatches = 10000;
+static const size_t kMockDispatches = 100000;
+static const size_t kBursts = 100;
+
+class WaitMultiplexerBenchmark : public winss::Benchmark {
+ protected:
+    /**
+     * Signals one event at a time across all the handles and measures how
+     * quickly the multiplexer dispatches them.
+     *
+     * \param count The number of handles to wait on.
+     */
+    void Dispatch(size_t count) {
+        std::vector<winss::EventWrapper> events(count);
+        winss::WaitMultiplexer multiplexer;
+        size_t dispatched = 0;
+
+        std::vector<winss::TriggeredCallback> callbacks(count);
+        for (size_t i = 0; i < count; ++i) {
+            callbacks[i] = [&, i](winss::WaitMultiplexer& m,
+                const winss::HandleWrapper&) {
+                events[i].Reset();
+                m.AddTriggeredCallback(events[i].GetHandle(), callbacks[i]);
+
+                if (++dispatched < kDispatches) {
+                    events[(i * 7 + 1) % count].Set();
+                } else {
+                    m.Stop(0);
+                }
+            };
+
+            multiplexer.AddTriggeredCallback(events[i].GetHandle(),
+                callbacks[i]);
+        }
+
+        multiplexer.AddStopCallback([&events](winss::WaitMultiplexer& m) {
+            for (auto& e : events) {
+                m.RemoveTriggeredCallback(e.GetHandle());
+            }
+        });
+
+        events[0].Set();
+
+        double seconds = Time([&multiplexer]() { multiplexer.Start(); });
+
+        EXPECT_EQ(kDispatches, dispatched);
+        Report("dispatch_" + std::to_string(count), dispatched, seconds);
+    }
+
+    /**
+     * Measures the cost of the multiplexer itself per dispatched event by
+     * mocking WaitForMultipleObjects to signal each handle in turn.
+     *
+     * \param count The number of handles to wait on.
+     */
+    void DispatchMocked(size_t count) {
+        MockInterface<winss::MockWindowsInterface> windows;
+        winss::WaitMultiplexer multiplexer;
+        size_t dispatched = 0;
+        DWORD next = 0;
+
+        EXPECT_CALL(*windows, WaitForMultipleObjects(_, _, _, _))
+            .WillRepeatedly(Invoke([&next](DWORD handles_count,
+                const HANDLE*, bool, DWORD) {
+            return WAIT_OBJECT_0 + (next++ % handles_count);
+        }));
+
+        winss::TriggeredCallback callback = [&](winss::WaitMultiplexer& m,
+            const winss::HandleWrapper& handle) {
+            if (++dispatched < kMockDispatches) {
+                m.AddTriggeredCallback(handle, callback);
+            } else {
+                m.Stop(0);
+            }
+        };
+
+        std::vector<winss::HandleWrapper> handles;
+        for (size_t i = 0; i < count; ++i) {
+            handles.emplace_back(reinterpret_cast<HANDLE>(10000 + i), false);
+            multiplexer.AddTriggeredCallback(handles.back(), callback);
+        }
+
+        multiplexer.AddStopCallback([&handles](winss::WaitMultiplexer& m) {
+            for (auto& handle : handles) {
+                m.RemoveTriggeredCallback(handle);
+            }
+        });
+
+        double seconds = Time([&multiplexer]() { multiplexer.Start(); });
+
+        EXPECT_EQ(kMockDispatches, dispatched);
+        std::string name = "mock_dispatch_" + std::to_string(count);
+        Report(name, dispatched, seconds);
+        ReportValue(name + "_ns_per_event", seconds * 1e9 / dispatched);
+    }
+
+    /**
+     * Signals every handle at once like a mass restart and measures how many
+     * waits the multiplexer needs to drain each burst.
+     *
+     * \param count The number of handles to wait on.
+     * \param mode The dispatch mode.
+     * \param mode_name The dispatch mode name used in the report.
+     */
+    void DispatchBurst(size_t count, WaitDispatchMode mode,
+        const std::string& mode_name) {
+        MockInterface<winss::MockWindowsInterface> windows;
+        windows->SetupDefaults();
+
+        winss::WaitMultiplexer multiplexer;
+        multiplexer.SetDispatchMode(mode);
+
+        std::mutex mutex;
+        std::vector<bool> signalled(count, false);
+        size_t remaining = 0;
+        size_t bursts = 0;
+        size_t blocking = 0;
+        size_t calls = 0;
+
+        EXPECT_CALL(*windows, WaitForMultipleObjects(_, _, _, _))
+            .WillRepeatedly(Invoke([&](DWORD handles_count, const HANDLE* h,
+                bool, DWORD timeout) {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++calls;
+
+            if (timeout != 0) {
+                ++blocking;
+                if (remaining == 0 && bursts < kBursts) {
+                    ++bursts;
+                    remaining = count;
+                    signalled.assign(count, true);
+                }
+            }
+
+            for (DWORD i = 0; i < handles_count; ++i) {
+                size_t index = reinterpret_cast<size_t>(h[i]) - 10000;
+                if (index < count && signalled[index]) {
+                    return WAIT_OBJECT_0 + i;
+                }
+            }
+
+            return static_cast<DWORD>(WAIT_TIMEOUT);
+        }));
+
+        size_t dispatched = 0;
+        std::vector<winss::HandleWrapper> handles;
+        std::vector<winss::TriggeredCallback> callbacks(count);
+        for (size_t i = 0; i < count; ++i) {
+            handles.emplace_back(reinterpret_cast<HANDLE>(10000 + i), false);
+            callbacks[i] = [&, i](winss::WaitMultiplexer& m,
+                const winss::HandleWrapper& handle) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    signalled[i] = false;
+                    --remaining;
+                }
+
+                m.AddTriggeredCallback(handle, callbacks[i]);
+
+                if (++dispatched == kBursts * count) {
+                    m.Stop(0);
+                }
+            };
+
+            multiplexer.AddTriggeredCallback(handles.back(), callbacks[i]);
+        }
+
+        multiplexer.AddStopCallback([&handles](winss::WaitMultiplexer& m) {
+            for (auto& handle : handles) {
+                m.RemoveTriggeredCallback(handle);
+            }
+        });
+
+        double seconds = Time([&multiplexer]() { multiplexer.Start(); });
+
+        EXPECT_EQ(kBursts * count, dispatched);
+        std::string name = "burst_" + mode_name + "_" + std::to_string(count);
+        Report(name, bursts, seconds);
+        ReportValue(name + "_blocking_waits_per_burst",
+            static_cast<double>(blocking) / bursts);
+        ReportValue(name + "_wait_calls_per_burst",
+            static_cast<double>(calls) / bursts);
+        ReportValue(name + "_us_per_burst", seconds * 1e6 / bursts);
+    }
+};
+
+TEST_F(WaitMultiplexerBenchmark, Dispatch64) {
+    Dispatch(64);
+}
+
+TEST_F(WaitMultiplexerBenchmark, Dispatch512) {
+    Dispatch(512);
+}
+
+TEST_F(WaitMultiplexerBenchmark, Dispatch4096) {
+    Dispatch(4096);
+}
+
+TEST_F(WaitMultiplexerBenchmark, MockDispatch16) {
+    DispatchMocked(16);
+}
+
+TEST_F(WaitMultiplexerBenchmark, MockDispatch64) {
+    DispatchMocked(64);
+}
+
+TEST_F(WaitMultiplexerBenchmark, BurstSingle200) {
+    DispatchBurst(200, DISPATCH_SINGLE, "single");
+}
+
+TEST_F(WaitMultiplexerBenchmark, BurstFair200) {
+    DispatchBurst(200, DISPATCH_FAIR, "fair");
+}
+
+TEST_F(WaitMultiplexerBenchmark, BurstBatch200) {
+    DispatchBurst(200, DISPATCH_BATCH, "batch");
+}
+}  // namespace winss
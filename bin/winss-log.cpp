@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <filesystem>
 #include <iostream>
 #include <vector>
 #include "winss/winss.hpp"
@@ -28,6 +29,8 @@
 
 INITIALIZE_EASYLOGGINGPP
 
+namespace fs = std::experimental::filesystem;
+
 struct Settings {
     int verbose_level = 0;
     std::vector<std::string> log_args;
@@ -130,7 +133,10 @@ void ConfigureLogger(const Settings& settings) {
 }
 
 int main(int argc, char* argv[]) {
-    /* Attach and ignore. The program will exit when stdin closes. */
+    /*
+     * Attach and keep going. The program will exit when stdin closes but
+     * a buffered writer flushes as soon as the close event is set.
+     */
     winss::AttachCtrlHandler();
 
     Settings settings = ParseArgs(argc, argv);
@@ -138,9 +144,15 @@ int main(int argc, char* argv[]) {
 
     winss::LogSettingsParser parser;
     winss::LogSettings log_settings = parser.Parse(settings.log_args);
+    if (log_settings.service.empty()) {
+        /* The logger runs in the log directory of the service. */
+        log_settings.service =
+            fs::current_path().parent_path().filename().string();
+    }
 
-    winss::LogStreamReader reader;
-    winss::LogStreamWriter writer;
+    winss::LogStreamReader reader(log_settings.line_length);
+    winss::LogStreamWriter writer(log_settings.buffer_size,
+        log_settings.flush_interval, winss::GetCloseEvent());
 
     winss::Log log(winss::NotOwned(&reader), winss::NotOwned(&writer),
         log_settings);
@@ -16,6 +16,7 @@
 
 #include <filesystem>
 #include <iostream>
+#include <string>
 #include <vector>
 #include "winss/winss.hpp"
 #include "optionparser/optionparser.hpp"
@@ -24,11 +25,13 @@
 #include "winss/windows_interface.hpp"
 #include "winss/filesystem_interface.hpp"
 #include "winss/not_owning_ptr.hpp"
+#include "winss/completion_port.hpp"
 #include "winss/wait_multiplexer.hpp"
 #include "winss/supervise/supervise.hpp"
 #include "winss/supervise/controller.hpp"
 #include "winss/supervise/state_file.hpp"
 #include "winss/pipe_server.hpp"
+#include "winss/pipe_instance.hpp"
 #include "winss/pipe_name.hpp"
 #include "resource/resource.h"
 
@@ -39,9 +42,17 @@ namespace fs = std::experimental::filesystem;
 struct Settings {
     fs::path service_dir;
     int verbose_level = 0;
+    size_t backlog_limit = 0;
+    winss::BacklogPolicy backlog_policy = winss::BACKLOG_DROP_OLDEST;
+    size_t listen_count = 4;
+    bool fair = false;
+    bool completion_port = false;
 };
 
-enum OptionIndex { UNKNOWN, HELP, VERSION, VERBOSE };
+enum OptionIndex {
+    UNKNOWN, HELP, VERSION, VERBOSE, BACKLOG, BACKLOG_POLICY, LISTEN, FAIR,
+    COMPLETION_PORT
+};
 const option::Descriptor usage[] = {
     {
         UNKNOWN, 0, "", "", option::Arg::None,
@@ -60,9 +71,48 @@ const option::Descriptor usage[] = {
         VERBOSE, 0, "v", "verbose", option::Arg::Optional,
         "  -v[<level>], \t--verbose[=<level>]  \tSets the verbose level."
     },
+    {
+        BACKLOG, 0, "b", "backlog", option::Arg::Optional,
+        "  -b<bytes>, \t--backlog=<bytes>"
+        "  \tEvent bytes queued per client (0 is unbounded)."
+    },
+    {
+        BACKLOG_POLICY, 0, "", "backlog-policy", option::Arg::Optional,
+        "  --backlog-policy=<drop|coalesce|disconnect>"
+        "  \tWhat to do when a client is over the backlog."
+    },
+    {
+        LISTEN, 0, "l", "listen", option::Arg::Optional,
+        "  -l<count>, \t--listen=<count>"
+        "  \tEvent pipe instances kept waiting for clients."
+    },
+    {
+        FAIR, 0, "f", "fair", option::Arg::None,
+        "  -f, \t--fair  \tDispatch every signalled handle in turn."
+    },
+    {
+        COMPLETION_PORT, 0, "c", "completion-port", option::Arg::None,
+        "  -c, \t--completion-port  \tComplete pipe IO on a completion port."
+    },
     { 0, 0, 0, 0, 0, 0 }
 };
 
+size_t ParseCount(const option::Option& opt) {
+    char* end = nullptr;
+    size_t value = std::strtoul(opt.arg, &end, 10);
+
+    if (*opt.arg == '-' || end == opt.arg || *end != '\0') {
+        std::cerr
+            << "Option "
+            << opt.name
+            << " requires a numeric argument"
+            << std::endl;
+        std::exit(100);
+    }
+
+    return value;
+}
+
 Settings ParseArgs(int argc, char* argv[]) {
     /* Skip program name argv[0] if present */
     argc -= (argc > 0);
@@ -107,7 +157,8 @@ Settings ParseArgs(int argc, char* argv[]) {
     for (int i = 0; i < parse.optionsCount(); ++i) {
         option::Option& opt = buffer[i];
 
-        if (opt.index() == VERBOSE) {
+        switch (opt.index()) {
+        case VERBOSE:
             if (opt.arg == nullptr) {
                 settings.verbose_level = el::base::consts::kMaxVerboseLevel;
             } else {
@@ -120,6 +171,41 @@ Settings ParseArgs(int argc, char* argv[]) {
                         << " requires a numeric argument";
                 }
             }
+            break;
+        case BACKLOG:
+            if (opt.arg != nullptr) {
+                settings.backlog_limit = ParseCount(opt);
+            }
+            break;
+        case BACKLOG_POLICY:
+            if (opt.arg != nullptr) {
+                std::string policy = opt.arg;
+                if (policy == "drop") {
+                    settings.backlog_policy = winss::BACKLOG_DROP_OLDEST;
+                } else if (policy == "coalesce") {
+                    settings.backlog_policy = winss::BACKLOG_COALESCE;
+                } else if (policy == "disconnect") {
+                    settings.backlog_policy = winss::BACKLOG_DISCONNECT;
+                } else {
+                    std::cerr
+                        << "Option "
+                        << opt.name
+                        << " must be drop, coalesce or disconnect";
+                    std::exit(100);
+                }
+            }
+            break;
+        case LISTEN:
+            if (opt.arg != nullptr) {
+                settings.listen_count = ParseCount(opt);
+            }
+            break;
+        case FAIR:
+            settings.fair = true;
+            break;
+        case COMPLETION_PORT:
+            settings.completion_port = true;
+            break;
         }
     }
 
@@ -146,18 +232,31 @@ int main(int argc, char* argv[]) {
 
     winss::WaitMultiplexer multiplexer;
     multiplexer.AddCloseEvent(winss::GetCloseEvent(), 0);
+    if (settings.fair) {
+        multiplexer.SetDispatchMode(winss::DISPATCH_FAIR);
+    }
+
+    winss::CompletionPort completion_port(winss::NotOwned(&multiplexer));
 
     winss::PipeName pipe_name(settings.service_dir,
         winss::Supervise::kMutexName);
     winss::OutboundPipeServer outbound({
         pipe_name.Append("event"),
-        winss::NotOwned(&multiplexer)
+        winss::NotOwned(&multiplexer),
+        settings.backlog_limit,
+        settings.backlog_policy,
+        settings.listen_count
     });
     winss::InboundPipeServer inbound({
         pipe_name.Append("control"),
         winss::NotOwned(&multiplexer)
     });
 
+    if (settings.completion_port) {
+        outbound.SetCompletionPort(winss::NotOwned(&completion_port));
+        inbound.SetCompletionPort(winss::NotOwned(&completion_port));
+    }
+
     winss::Supervise supervise(winss::NotOwned(&multiplexer),
         settings.service_dir);
     winss::SuperviseController controller(winss::NotOwned(&supervise),
@@ -25,6 +25,8 @@
 #include "winss/wait_multiplexer.hpp"
 #include "winss/svscan/svscan.hpp"
 #include "winss/svscan/controller.hpp"
+#include "winss/svscan/startup_scheduler.hpp"
+#include "winss/log/log_aggregator.hpp"
 #include "winss/pipe_server.hpp"
 #include "winss/pipe_name.hpp"
 #include "winss/ctrl_handler.hpp"
@@ -38,6 +40,11 @@ struct Settings {
     fs::path scan_dir;
     DWORD rescan = INFINITE;
     bool signals = false;
+    bool log_aggregator = false;
+    bool watch = false;
+    size_t start_jobs = 0;
+    size_t start_rate = 0;
+    bool fair = false;
     int verbose_level = 0;
 };
 
@@ -57,7 +64,10 @@ struct Arg : public option::Arg {
     }
 };
 
-enum OptionIndex { UNKNOWN, HELP, VERSION, VERBOSE, TIMEOUT, SIGNALS };
+enum OptionIndex {
+    UNKNOWN, HELP, VERSION, VERBOSE, TIMEOUT, SIGNALS, LOG_AGGREGATOR, WATCH,
+    JOBS, RATE, FAIR
+};
 const option::Descriptor usage[] = {
     {
         UNKNOWN, 0, "", "", Arg::None,
@@ -84,6 +94,27 @@ const option::Descriptor usage[] = {
         SIGNALS, 0, "s", "signals", Arg::None,
         "  -s, \t--signals  \tDivert signals."
     },
+    {
+        LOG_AGGREGATOR, 0, "l", "log-aggregator", Arg::None,
+        "  -l, \t--log-aggregator  \tAggregate logs with a script file."
+    },
+    {
+        WATCH, 0, "w", "watch", Arg::None,
+        "  -w, \t--watch  \tScan when the scan directory changes."
+    },
+    {
+        JOBS, 0, "j", "jobs", Arg::Required,
+        "  -j<jobs>, \t--jobs=<jobs>  \tStart supervisors from <jobs> workers."
+    },
+    {
+        RATE, 0, "r", "rate", Arg::Required,
+        "  -r<rate>, \t--rate=<rate>  \tStart at most <rate> supervisors a "
+        "second."
+    },
+    {
+        FAIR, 0, "f", "fair", Arg::None,
+        "  -f, \t--fair  \tDispatch every signalled handle in turn."
+    },
     { 0, 0, 0, 0, 0, 0 }
 };
 
@@ -160,6 +191,21 @@ Settings ParseArgs(int argc, char* argv[]) {
         case SIGNALS:
             settings.signals = true;
             break;
+        case LOG_AGGREGATOR:
+            settings.log_aggregator = true;
+            break;
+        case WATCH:
+            settings.watch = true;
+            break;
+        case JOBS:
+            settings.start_jobs = std::strtoul(opt.arg, nullptr, 10);
+            break;
+        case RATE:
+            settings.start_rate = std::strtoul(opt.arg, nullptr, 10);
+            break;
+        case FAIR:
+            settings.fair = true;
+            break;
         }
     }
 
@@ -185,6 +231,9 @@ int main(int argc, char* argv[]) {
     ConfigureLogger(settings);
 
     winss::WaitMultiplexer multiplexer;
+    if (settings.fair) {
+        multiplexer.SetDispatchMode(winss::DISPATCH_FAIR);
+    }
 
     winss::PipeName pipe_name(settings.scan_dir, winss::SvScan::kMutexName);
     winss::InboundPipeServer inbound({
@@ -192,8 +241,17 @@ int main(int argc, char* argv[]) {
         winss::NotOwned(&multiplexer)
     });
 
+    winss::LogAggregator log_aggregator(winss::NotOwned(&multiplexer),
+        pipe_name.Append("log"));
+
+    winss::StartupScheduler scheduler(winss::NotOwned(&multiplexer),
+        settings.start_jobs, settings.start_rate);
+    bool scheduled = settings.start_jobs > 0 || settings.start_rate > 0;
+
     winss::SvScan svscan(winss::NotOwned(&multiplexer), settings.scan_dir,
-        settings.rescan, settings.signals, winss::GetCloseEvent());
+        settings.rescan, settings.signals, winss::GetCloseEvent(),
+        settings.log_aggregator ? &log_aggregator : nullptr, settings.watch,
+        scheduled ? &scheduler : nullptr);
     winss::SvScanController controller(winss::NotOwned(&svscan),
         winss::NotOwned(&inbound));
     return multiplexer.Start();
@@ -0,0 +1,247 @@
+/*
+ * Copyright 2016-2017 Morgan Stanley
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "completion_port.hpp"
+#include <windows.h>
+#include <algorithm>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <utility>
+#include <unordered_map>
+#include <unordered_set>
+#include "easylogging/easylogging++.hpp"
+#include "windows_interface.hpp"
+#include "handle_wrapper.hpp"
+#include "event_wrapper.hpp"
+#include "wait_multiplexer.hpp"
+#include "not_owning_ptr.hpp"
+
+winss::CompletionPort::CompletionPort(
+    winss::NotOwningPtr<winss::WaitMultiplexer> multiplexer) :
+    multiplexer(multiplexer) {}
+
+bool winss::CompletionPort::Associate(HANDLE file, HANDLE key) {
+    if (port == nullptr) {
+        port = WINDOWS.CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr,
+            0, 1);
+
+        if (port == nullptr) {
+            VLOG(1)
+                << "CreateIoCompletionPort failed: "
+                << WINDOWS.GetLastError();
+            return false;
+        }
+
+        VLOG(5) << "Created completion port: " << port;
+        thread = std::thread(&CompletionPort::DequeueLoop, this);
+    }
+
+    if (WINDOWS.CreateIoCompletionPort(file, port,
+        reinterpret_cast<ULONG_PTR>(key), 0) == nullptr) {
+        VLOG(1)
+            << "Could not associate "
+            << file
+            << " with completion port: "
+            << WINDOWS.GetLastError();
+        return false;
+    }
+
+    return true;
+}
+
+void winss::CompletionPort::Disassociate(HANDLE key) {
+    callbacks.erase(key);
+    pending.erase(key);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        completed.erase(std::remove_if(completed.begin(), completed.end(),
+            [key](const Completion& c) {
+            return c.key == key && !c.drained;
+        }), completed.end());
+    }
+
+    if (port == nullptr) {
+        return;
+    }
+
+    if (!WINDOWS.PostQueuedCompletionStatus(port, kDrainMarker,
+        reinterpret_cast<ULONG_PTR>(key), nullptr)) {
+        VLOG(1)
+            << "Could not post drain marker for "
+            << key
+            << ": "
+            << WINDOWS.GetLastError();
+        return;
+    }
+
+    closed[key]++;
+}
+
+bool winss::CompletionPort::Post(HANDLE key) {
+    if (port == nullptr || key == nullptr) {
+        return false;
+    }
+
+    if (!WINDOWS.PostQueuedCompletionStatus(port, 0,
+        reinterpret_cast<ULONG_PTR>(key), nullptr)) {
+        VLOG(1)
+            << "PostQueuedCompletionStatus failed: "
+            << WINDOWS.GetLastError();
+        return false;
+    }
+
+    return true;
+}
+
+void winss::CompletionPort::AddTriggeredCallback(
+    const winss::HandleWrapper& key, winss::TriggeredCallback callback) {
+    callbacks[key.handle] = callback;
+
+    if (pending.erase(key.handle) > 0) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            completed.push_back({ key.handle, false });
+        }
+        ready.Set();
+    }
+
+    Watch();
+}
+
+bool winss::CompletionPort::RemoveTriggeredCallback(
+    const winss::HandleWrapper& key) {
+    return callbacks.erase(key.handle) > 0;
+}
+
+size_t winss::CompletionPort::CallbackCount() const {
+    return callbacks.size();
+}
+
+size_t winss::CompletionPort::ClosedCount() const {
+    return closed.size();
+}
+
+void winss::CompletionPort::Watch() {
+    if (!watching) {
+        watching = true;
+        multiplexer->AddTriggeredCallback(ready.GetHandle(), [this](
+            winss::WaitMultiplexer&, const winss::HandleWrapper&) {
+            this->Dispatch();
+        });
+    }
+}
+
+void winss::CompletionPort::Dispatch() {
+    watching = false;
+    ready.Reset();
+
+    batch.clear();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        batch.swap(completed);
+    }
+
+    VLOG(7) << "Dispatching " << batch.size() << " completions";
+
+    for (const Completion& completion : batch) {
+        HANDLE key = completion.key;
+        auto closing = closed.find(key);
+
+        if (completion.drained) {
+            if (closing != closed.end() && --closing->second == 0) {
+                VLOG(6) << "Drained completions of closed key: " << key;
+                closed.erase(closing);
+            }
+            continue;
+        }
+
+        if (closing != closed.end()) {
+            VLOG(6) << "Dropping completion of closed key: " << key;
+            continue;
+        }
+
+        auto it = callbacks.find(key);
+        if (it == callbacks.end()) {
+            VLOG(6) << "No callback yet for completion: " << key;
+            pending.insert(key);
+            continue;
+        }
+
+        auto callback = std::move(it->second);
+        callbacks.erase(it);
+        callback(*multiplexer, winss::HandleWrapper(key, false));
+    }
+
+    if (!callbacks.empty()) {
+        Watch();
+    }
+}
+
+void winss::CompletionPort::DequeueLoop() {
+    std::vector<OVERLAPPED_ENTRY> entries(kBatchSize);
+    bool running = true;
+
+    while (running) {
+        ULONG removed = 0;
+        if (!WINDOWS.GetQueuedCompletionStatusEx(port, entries.data(),
+            kBatchSize, &removed, INFINITE, false)) {
+            VLOG(1)
+                << "GetQueuedCompletionStatusEx failed: "
+                << WINDOWS.GetLastError();
+            break;
+        }
+
+        size_t queued = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (ULONG i = 0; i < removed; ++i) {
+                HANDLE key = reinterpret_cast<HANDLE>(
+                    entries[i].lpCompletionKey);
+                if (key == nullptr) {
+                    running = false;
+                } else {
+                    completed.push_back({ key,
+                        entries[i].lpOverlapped == nullptr &&
+                        entries[i].dwNumberOfBytesTransferred ==
+                        kDrainMarker });
+                    ++queued;
+                }
+            }
+        }
+
+        if (queued > 0) {
+            ready.Set();
+        }
+    }
+}
+
+winss::CompletionPort::~CompletionPort() {
+    if (watching) {
+        multiplexer->RemoveTriggeredCallback(ready.GetHandle());
+    }
+
+    if (port != nullptr) {
+        if (thread.joinable()) {
+            WINDOWS.PostQueuedCompletionStatus(port, 0, 0, nullptr);
+            thread.join();
+        }
+
+        WINDOWS.CloseHandle(port);
+        VLOG(5) << "Closed completion port: " << port;
+    }
+}
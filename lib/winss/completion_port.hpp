@@ -0,0 +1,180 @@
+/*
+ * Copyright 2016-2017 Morgan Stanley
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIB_WINSS_COMPLETION_PORT_HPP_
+#define LIB_WINSS_COMPLETION_PORT_HPP_
+
+#include <windows.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include "handle_wrapper.hpp"
+#include "event_wrapper.hpp"
+#include "wait_multiplexer.hpp"
+#include "not_owning_ptr.hpp"
+
+namespace winss {
+/**
+ * An I/O completion port which dispatches completions on the multiplexer.
+ *
+ * Files are associated with the port using a key handle which is the same
+ * handle that would otherwise be waited on. A helper thread dequeues
+ * completions in batches and sets a single event which the multiplexer
+ * waits on so any number of files only use one multiplexer handle.
+ *
+ * Callbacks are one-shot just like the triggered callbacks of the
+ * multiplexer and are always called on the multiplexer thread.
+ */
+class CompletionPort {
+ public:
+    /** The number of completions dequeued at once. */
+    static const ULONG kBatchSize = 64;
+    /** The bytes of the completion posted after the last of a closed key. */
+    static const DWORD kDrainMarker = 0xFFFFFFFF;
+
+ private:
+    /**
+     * A dequeued completion.
+     */
+    struct Completion {
+        HANDLE key;  /**< The key handle. */
+        bool drained;  /**< Flags the drain marker of a closed key. */
+    };
+
+    /** The event multiplexer which callbacks are dispatched on. */
+    winss::NotOwningPtr<winss::WaitMultiplexer> multiplexer;
+    HANDLE port = nullptr;  /**< The completion port handle. */
+    winss::EventWrapper ready;  /**< Set when completions are queued. */
+    bool watching = false;  /**< Flags if ready is in the multiplexer. */
+    std::thread thread;  /**< The thread dequeuing completions. */
+    std::mutex mutex;  /**< Guards the completed keys. */
+    std::vector<Completion> completed;  /**< The completed keys. */
+    std::vector<Completion> batch;  /**< The keys being dispatched. */
+    /** The callbacks for each key. */
+    std::unordered_map<HANDLE, winss::TriggeredCallback> callbacks;
+    /** The completed keys which did not have a callback yet. */
+    std::unordered_set<HANDLE> pending;
+    /** The drain markers still queued for each closed key. */
+    std::unordered_map<HANDLE, size_t> closed;
+
+    /**
+     * Waits on the ready event with the multiplexer if not already.
+     */
+    void Watch();
+
+    /**
+     * Dispatches the callbacks of the completed keys.
+     */
+    void Dispatch();
+
+    /**
+     * The helper thread loop which dequeues completions.
+     */
+    void DequeueLoop();
+
+ public:
+    /**
+     * Creates a completion port for the given multiplexer.
+     *
+     * The port itself is only created when the first file is associated.
+     *
+     * \param multiplexer The event multiplexer.
+     */
+    explicit CompletionPort(
+        winss::NotOwningPtr<winss::WaitMultiplexer> multiplexer);
+    CompletionPort(const CompletionPort&) = delete;  /**< No copy. */
+    CompletionPort(CompletionPort&&) = delete;  /**< No move. */
+
+    /**
+     * Associates a file with the completion port.
+     *
+     * \param file The overlapped file handle.
+     * \param key The key handle the completions are reported against.
+     * \return True if the file was associated otherwise false.
+     */
+    virtual bool Associate(HANDLE file, HANDLE key);
+
+    /**
+     * Drops the callback and any completions of a key whose file is closed.
+     *
+     * A drain marker is posted for the key. The port dequeues in order so
+     * completions of the key before the marker belong to the closed file and
+     * are ignored, even if a new file reuses the handle value in the
+     * meantime. The key is forgotten once its marker is dispatched.
+     *
+     * The pending I/O of the file should be finished or cancelled first.
+     *
+     * \param key The key handle.
+     */
+    virtual void Disassociate(HANDLE key);
+
+    /**
+     * Posts a completion for the key without any I/O.
+     *
+     * \param key The key handle to complete.
+     * \return True if the completion was posted otherwise false.
+     */
+    virtual bool Post(HANDLE key);
+
+    /**
+     * Add a callback for the next completion of the given key.
+     *
+     * If the key completed while it had no callback then the callback is
+     * dispatched on the next wake-up.
+     *
+     * \param key The key handle.
+     * \param callback The callback to call on completion.
+     */
+    virtual void AddTriggeredCallback(const winss::HandleWrapper& key,
+        winss::TriggeredCallback callback);
+
+    /**
+     * Removes the callback for the given key.
+     *
+     * \param key The key handle.
+     * \return True if the callback was removed otherwise false.
+     */
+    virtual bool RemoveTriggeredCallback(const winss::HandleWrapper& key);
+
+    /**
+     * Gets the number of keys waiting on a completion.
+     *
+     * \return The number of callbacks.
+     */
+    virtual size_t CallbackCount() const;
+
+    /**
+     * Gets the number of closed keys whose completions are being drained.
+     *
+     * \return The number of closed keys.
+     */
+    virtual size_t ClosedCount() const;
+
+    /**
+     * Stops the helper thread and closes the port.
+     */
+    virtual ~CompletionPort();
+
+    /** No copy. */
+    CompletionPort& operator=(const CompletionPort&) = delete;
+    /** No move. */
+    CompletionPort& operator=(CompletionPort&&) = delete;
+};
+}  // namespace winss
+
+#endif  // LIB_WINSS_COMPLETION_PORT_HPP_
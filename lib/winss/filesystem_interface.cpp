@@ -146,6 +146,31 @@ bool winss::FilesystemInterface::FileExists(const fs::path& path) const {
     }
 }
 
+unsigned __int64 winss::FilesystemInterface::FileSize(
+    const fs::path& path) const {
+    try {
+        return fs::file_size(path);
+    } catch (const fs::filesystem_error& e) {
+        VLOG(1) << "Could not get size of " << path << ": " << e.what();
+        return 0;
+    }
+}
+
+unsigned __int64 winss::FilesystemInterface::LastWriteTime(
+    const fs::path& path) const {
+    try {
+        return static_cast<unsigned __int64>(
+            fs::last_write_time(path).time_since_epoch().count());
+    } catch (const fs::filesystem_error& e) {
+        VLOG(1)
+            << "Could not get write time of "
+            << path
+            << ": "
+            << e.what();
+        return 0;
+    }
+}
+
 fs::path winss::FilesystemInterface::Absolute(const fs::path& path) const {
     try {
         return fs::canonical(path);
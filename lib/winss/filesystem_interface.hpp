@@ -111,6 +111,22 @@ class FilesystemInterface {
      */
     virtual bool FileExists(const fs::path& path) const;
 
+    /**
+     * Gets the size of a file.
+     *
+     * \param[in] path The file to get the size of.
+     * \return The size in bytes or 0 if it could not be read.
+     */
+    virtual unsigned __int64 FileSize(const fs::path& path) const;
+
+    /**
+     * Gets the last write time of a file or directory.
+     *
+     * \param[in] path The file or directory to get the write time of.
+     * \return The write time in clock ticks or 0 if it could not be read.
+     */
+    virtual unsigned __int64 LastWriteTime(const fs::path& path) const;
+
     /**
      * Gets the absolute path.
      *
@@ -32,11 +32,18 @@ enum WaitResultState {
 };
 
 struct WaitResult;
+class ShardedWait;
+class WaitMultiplexer;
+class CompletionPort;
 
 /**
  * A wrapper for a Windows HANDLE.
  */
 class HandleWrapper {
+    friend class ShardedWait;
+    friend class WaitMultiplexer;
+    friend class CompletionPort;
+
  protected:
     bool owned;  /**< If this instance owns the handle. */
     HANDLE handle;  /**< The wrapped handle. */
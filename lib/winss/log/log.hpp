@@ -18,17 +18,11 @@
 #define LIB_WINSS_LOG_LOG_HPP_
 
 #include <filesystem>
-#include <algorithm>
-#include <vector>
-#include <regex>
-#include <chrono>
-#include <utility>
-#include <string>
 #include "easylogging/easylogging++.hpp"
 #include "../filesystem_interface.hpp"
 #include "../not_owning_ptr.hpp"
 #include "../path_mutex.hpp"
-#include "../utils.hpp"
+#include "log_output.hpp"
 #include "log_settings.hpp"
 #include "log_stream_wrapper.hpp"
 
@@ -36,105 +30,22 @@ namespace fs = std::experimental::filesystem;
 
 namespace winss {
 
-/**
- * An archived log file.
- *
- * Holds information about an archived log file in the log directory.
- */
-struct LogArchiveFile {
-    fs::path file;  ///< The archive file name.
-    unsigned __int64 time;  ///< The time the archive was taken.
-};
-
 /**
  * The logger template.
  *
  * Reads from STDIN and writes to a log file. It will occasionally rotate the
- * log file when it gets too big.
+ * log file when it gets too big or too old and hand the archive to the
+ * archiver.
  */
 template<typename TMutex>
-class LogTmpl {
+class LogTmpl : public winss::LogOutput {
  protected:
     winss::NotOwningPtr<winss::LogStreamReader> reader;  /**< Log input. */
-    winss::NotOwningPtr<winss::LogStreamWriter> writer;  /**< Log output. */
-    const winss::LogSettings& settings;  /**< Logger settings. */
-    fs::path current;    /**< Current log file. */
     TMutex mutex;        /**< Log dir global mutex. */
-    std::regex pattern;  /**< Log file pattern when rotating files. */
-
-    /**
-     * Rotates the current log file.
-     *
-     * Current file is closed and renamed then a new current file is opened.
-     *
-     * \return True if the rotation succeeded and false otherwise.
-     */
-    bool Rotate() const {
-        writer->Close();
-
-        auto now = std::chrono::system_clock::now();
-        std::ostringstream os;
-        os << kArchivePrefix << now.time_since_epoch().count() << ".u";
-
-        fs::path archive = settings.log_dir / os.str();
-
-        FILESYSTEM.Rename(current, archive);
-
-        return writer->Open(current);
-    }
-
-    /**
-     * Deletes old archive files.
-     *
-     * Search the directory given an archive pattern and delete the archives
-     * which exceed the total number of archives defined in the settings.
-     */
-    void CleanArchives() const {
-        VLOG(3) << "Cleaning old archives";
-
-        std::vector<fs::path> files = FILESYSTEM.GetFiles(settings.log_dir);
-        if (files.size() <= settings.number) {
-            VLOG(3) << "Skipping archive clean up";
-            return;
-        }
-
-        std::vector<winss::LogArchiveFile> archives;
-        for (const fs::path& file : files) {
-            std::string s = file.filename().string();
-            std::smatch match;
-            if (std::regex_search(s, match, pattern) && match.size() > 1) {
-                std::string m = match[1].str();
-                unsigned __int64 time = std::strtoull(m.c_str(), nullptr, 10);
-                winss::LogArchiveFile archive{ file, time };
-                archives.push_back(std::move(archive));
-            }
-        }
-
-        std::sort(archives.begin(), archives.end(),
-            [](const winss::LogArchiveFile& f1,
-                const winss::LogArchiveFile& f2) {
-            return f1.time < f2.time;
-        });
-
-        __int64 to_delete = archives.size() - settings.number;
-        if (to_delete <= 0) {
-            VLOG(3)
-                << "Not cleaning up any archives because there are only "
-                << archives.size();
-            return;
-        }
-
-        VLOG(3) << "Removing " << to_delete << " archives";
-        for (size_t i = 0; to_delete; ++i, --to_delete) {
-            FILESYSTEM.Remove(archives.at(i).file);
-        }
-    }
 
  public:
     static const int kMutexTaken = 100;  /**< Log dir in use error. */
     static const int kFatalExitCode = 111;  /**< Something went wrong. */
-    static constexpr const char kCurrentLog[8] = "current";  /**< Log file. */
-    static constexpr const char kArchivePrefix[2] = "@";  /**< File prefix. */
     static constexpr const char kMutexName[4] = "log";  /**< Mutex name. */
 
     /**
@@ -146,11 +57,9 @@ class LogTmpl {
      */
     LogTmpl(winss::NotOwningPtr<winss::LogStreamReader> reader,
         winss::NotOwningPtr<winss::LogStreamWriter> writer,
-        const winss::LogSettings& settings) : reader(reader), writer(writer),
-        settings(settings), mutex(settings.log_dir, kMutexName),
-        pattern("^" + std::string(kArchivePrefix) + "([\\d]+)\\.\\w$") {
-        current = settings.log_dir / fs::path(kCurrentLog);
-    }
+        const winss::LogSettings& settings) :
+        winss::LogOutput::LogOutput(writer, settings), reader(reader),
+        mutex(settings.log_dir, kMutexName) {}
 
     LogTmpl(const LogTmpl&) = delete;  /**< No copy. */
     LogTmpl(LogTmpl&&) = delete;  /**< No move. */
@@ -159,8 +68,12 @@ class LogTmpl {
      * Starts the logging implementation.
      *
      * Obtains a log on the log dir, starts reading from the reader and
-     * writing to the writer until EOF is reached. When a rotation occurs
-     * then clean archives will be invoked.
+     * writing to the writer until EOF is reached. The archiver is started
+     * once the log dir is locked and is stopped at EOF after it finishes
+     * removing old archives.
+     *
+     * The rotate interval is checked when a line arrives so an idle logger
+     * does not produce empty archives.
      *
      * \return The return code.
      */
@@ -177,37 +90,22 @@ class LogTmpl {
             return kMutexTaken;
         }
 
-        if (!writer->Open(current)) {
+        if (!Open()) {
             return kFatalExitCode;
         }
 
-        unsigned int size = 0;
         while (!reader->IsEOF()) {
-            std::streamoff pos = writer->GetPos();
-
-            if (pos > size) {
-                if (!Rotate()) {
-                    return kFatalExitCode;
-                }
-
-                CleanArchives();
+            winss::LogLine line = reader->GetLine();
+            if (line.data == nullptr) {
+                continue;
             }
 
-            size = settings.file_size;
-
-            std::string line = reader->GetLine();
-
-            if (settings.timestamp) {
-                auto now = std::chrono::system_clock::now();
-                writer->Write(winss::Utils::ConvertToISOString(now));
-                writer->Write(" ");
+            if (!Write(line)) {
+                return kFatalExitCode;
             }
-
-            writer->Write(line);
-            writer->WriteLine();
         }
 
-        writer->Close();
+        Close();
         return 0;
     }
 
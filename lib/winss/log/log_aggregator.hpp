@@ -0,0 +1,619 @@
+/*
+ * Copyright 2016-2017 Morgan Stanley
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIB_WINSS_LOG_LOG_AGGREGATOR_HPP_
+#define LIB_WINSS_LOG_LOG_AGGREGATOR_HPP_
+
+#include <windows.h>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "easylogging/easylogging++.hpp"
+#include "../windows_interface.hpp"
+#include "../filesystem_interface.hpp"
+#include "../handle_wrapper.hpp"
+#include "../not_owning_ptr.hpp"
+#include "../path_mutex.hpp"
+#include "../pipe_instance.hpp"
+#include "../pipe_name.hpp"
+#include "../wait_multiplexer.hpp"
+#include "log.hpp"
+#include "log_archiver.hpp"
+#include "log_output.hpp"
+#include "log_settings.hpp"
+#include "log_settings_parser.hpp"
+#include "log_stream_wrapper.hpp"
+
+namespace fs = std::experimental::filesystem;
+
+namespace winss {
+/**
+ * Gives services a pipe to log to instead of their own logger process.
+ */
+class LogAggregatorInterface {
+ public:
+    /**
+     * Adds a pipe for the logs of a service.
+     *
+     * \param name The name of the service.
+     * \param log_service_dir The log directory of the service definition.
+     * \return The write end of the pipe or an empty handle on failure.
+     */
+    virtual winss::HandleWrapper Add(const std::string& name,
+        const fs::path& log_service_dir) = 0;
+
+    /**
+     * Closes the logs of a service once its pipes are closed.
+     *
+     * \param name The name of the service.
+     */
+    virtual void Remove(const std::string& name) = 0;
+
+    /** Default destructor. */
+    virtual ~LogAggregatorInterface() {}
+};
+
+/**
+ * The log aggregator template.
+ *
+ * Reads the output of many services through overlapped named pipes on the
+ * multiplexer and writes each service to its own log directory with the
+ * same rotation rules as the logger. The logging script is read from the
+ * script file in the log definition of the service. The old archives of
+ * every stream are removed by one shared background worker.
+ *
+ * \tparam TPipeInstance The inbound pipe instance implementation type.
+ * \tparam TMutex The mutex implementation type.
+ * \tparam TWriter The log stream writer implementation type.
+ */
+template<typename TPipeInstance, typename TMutex, typename TWriter>
+class LogAggregatorTmpl : public LogAggregatorInterface {
+ protected:
+    /**
+     * A log directory written by the aggregator.
+     */
+    struct Stream {
+        winss::LogSettings settings;  /**< The logger settings. */
+        TMutex mutex;  /**< Log dir global mutex. */
+        TWriter writer;  /**< The log stream writer. */
+        winss::LogOutput output;  /**< Writes and rotates the log files. */
+        size_t pipes = 0;  /**< The pipes writing to the stream. */
+        bool removing = false;  /**< Close once the pipes are closed. */
+        winss::TimeoutId flush_timeout = 0;  /**< The next flush. */
+
+        /**
+         * Creates a stream for the given settings.
+         *
+         * \param settings The logger settings.
+         * \param archive_worker The worker shared by the streams.
+         */
+        Stream(const winss::LogSettings& settings,
+            winss::NotOwningPtr<winss::LogArchiveWorker> archive_worker) :
+            settings(settings),
+            mutex(settings.log_dir, winss::LogTmpl<TMutex>::kMutexName),
+            writer(settings.buffer_size),
+            output(winss::NotOwned(&writer), this->settings,
+                archive_worker) {}
+    };
+
+    /**
+     * A pipe which is read into a stream.
+     */
+    struct Pipe {
+        TPipeInstance instance;  /**< The server end of the pipe. */
+        std::string name;  /**< The name of the stream. */
+        std::string partial;  /**< The bytes of an unfinished line. */
+    };
+
+    /** The event multiplexer for the aggregator. */
+    winss::NotOwningPtr<winss::WaitMultiplexer> multiplexer;
+    winss::PipeName pipe_name;  /**< The base name of the pipes. */
+    /** Removes the old archives of every stream on one thread. */
+    winss::LogArchiveWorker archive_worker;
+    std::map<std::string, Stream> streams;  /**< The streams by name. */
+    /** The pipes by event handle. */
+    std::map<winss::HandleWrapper, Pipe> pipes;
+    size_t generation = 0;  /**< Makes each pipe name unique. */
+    bool stopping = false;  /**< Flag if the aggregator is stopping. */
+
+    /**
+     * Reads the logging script of a service.
+     *
+     * The log directory defaults to the log definition and relative log
+     * directories are relative to it the same as a logger process. Records
+     * are named after the service unless the script names them.
+     *
+     * \param name The name of the service.
+     * \param log_service_dir The log directory of the service definition.
+     * \return The logger settings.
+     */
+    winss::LogSettings ReadSettings(const std::string& name,
+        const fs::path& log_service_dir) const {
+        fs::path dir = FILESYSTEM.Absolute(log_service_dir);
+        std::vector<std::string> directives{ dir.string() };
+
+        std::istringstream script(FILESYSTEM.Read(
+            log_service_dir / fs::path(kScriptFile)));
+        std::string directive;
+        while (script >> directive) {
+            if (directive.front() == '.') {
+                directive = (dir / fs::path(directive)).string();
+            }
+
+            directives.push_back(directive);
+        }
+
+        winss::LogSettingsParser parser;
+        winss::LogSettings settings = parser.Parse(directives);
+        if (settings.service.empty()) {
+            settings.service = name;
+        }
+
+        return settings;
+    }
+
+    /**
+     * Gets the stream of a service and opens it if needed.
+     *
+     * \param name The name of the service.
+     * \param log_service_dir The log directory of the service definition.
+     * \return The stream or the end of the streams on failure.
+     */
+    typename std::map<std::string, Stream>::iterator OpenStream(
+        const std::string& name, const fs::path& log_service_dir) {
+        auto it = streams.find(name);
+        if (it != streams.end()) {
+            it->second.removing = false;
+            return it;
+        }
+
+        winss::LogSettings settings = ReadSettings(name, log_service_dir);
+        if (!FILESYSTEM.DirectoryExists(settings.log_dir)) {
+            LOG(ERROR)
+                << "Directory "
+                << settings.log_dir
+                << " does not exist";
+            return streams.end();
+        }
+
+        it = streams.emplace(std::piecewise_construct,
+            std::forward_as_tuple(name),
+            std::forward_as_tuple(settings,
+                winss::NotOwned(&archive_worker))).first;
+
+        if (!it->second.mutex.Lock()) {
+            LOG(ERROR)
+                << "Directory "
+                << settings.log_dir
+                << " is already being logged to";
+            streams.erase(it);
+            return streams.end();
+        }
+
+        if (!it->second.output.Open()) {
+            streams.erase(it);
+            return streams.end();
+        }
+
+        VLOG(2) << "Aggregating logs of " << name << " to " << settings.log_dir;
+        ScheduleFlush(it);
+        return it;
+    }
+
+    /**
+     * Flushes a buffered stream after the flush interval.
+     *
+     * The streams share the multiplexer instead of each having a flush
+     * thread.
+     *
+     * \param it The stream to flush.
+     */
+    void ScheduleFlush(typename std::map<std::string, Stream>::iterator it) {
+        if (it->second.settings.buffer_size == 0) {
+            return;
+        }
+
+        std::string name = it->first;
+        it->second.flush_timeout = multiplexer->AddTimeoutCallback(
+            it->second.settings.flush_interval,
+            [this, name](winss::WaitMultiplexer&) {
+            auto stream = this->streams.find(name);
+            if (stream != this->streams.end()) {
+                stream->second.writer.Flush();
+                this->ScheduleFlush(stream);
+            }
+        });
+    }
+
+    /**
+     * Closes a stream.
+     *
+     * \param it The stream to close.
+     */
+    void CloseStream(typename std::map<std::string, Stream>::iterator it) {
+        VLOG(2) << "Closing aggregated logs of " << it->first;
+        if (it->second.flush_timeout != 0) {
+            multiplexer->RemoveTimeoutCallbackById(it->second.flush_timeout);
+        }
+
+        it->second.output.Close();
+        streams.erase(it);
+    }
+
+    /**
+     * Writes a line to a stream.
+     *
+     * \param stream The stream to write to.
+     * \param data The line without the new line.
+     * \param length The length of the line.
+     * \param partial Flags if the line continues in the next chunk.
+     */
+    void WriteLine(Stream* stream, const char* data, size_t length,
+        bool partial = false) {
+        if (!partial && length > 0 && data[length - 1] == '\r') {
+            --length;
+        }
+
+        if (!stream->output.Write(winss::LogLine{ data, length, partial })) {
+            LOG(ERROR) << "Could not write to " << stream->settings.log_dir;
+        }
+    }
+
+    /**
+     * Writes a line in partial chunks when it is longer than the max line
+     * length.
+     *
+     * \param stream The stream to write to.
+     * \param data The line without the new line.
+     * \param length The length of the line.
+     */
+    void WriteSplit(Stream* stream, const char* data, size_t length) {
+        size_t max_length = stream->settings.line_length;
+        while (max_length > 0 && length > max_length) {
+            WriteLine(stream, data, max_length, true);
+            data += max_length;
+            length -= max_length;
+        }
+
+        WriteLine(stream, data, length);
+    }
+
+    /**
+     * Writes an unfinished line in partial chunks while it is longer than
+     * the max line length so it never grows without bound.
+     *
+     * \param stream The stream to write to.
+     * \param pipe The pipe with the unfinished line.
+     */
+    void WriteChunks(Stream* stream, Pipe* pipe) {
+        size_t max_length = stream->settings.line_length;
+        if (max_length == 0 || pipe->partial.size() <= max_length) {
+            return;
+        }
+
+        size_t offset = 0;
+        while (pipe->partial.size() - offset > max_length) {
+            WriteLine(stream, pipe->partial.data() + offset, max_length,
+                true);
+            offset += max_length;
+        }
+
+        pipe->partial.erase(0, offset);
+    }
+
+    /**
+     * Splits the bytes read from a pipe into lines.
+     *
+     * An unfinished line is kept until the rest of it is read.
+     *
+     * \param pipe The pipe which was read.
+     * \param data The bytes which were read.
+     */
+    void Received(Pipe* pipe, const std::vector<char>& data) {
+        auto it = streams.find(pipe->name);
+        if (it == streams.end()) {
+            return;
+        }
+
+        const char* begin = data.data();
+        const char* end = begin + data.size();
+
+        while (begin < end) {
+            const char* eol = static_cast<const char*>(
+                std::memchr(begin, '\n', end - begin));
+
+            if (eol == nullptr) {
+                pipe->partial.append(begin, end);
+                WriteChunks(&it->second, pipe);
+                break;
+            }
+
+            if (pipe->partial.empty()) {
+                WriteSplit(&it->second, begin, eol - begin);
+            } else {
+                pipe->partial.append(begin, eol);
+                WriteSplit(&it->second, pipe->partial.data(),
+                    pipe->partial.size());
+                pipe->partial.clear();
+            }
+
+            begin = eol + 1;
+        }
+    }
+
+    /**
+     * Closes a pipe and writes any unfinished line.
+     *
+     * \param it The pipe to close.
+     */
+    void ClosePipe(typename std::map<winss::HandleWrapper, Pipe>::iterator it) {
+        Pipe& pipe = it->second;
+
+        auto stream = streams.find(pipe.name);
+        if (stream != streams.end()) {
+            if (!pipe.partial.empty()) {
+                WriteSplit(&stream->second, pipe.partial.data(),
+                    pipe.partial.size());
+            }
+
+            if (--stream->second.pipes == 0 &&
+                (stream->second.removing || stopping)) {
+                CloseStream(stream);
+            }
+        }
+
+        VLOG(5) << "Closing log pipe of " << pipe.name;
+        pipe.instance.DisconnectNamedPipe();
+        pipe.instance.Close();
+        pipes.erase(it);
+    }
+
+    /**
+     * Waits for the next event of the pipe with the given handle.
+     *
+     * \param handle The event handle of the pipe.
+     */
+    void Watch(const winss::HandleWrapper& handle) {
+        multiplexer->AddTriggeredCallback(handle, [this](
+            winss::WaitMultiplexer&, const winss::HandleWrapper& h) {
+            this->Triggered(h);
+        });
+    }
+
+    /**
+     * The event handler for the pipes.
+     *
+     * \param handle The handle that triggered the event.
+     */
+    void Triggered(const winss::HandleWrapper& handle) {
+        auto it = pipes.find(handle);
+        if (it == pipes.end()) {
+            VLOG(6) << "Log pipe not found";
+            return;
+        }
+
+        Pipe& pipe = it->second;
+        winss::OverlappedResult result = pipe.instance.GetOverlappedResult();
+        if (result == REMOVE) {
+            ClosePipe(it);
+            return;
+        }
+
+        Watch(handle);
+
+        if (result == SKIP) {
+            return;
+        }
+
+        if (!pipe.instance.SetConnected() && pipe.instance.FinishRead()) {
+            Received(&pipe, pipe.instance.SwapBuffer());
+        }
+
+        pipe.instance.Read();
+    }
+
+    /**
+     * Stops the aggregator.
+     *
+     * Pipes which are connected are read until the services close them so
+     * their last lines are written, for at most kDrainTimeout.
+     */
+    void Stop() {
+        if (stopping) {
+            return;
+        }
+
+        stopping = true;
+
+        for (auto it = pipes.begin(); it != pipes.end(); ++it) {
+            if (!it->second.instance.IsConnected()) {
+                it->second.instance.Closing();
+            }
+        }
+
+        for (auto it = streams.begin(); it != streams.end();) {
+            if (it->second.pipes == 0) {
+                auto closed = it++;
+                CloseStream(closed);
+            } else {
+                ++it;
+            }
+        }
+
+        if (!pipes.empty()) {
+            multiplexer->AddTimeoutCallback(kDrainTimeout,
+                [this](winss::WaitMultiplexer&) {
+                this->CloseAll();
+            }, kTimeoutGroup);
+        }
+    }
+
+    /**
+     * Closes every pipe and stream straight away.
+     */
+    void CloseAll() {
+        while (!pipes.empty()) {
+            auto it = pipes.begin();
+            multiplexer->RemoveTriggeredCallback(it->first);
+            ClosePipe(it);
+        }
+
+        while (!streams.empty()) {
+            CloseStream(streams.begin());
+        }
+    }
+
+ public:
+    /** The logging script of a log definition. */
+    static constexpr const char kScriptFile[7] = "script";
+    /** The timeout group for the multiplexer. */
+    static constexpr const char kTimeoutGroup[15] = "log-aggregator";
+    /** The time to wait for services to close their pipes when stopping. */
+    static const DWORD kDrainTimeout = 5000;
+
+    /**
+     * Log aggregator constructor.
+     *
+     * \param multiplexer The shared multiplexer.
+     * \param pipe_name The base name of the pipes.
+     */
+    LogAggregatorTmpl(winss::NotOwningPtr<winss::WaitMultiplexer> multiplexer,
+        const winss::PipeName& pipe_name) : multiplexer(multiplexer),
+        pipe_name(pipe_name) {
+        multiplexer->AddStopCallback([this](winss::WaitMultiplexer&) {
+            this->Stop();
+        });
+    }
+
+    LogAggregatorTmpl(const LogAggregatorTmpl&) = delete;  /**< No copy. */
+    LogAggregatorTmpl(LogAggregatorTmpl&&) = delete;  /**< No move. */
+
+    /**
+     * Adds a pipe for the logs of a service.
+     *
+     * A service which already has a stream gets another pipe to the same
+     * stream so a restarted supervisor does not lose the old output.
+     *
+     * \param name The name of the service.
+     * \param log_service_dir The log directory of the service definition.
+     * \return The write end of the pipe or an empty handle on failure.
+     */
+    winss::HandleWrapper Add(const std::string& name,
+        const fs::path& log_service_dir) override {
+        if (stopping) {
+            return winss::HandleWrapper();
+        }
+
+        auto stream = OpenStream(name, log_service_dir);
+        if (stream == streams.end()) {
+            return winss::HandleWrapper();
+        }
+
+        winss::PipeName name_of_pipe =
+            pipe_name.Append(std::to_string(++generation));
+
+        TPipeInstance new_instance;
+        winss::HandleWrapper handle = new_instance.GetHandle();
+        auto it = pipes.emplace(handle, Pipe{
+            std::move(new_instance), name, std::string()
+        }).first;
+
+        if (!it->second.instance.CreateNamedPipe(name_of_pipe)) {
+            pipes.erase(it);
+            if (stream->second.pipes == 0) {
+                CloseStream(stream);
+            }
+            return winss::HandleWrapper();
+        }
+
+        stream->second.pipes++;
+        Watch(handle);
+
+        HANDLE client = WINDOWS.CreateFile(
+            const_cast<char*>(name_of_pipe.Get().c_str()), GENERIC_WRITE,
+            0, nullptr, OPEN_EXISTING, 0, nullptr);
+
+        if (client == INVALID_HANDLE_VALUE) {
+            VLOG(1) << "CreateFile failed: " << WINDOWS.GetLastError();
+            it->second.instance.Closing();
+            return winss::HandleWrapper();
+        }
+
+        return winss::HandleWrapper(client);
+    }
+
+    /**
+     * Closes the logs of a service once its pipes are closed.
+     *
+     * \param name The name of the service.
+     */
+    void Remove(const std::string& name) override {
+        auto it = streams.find(name);
+        if (it == streams.end()) {
+            return;
+        }
+
+        if (it->second.pipes == 0) {
+            CloseStream(it);
+        } else {
+            it->second.removing = true;
+        }
+    }
+
+    /**
+     * Gets the number of open streams.
+     *
+     * \return The number of streams.
+     */
+    virtual size_t StreamCount() const {
+        return streams.size();
+    }
+
+    /**
+     * Gets the number of open pipes.
+     *
+     * \return The number of pipes.
+     */
+    virtual size_t PipeCount() const {
+        return pipes.size();
+    }
+
+    /**
+     * Closes every pipe and stream.
+     */
+    virtual ~LogAggregatorTmpl() {
+        CloseAll();
+    }
+
+    /** No copy. */
+    LogAggregatorTmpl& operator=(const LogAggregatorTmpl&) = delete;
+    /** No move. */
+    LogAggregatorTmpl& operator=(LogAggregatorTmpl&&) = delete;
+};
+
+/**
+ * Concrete log aggregator implementation.
+ */
+typedef LogAggregatorTmpl<winss::InboundPipeInstance, winss::PathMutex,
+    winss::LogStreamWriter> LogAggregator;
+}  // namespace winss
+
+#endif  // LIB_WINSS_LOG_LOG_AGGREGATOR_HPP_
@@ -0,0 +1,263 @@
+/*
+ * Copyright 2016-2017 Morgan Stanley
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "log_archiver.hpp"
+#include <windows.h>
+#include <filesystem>
+#include <algorithm>
+#include <cstdlib>
+#include <mutex>
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "easylogging/easylogging++.hpp"
+#include "../filesystem_interface.hpp"
+#include "../not_owning_ptr.hpp"
+#include "log_settings.hpp"
+
+namespace fs = std::experimental::filesystem;
+
+constexpr const char winss::LogArchiver::kExtension[3];
+
+void winss::LogArchiveWorker::Start() {
+    if (!worker.joinable()) {
+        stopping = false;
+        worker = std::thread(&LogArchiveWorker::WorkLoop, this);
+    }
+}
+
+void winss::LogArchiveWorker::Schedule(winss::LogArchiver* archiver) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (std::find(queue.begin(), queue.end(), archiver) == queue.end()) {
+        queue.push_back(archiver);
+        changed.notify_one();
+    }
+}
+
+void winss::LogArchiveWorker::Drain(winss::LogArchiver* archiver) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!worker.joinable()) {
+        queue.erase(std::remove(queue.begin(), queue.end(), archiver),
+            queue.end());
+        return;
+    }
+
+    done.wait(lock, [this, archiver]() {
+        return running != archiver &&
+            std::find(queue.begin(), queue.end(), archiver) == queue.end();
+    });
+}
+
+void winss::LogArchiveWorker::WorkLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        changed.wait(lock, [this]() { return stopping || !queue.empty(); });
+
+        if (queue.empty()) {
+            break;
+        }
+
+        running = queue.front();
+        queue.pop_front();
+
+        lock.unlock();
+        running->Work();
+        lock.lock();
+
+        running = nullptr;
+        done.notify_all();
+    }
+}
+
+void winss::LogArchiveWorker::Stop() {
+    if (worker.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            changed.notify_one();
+        }
+
+        worker.join();
+    }
+}
+
+winss::LogArchiveWorker::~LogArchiveWorker() {
+    Stop();
+}
+
+winss::LogArchiver::LogArchiver(const winss::LogSettings& settings,
+    const std::string& prefix) : settings(settings),
+    pattern("^" + prefix + "([\\d]+)\\.\\w$"),
+    worker(winss::NotOwned(&own_worker)) {}
+
+winss::LogArchiver::LogArchiver(const winss::LogSettings& settings,
+    const std::string& prefix,
+    winss::NotOwningPtr<winss::LogArchiveWorker> worker) :
+    settings(settings), pattern("^" + prefix + "([\\d]+)\\.\\w$"),
+    worker(worker) {}
+
+void winss::LogArchiver::Start() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        loading = true;
+    }
+
+    worker->Start();
+    worker->Schedule(this);
+}
+
+void winss::LogArchiver::Add(const fs::path& file, unsigned __int64 time) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back({ file, time });
+    }
+
+    worker->Schedule(this);
+}
+
+size_t winss::LogArchiver::Count() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return archives.size();
+}
+
+unsigned __int64 winss::LogArchiver::TotalSize() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return total_size;
+}
+
+void winss::LogArchiver::Load() {
+    VLOG(3) << "Indexing archives in " << settings.log_dir;
+
+    std::vector<winss::LogArchiveFile> found;
+    for (const fs::path& file : FILESYSTEM.GetFiles(settings.log_dir)) {
+        std::string s = file.filename().string();
+        std::smatch match;
+        if (std::regex_search(s, match, pattern) && match.size() > 1) {
+            std::string m = match[1].str();
+            unsigned __int64 time = std::strtoull(m.c_str(), nullptr, 10);
+            found.push_back({ file, time, FILESYSTEM.FileSize(file) });
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const winss::LogArchiveFile& archive : found) {
+        Index(archive);
+    }
+
+    VLOG(3)
+        << "Found "
+        << archives.size()
+        << " archives using "
+        << total_size
+        << " bytes";
+}
+
+bool winss::LogArchiver::IsIndexed(unsigned __int64 time) const {
+    auto it = std::lower_bound(archives.begin(), archives.end(), time,
+        [](const winss::LogArchiveFile& f, unsigned __int64 t) {
+        return f.time < t;
+    });
+
+    return it != archives.end() && it->time == time;
+}
+
+void winss::LogArchiver::Index(const winss::LogArchiveFile& archive) {
+    auto it = std::lower_bound(archives.begin(), archives.end(), archive,
+        [](const winss::LogArchiveFile& f1,
+            const winss::LogArchiveFile& f2) {
+        return f1.time < f2.time;
+    });
+
+    if (it != archives.end() && it->time == archive.time) {
+        return;
+    }
+
+    archives.insert(it, archive);
+    total_size += archive.size;
+}
+
+void winss::LogArchiver::Prune() {
+    while (true) {
+        winss::LogArchiveFile oldest;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            bool over_size = settings.total_size > 0 &&
+                total_size > settings.total_size;
+
+            if (archives.size() <= settings.number && !over_size) {
+                return;
+            }
+
+            oldest = archives.front();
+            archives.pop_front();
+            total_size -= oldest.size;
+        }
+
+        VLOG(3) << "Removing archive " << oldest.file;
+        FILESYSTEM.Remove(oldest.file);
+    }
+}
+
+void winss::LogArchiver::Work() {
+    bool load = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        load = loading;
+        loading = false;
+    }
+
+    if (load) {
+        Load();
+    }
+
+    Prune();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!pending.empty()) {
+        winss::LogArchiveFile archive = pending.front();
+        pending.pop_front();
+
+        if (IsIndexed(archive.time)) {
+            VLOG(6) << "Archive " << archive.file << " is already indexed";
+            continue;
+        }
+
+        if (archive.size == 0) {
+            lock.unlock();
+            archive.size = FILESYSTEM.FileSize(archive.file);
+            lock.lock();
+        }
+
+        Index(archive);
+
+        lock.unlock();
+        Prune();
+        lock.lock();
+    }
+}
+
+void winss::LogArchiver::Stop() {
+    worker->Drain(this);
+
+    if (worker.Get() == &own_worker) {
+        own_worker.Stop();
+    }
+}
+
+winss::LogArchiver::~LogArchiver() {
+    Stop();
+}
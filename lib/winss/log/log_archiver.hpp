@@ -0,0 +1,246 @@
+/*
+ * Copyright 2016-2017 Morgan Stanley
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIB_WINSS_LOG_LOG_ARCHIVER_HPP_
+#define LIB_WINSS_LOG_LOG_ARCHIVER_HPP_
+
+#include <windows.h>
+#include <filesystem>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <regex>
+#include <string>
+#include <thread>
+#include "../not_owning_ptr.hpp"
+#include "log_settings.hpp"
+
+namespace fs = std::experimental::filesystem;
+
+namespace winss {
+/**
+ * An archived log file.
+ *
+ * Holds information about an archived log file in the log directory.
+ */
+struct LogArchiveFile {
+    fs::path file;  ///< The archive file name.
+    unsigned __int64 time;  ///< The time the archive was taken.
+    unsigned __int64 size;  ///< The archive size in bytes.
+};
+
+class LogArchiver;
+
+/**
+ * A background worker which runs the file system work of log archivers.
+ *
+ * An archiver with work to do is queued and the worker runs it until it
+ * has nothing left. Many archivers can share one worker so a process which
+ * writes to many log directories does not need a thread for each of them.
+ */
+class LogArchiveWorker {
+ private:
+    std::deque<winss::LogArchiver*> queue;  /**< Archivers with work. */
+    winss::LogArchiver* running = nullptr;  /**< The archiver being run. */
+    bool stopping = false;  /**< Flags if the worker should stop. */
+    std::mutex mutex;  /**< Guards the queue. */
+    std::condition_variable changed;  /**< Signals the worker. */
+    std::condition_variable done;  /**< Signals an archiver has run. */
+    std::thread worker;  /**< The background worker. */
+
+    /**
+     * The background worker loop.
+     */
+    void WorkLoop();
+
+ public:
+    /**
+     * Log archive worker constructor.
+     */
+    LogArchiveWorker() {}
+    LogArchiveWorker(const LogArchiveWorker&) = delete;  /**< No copy. */
+    LogArchiveWorker(LogArchiveWorker&&) = delete;  /**< No move. */
+
+    /**
+     * Starts the background worker if it is not running.
+     */
+    virtual void Start();
+
+    /**
+     * Queues an archiver which has work to do.
+     *
+     * \param archiver The archiver to run.
+     */
+    virtual void Schedule(winss::LogArchiver* archiver);
+
+    /**
+     * Waits until the archiver has finished its queued work.
+     *
+     * If the worker is not running the queued work is dropped instead.
+     *
+     * \param archiver The archiver to wait for.
+     */
+    virtual void Drain(winss::LogArchiver* archiver);
+
+    /**
+     * Finishes the queued work and stops the background worker.
+     */
+    virtual void Stop();
+
+    /**
+     * Stops the background worker.
+     */
+    virtual ~LogArchiveWorker();
+
+    /** No copy. */
+    LogArchiveWorker& operator=(const LogArchiveWorker&) = delete;
+    /** No move. */
+    LogArchiveWorker& operator=(LogArchiveWorker&&) = delete;
+};
+
+/**
+ * Keeps track of the archived log files and removes the old ones.
+ *
+ * The log directory is only listed once when the archiver starts. After
+ * that each rotation adds its archive and its size to a sorted in-memory
+ * index so the number and total size limits are enforced without listing
+ * the directory again. All of the file system work happens on a background
+ * worker so the logger can keep draining its input while old archives are
+ * removed. The archiver has its own worker unless it is given a shared one.
+ */
+class LogArchiver {
+ private:
+    const winss::LogSettings& settings;  /**< Logger settings. */
+    std::regex pattern;  /**< The archive file name pattern. */
+    std::deque<winss::LogArchiveFile> archives;  /**< Archives by time. */
+    std::deque<winss::LogArchiveFile> pending;  /**< Archives to add. */
+    unsigned __int64 total_size = 0;  /**< The indexed archive bytes. */
+    bool loading = false;  /**< Flags if the directory should be listed. */
+    mutable std::mutex mutex;  /**< Guards the pending and index. */
+    winss::LogArchiveWorker own_worker;  /**< The worker if not shared. */
+    /** The worker which runs the archiver. */
+    winss::NotOwningPtr<winss::LogArchiveWorker> worker;
+
+    /**
+     * Lists the log directory and indexes the existing archives.
+     */
+    void Load();
+
+    /**
+     * Checks if an archive taken at the given time is in the index.
+     *
+     * The mutex must be held by the caller.
+     *
+     * \param time The time the archive was taken.
+     * \return True if the archive is indexed otherwise false.
+     */
+    bool IsIndexed(unsigned __int64 time) const;
+
+    /**
+     * Adds an archive to the sorted index.
+     *
+     * The mutex must be held by the caller.
+     *
+     * \param archive The archive to index.
+     */
+    void Index(const winss::LogArchiveFile& archive);
+
+    /**
+     * Removes the oldest archives which exceed the settings.
+     */
+    void Prune();
+
+ public:
+    /** The extension of archives. */
+    static constexpr const char kExtension[3] = ".u";
+
+    /**
+     * Log archiver constructor.
+     *
+     * \param settings The logger settings.
+     * \param prefix The archive file name prefix.
+     */
+    LogArchiver(const winss::LogSettings& settings,
+        const std::string& prefix);
+
+    /**
+     * Log archiver constructor with a shared worker.
+     *
+     * \param settings The logger settings.
+     * \param prefix The archive file name prefix.
+     * \param worker The shared background worker.
+     */
+    LogArchiver(const winss::LogSettings& settings,
+        const std::string& prefix,
+        winss::NotOwningPtr<winss::LogArchiveWorker> worker);
+    LogArchiver(const LogArchiver&) = delete;  /**< No copy. */
+    LogArchiver(LogArchiver&&) = delete;  /**< No move. */
+
+    /**
+     * Starts the background worker which indexes the existing archives.
+     */
+    virtual void Start();
+
+    /**
+     * Adds a newly rotated archive.
+     *
+     * \param file The archive file.
+     * \param time The time the archive was taken.
+     */
+    virtual void Add(const fs::path& file, unsigned __int64 time);
+
+    /**
+     * Runs the pending work on the background worker.
+     *
+     * The directory is listed first if the archiver was started, then the
+     * pending archives are indexed and the oldest archives are removed.
+     */
+    virtual void Work();
+
+    /**
+     * Gets the number of archives in the index.
+     *
+     * \return The number of archives.
+     */
+    virtual size_t Count() const;
+
+    /**
+     * Gets the total size of the archives in the index.
+     *
+     * \return The total size in bytes.
+     */
+    virtual unsigned __int64 TotalSize() const;
+
+    /**
+     * Finishes the pending work and stops the background worker.
+     *
+     * A shared worker keeps running for the other archivers.
+     */
+    virtual void Stop();
+
+    /**
+     * Stops the background worker.
+     */
+    virtual ~LogArchiver();
+
+    /** No copy. */
+    LogArchiver& operator=(const LogArchiver&) = delete;
+    /** No move. */
+    LogArchiver& operator=(LogArchiver&&) = delete;
+};
+}  // namespace winss
+
+#endif  // LIB_WINSS_LOG_LOG_ARCHIVER_HPP_
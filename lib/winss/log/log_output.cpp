@@ -0,0 +1,270 @@
+/*
+ * Copyright 2016-2017 Morgan Stanley
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "log_output.hpp"
+#include <windows.h>
+#include <filesystem>
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include "easylogging/easylogging++.hpp"
+#include "../filesystem_interface.hpp"
+#include "../not_owning_ptr.hpp"
+#include "log_archiver.hpp"
+#include "log_settings.hpp"
+#include "log_stream_wrapper.hpp"
+#include "log_timestamp.hpp"
+
+namespace fs = std::experimental::filesystem;
+
+namespace {
+/**
+ * Gets the length of the UTF-8 sequence at the start of the data.
+ *
+ * Overlong forms, surrogates and code points past U+10FFFF are invalid.
+ *
+ * \param data The bytes starting with a lead byte of at least 0x80.
+ * \param length The number of bytes available.
+ * \return The sequence length or 0 if it is not valid UTF-8.
+ */
+size_t Utf8Length(const unsigned char* data, size_t length) {
+    unsigned char c = data[0];
+    size_t size = 0;
+    unsigned char low = 0x80;
+    unsigned char high = 0xBF;
+
+    if (c >= 0xC2 && c <= 0xDF) {
+        size = 2;
+    } else if (c >= 0xE0 && c <= 0xEF) {
+        size = 3;
+        if (c == 0xE0) {
+            low = 0xA0;
+        } else if (c == 0xED) {
+            high = 0x9F;
+        }
+    } else if (c >= 0xF0 && c <= 0xF4) {
+        size = 4;
+        if (c == 0xF0) {
+            low = 0x90;
+        } else if (c == 0xF4) {
+            high = 0x8F;
+        }
+    } else {
+        return 0;
+    }
+
+    if (length < size || data[1] < low || data[1] > high) {
+        return 0;
+    }
+
+    for (size_t i = 2; i < size; ++i) {
+        if (data[i] < 0x80 || data[i] > 0xBF) {
+            return 0;
+        }
+    }
+
+    return size;
+}
+
+/**
+ * Escapes the characters as a JSON string without quotes.
+ *
+ * Bytes which are not part of a valid UTF-8 sequence are escaped as \\u00XX
+ * so the output is always valid UTF-8. The output is passed in chunks so
+ * the characters which need no escaping are never copied.
+ *
+ * \param data The characters to escape.
+ * \param length The number of characters.
+ * \param write The function which is given each chunk of the output.
+ */
+template<typename TWrite>
+void Escape(const char* data, size_t length, TWrite write) {
+    static const char kHex[] = "0123456789abcdef";
+    size_t start = 0;
+
+    for (size_t i = 0; i < length; ++i) {
+        unsigned char c = static_cast<unsigned char>(data[i]);
+        if (c >= 0x80) {
+            size_t valid = Utf8Length(
+                reinterpret_cast<const unsigned char*>(data + i),
+                length - i);
+            if (valid > 0) {
+                i += valid - 1;
+                continue;
+            }
+        } else if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+
+        if (i > start) {
+            write(data + start, i - start);
+        }
+
+        if (c == '"' || c == '\\') {
+            char escape[2] = { '\\', static_cast<char>(c) };
+            write(escape, sizeof(escape));
+        } else {
+            char escape[6] = {
+                '\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 0xF]
+            };
+            write(escape, sizeof(escape));
+        }
+
+        start = i + 1;
+    }
+
+    if (length > start) {
+        write(data + start, length - start);
+    }
+}
+}  // namespace
+
+constexpr const char winss::LogOutput::kCurrentLog[8];
+constexpr const char winss::LogOutput::kArchivePrefix[2];
+
+winss::LogOutput::LogOutput(
+    winss::NotOwningPtr<winss::LogStreamWriter> writer,
+    const winss::LogSettings& settings) : writer(writer),
+    settings(settings), archiver(settings, kArchivePrefix) {
+    current = settings.log_dir / fs::path(kCurrentLog);
+}
+
+winss::LogOutput::LogOutput(
+    winss::NotOwningPtr<winss::LogStreamWriter> writer,
+    const winss::LogSettings& settings,
+    winss::NotOwningPtr<winss::LogArchiveWorker> archive_worker) :
+    writer(writer), settings(settings),
+    archiver(settings, kArchivePrefix, archive_worker) {
+    current = settings.log_dir / fs::path(kCurrentLog);
+}
+
+bool winss::LogOutput::IsExpired() const {
+    if (settings.rotate_interval == 0) {
+        return false;
+    }
+
+    return std::chrono::steady_clock::now() - opened >=
+        std::chrono::seconds(settings.rotate_interval);
+}
+
+bool winss::LogOutput::Rotate() {
+    writer->Close();
+
+    auto now = std::chrono::system_clock::now();
+    unsigned __int64 time = now.time_since_epoch().count();
+    std::ostringstream os;
+    os << kArchivePrefix << time << winss::LogArchiver::kExtension;
+
+    fs::path archive = settings.log_dir / os.str();
+
+    if (FILESYSTEM.Rename(current, archive)) {
+        archiver.Add(archive, time);
+    }
+
+    opened = std::chrono::steady_clock::now();
+    return writer->Open(current);
+}
+
+void winss::LogOutput::WriteRecord(const winss::LogLine& line) {
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    long long nanoseconds =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+
+    char header[112];
+    int length = std::snprintf(header, sizeof(header),
+        ",\"seq\":%llu,\"ts\":%lld,\"len\":%llu,%s\"line\":\"",
+        static_cast<unsigned long long>(sequence++), nanoseconds,
+        static_cast<unsigned long long>(line.length),
+        line.partial ? "\"partial\":true," : "");
+
+    writer->Write(record_prefix.data(), record_prefix.length());
+    writer->Write(header, length);
+    WriteEscaped(line.data, line.length);
+    writer->Write("\"}", 2);
+}
+
+void winss::LogOutput::WriteEscaped(const char* data, size_t length) {
+    Escape(data, length, [this](const char* chunk, size_t size) {
+        writer->Write(chunk, size);
+    });
+}
+
+bool winss::LogOutput::Open() {
+    if (!writer->Open(current)) {
+        return false;
+    }
+
+    opened = std::chrono::steady_clock::now();
+    size = 0;
+    sequence = 0;
+    continuing = false;
+
+    if (settings.json) {
+        record_prefix = "{\"service\":\"";
+        Escape(settings.service.data(), settings.service.length(),
+            [this](const char* chunk, size_t size) {
+            record_prefix.append(chunk, size);
+        });
+        record_prefix += "\"";
+    }
+
+    archiver.Start();
+    return true;
+}
+
+bool winss::LogOutput::Write(const winss::LogLine& line) {
+    if (writer->GetPos() > size) {
+        if (!Rotate()) {
+            return false;
+        }
+    }
+
+    size = settings.file_size;
+
+    if (IsExpired() && writer->GetPos() > 0) {
+        if (!Rotate()) {
+            return false;
+        }
+    }
+
+    if (settings.json) {
+        WriteRecord(line);
+        writer->WriteLine();
+        return true;
+    }
+
+    if (settings.timestamp && !continuing) {
+        char stamp[winss::LogTimestamp::kLength + 1];
+        size_t length = timestamp.Format(
+            std::chrono::system_clock::now(), stamp);
+        stamp[length++] = ' ';
+        writer->Write(stamp, length);
+    }
+
+    writer->Write(line.data, line.length);
+    if (!line.partial) {
+        writer->WriteLine();
+    }
+
+    continuing = line.partial;
+    return true;
+}
+
+void winss::LogOutput::Close() {
+    writer->Close();
+    archiver.Stop();
+}
@@ -0,0 +1,163 @@
+/*
+ * Copyright 2016-2017 Morgan Stanley
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIB_WINSS_LOG_LOG_OUTPUT_HPP_
+#define LIB_WINSS_LOG_LOG_OUTPUT_HPP_
+
+#include <filesystem>
+#include <chrono>
+#include <string>
+#include "../not_owning_ptr.hpp"
+#include "log_archiver.hpp"
+#include "log_settings.hpp"
+#include "log_stream_wrapper.hpp"
+#include "log_timestamp.hpp"
+
+namespace fs = std::experimental::filesystem;
+
+namespace winss {
+/**
+ * Writes log lines to a log directory.
+ *
+ * Owns the current log file of a log directory. It will occasionally rotate
+ * the log file when it gets too big or too old and hand the archive to the
+ * archiver.
+ */
+class LogOutput {
+ protected:
+    winss::NotOwningPtr<winss::LogStreamWriter> writer;  /**< Log output. */
+    const winss::LogSettings& settings;  /**< Logger settings. */
+    fs::path current;    /**< Current log file. */
+    winss::LogArchiver archiver;  /**< Tracks and removes old archives. */
+    winss::LogTimestamp timestamp;  /**< Log line timestamp formatter. */
+    /** The time the current log file was opened. */
+    std::chrono::steady_clock::time_point opened;
+    /** The rotate size which is 0 until the first line is written. */
+    std::streamoff size = 0;
+    std::string record_prefix;  /**< The escaped start of each record. */
+    unsigned __int64 sequence = 0;  /**< The next record sequence number. */
+    bool continuing = false;  /**< Flags if the last line was partial. */
+
+    /**
+     * Checks if the current log file has been open longer than the rotate
+     * interval.
+     *
+     * \return True if the current file should be rotated otherwise false.
+     */
+    bool IsExpired() const;
+
+    /**
+     * Rotates the current log file.
+     *
+     * Current file is closed and renamed then a new current file is opened.
+     * Old archives are removed by the archiver in the background.
+     *
+     * \return True if the rotation succeeded and false otherwise.
+     */
+    bool Rotate();
+
+    /**
+     * Writes the line as a NDJSON record.
+     *
+     * The record holds the service name, the sequence number, the time in
+     * nanoseconds since the epoch, the line length in bytes, whether the
+     * line is partial and the line. The line is escaped as it is written so
+     * it is never copied.
+     *
+     * \param line The line without the line ending.
+     */
+    void WriteRecord(const winss::LogLine& line);
+
+    /**
+     * Writes the characters escaped as a JSON string without quotes.
+     *
+     * Bytes which are not part of a valid UTF-8 sequence, such as those of
+     * an MBCS code page, are escaped as \\u00XX so the record stays valid
+     * UTF-8.
+     *
+     * \param data The characters to write.
+     * \param length The number of characters.
+     */
+    void WriteEscaped(const char* data, size_t length);
+
+ public:
+    static constexpr const char kCurrentLog[8] = "current";  /**< Log file. */
+    static constexpr const char kArchivePrefix[2] = "@";  /**< File prefix. */
+
+    /**
+     * Log output constructor.
+     *
+     * \param writer The log stream writer.
+     * \param settings The logger settings.
+     */
+    LogOutput(winss::NotOwningPtr<winss::LogStreamWriter> writer,
+        const winss::LogSettings& settings);
+
+    /**
+     * Log output constructor with a shared archive worker.
+     *
+     * \param writer The log stream writer.
+     * \param settings The logger settings.
+     * \param archive_worker The worker which removes old archives.
+     */
+    LogOutput(winss::NotOwningPtr<winss::LogStreamWriter> writer,
+        const winss::LogSettings& settings,
+        winss::NotOwningPtr<winss::LogArchiveWorker> archive_worker);
+
+    LogOutput(const LogOutput&) = delete;  /**< No copy. */
+    LogOutput(LogOutput&&) = delete;  /**< No move. */
+
+    /**
+     * Opens the current log file and starts the archiver.
+     *
+     * The log directory should be locked by the caller.
+     *
+     * \return True if the current log file was opened otherwise false.
+     */
+    virtual bool Open();
+
+    /**
+     * Writes a line to the current log file.
+     *
+     * The current log file is rotated first if it is too big or, when a
+     * rotate interval is set, too old. An existing current log file is
+     * rotated before the first line so every run starts a new file.
+     *
+     * A partial line is written without a line ending so the next chunk
+     * continues it, even if the file is rotated in between. As records
+     * are always whole lines, each chunk is a separate partial record.
+     *
+     * \param line The line without the line ending.
+     * \return True if the line was written otherwise false.
+     */
+    virtual bool Write(const winss::LogLine& line);
+
+    /**
+     * Closes the current log file and stops the archiver.
+     *
+     * The archiver finishes removing old archives before this returns.
+     */
+    virtual void Close();
+
+    /** Default destructor. */
+    virtual ~LogOutput() {}
+
+    LogOutput& operator=(const LogOutput&) = delete;  /**< No copy. */
+    LogOutput& operator=(LogOutput&&) = delete;  /**< No move. */
+};
+}  // namespace winss
+
+#endif  // LIB_WINSS_LOG_LOG_OUTPUT_HPP_
@@ -17,7 +17,9 @@
 #ifndef LIB_WINSS_LOG_LOG_SETTINGS_HPP_
 #define LIB_WINSS_LOG_LOG_SETTINGS_HPP_
 
+#include <windows.h>
 #include <filesystem>
+#include <string>
 
 namespace fs = std::experimental::filesystem;
 
@@ -28,7 +30,14 @@ namespace winss {
 struct LogSettings {
     unsigned int number = 10;  /**< The number of archives to keep. */
     unsigned int file_size = 99999;  /**< The max file size in bytes. */
+    unsigned __int64 total_size = 0;  /**< The max archive bytes or 0. */
+    unsigned int rotate_interval = 0;  /**< The max seconds per file or 0. */
+    unsigned int line_length = 0;  /**< The max line length or 0. */
     bool timestamp = false;  /**< Prepend a ISO 8601 timestamp. */
+    bool json = false;  /**< Write each line as a NDJSON record. */
+    std::string service;  /**< The service name of the records. */
+    unsigned int buffer_size = 0;  /**< The write buffer size in bytes. */
+    unsigned int flush_interval = 1000;  /**< The max ms between flushes. */
     fs::path log_dir = ".";  /**< The log directory. */
 };
 }  // namespace winss
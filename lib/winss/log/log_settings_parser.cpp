@@ -62,10 +62,78 @@ winss::LogSettings winss::LogSettingsParser::Parse(
                     LOG(WARNING) << "File size '" << value << "' is invalid";
                 }
                 break;
+            case 'S':
+                try {
+                    unsigned __int64 total_size =
+                        std::stoull(value, nullptr, 10);
+
+                    VLOG(3) << "Log archive total size set to " << total_size;
+                    settings.total_size = total_size;
+                } catch (const std::exception&) {
+                    LOG(WARNING) << "Total size '" << value << "' is invalid";
+                }
+                break;
+            case 'r':
+                try {
+                    unsigned int interval = std::stoul(value, nullptr, 10);
+
+                    VLOG(3) << "Log rotate interval set to " << interval;
+                    settings.rotate_interval = interval;
+                } catch (const std::exception&) {
+                    LOG(WARNING)
+                        << "Rotate interval '" << value << "' is invalid";
+                }
+                break;
+            case 'l':
+                try {
+                    unsigned int line_length =
+                        std::stoul(value, nullptr, 10);
+
+                    if (line_length > 0 && line_length < 256) {
+                        line_length = 256;
+                    }
+
+                    VLOG(3) << "Log line length set to " << line_length;
+                    settings.line_length = line_length;
+                } catch (const std::exception&) {
+                    LOG(WARNING)
+                        << "Line length '" << value << "' is invalid";
+                }
+                break;
+            case 'b':
+                try {
+                    unsigned int buffer_size = std::stoul(value, nullptr, 10);
+
+                    VLOG(3) << "Log buffer size set to " << buffer_size;
+                    settings.buffer_size = buffer_size;
+                } catch (const std::exception&) {
+                    LOG(WARNING) << "Buffer size '" << value << "' is invalid";
+                }
+                break;
+            case 'f':
+                try {
+                    unsigned int interval = std::stoul(value, nullptr, 10);
+
+                    if (interval == 0) {
+                        interval = 1;
+                    }
+
+                    VLOG(3) << "Log flush interval set to " << interval;
+                    settings.flush_interval = interval;
+                } catch (const std::exception&) {
+                    LOG(WARNING)
+                        << "Flush interval '" << value << "' is invalid";
+                }
+                break;
             case 'T':
                 settings.timestamp = true;
                 VLOG(3) << "Prepend ISO 8601 timestamp";
                 break;
+            case 'J':
+                settings.json = true;
+                settings.service = value;
+                VLOG(3) << "Write NDJSON records for service " << value;
+                break;
             case '.':
                 settings.log_dir = directive;
                 VLOG(3) << "Log dir set to " << directive;
@@ -15,10 +15,17 @@
  */
 
 #include "log_stream_wrapper.hpp"
+#include <windows.h>
+#include <cstring>
 #include <filesystem>
-#include <iostream>
 #include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
 #include "easylogging/easylogging++.hpp"
+#include "../windows_interface.hpp"
+#include "../handle_wrapper.hpp"
+#include "../event_wrapper.hpp"
 
 namespace fs = std::experimental::filesystem;
 
@@ -26,14 +33,100 @@ bool winss::LogStreamReader::IsEOF() const {
     return eof;
 }
 
-std::string winss::LogStreamReader::GetLine() {
-    std::string line;
-    if (!std::getline(std::cin, line)) {
-        eof = true;
+bool winss::LogStreamReader::ReadBlock() {
+    if (input == nullptr) {
+        input = WINDOWS.GetStdHandle(STD_INPUT_HANDLE);
+        buffer.resize(kBlockSize);
     }
+
+    if (start > 0) {
+        std::memmove(buffer.data(), buffer.data() + start, end - start);
+        end -= start;
+        start = 0;
+    }
+
+    if (end == buffer.size()) {
+        VLOG(5) << "Growing log line buffer to " << buffer.size() * 2;
+        buffer.resize(buffer.size() * 2);
+    }
+
+    DWORD read = 0;
+    if (!WINDOWS.ReadFile(input, buffer.data() + end,
+        static_cast<DWORD>(buffer.size() - end), &read, nullptr)) {
+        VLOG(3) << "Log input closed: " << WINDOWS.GetLastError();
+        return false;
+    }
+
+    end += read;
+    return read > 0;
+}
+
+winss::LogLine winss::LogStreamReader::GetLine() {
+    size_t scanned = start;
+
+    while (true) {
+        const char* data = buffer.data();
+        const char* found = nullptr;
+
+        if (scanned < end) {
+            found = static_cast<const char*>(
+                std::memchr(data + scanned, '\n', end - scanned));
+        }
+
+        if (found != nullptr) {
+            size_t index = found - data;
+            winss::LogLine line{ data + start, index - start };
+
+            if (line.length > 0 && line.data[line.length - 1] == '\r') {
+                --line.length;
+            }
+
+            if (max_length == 0 || line.length <= max_length) {
+                start = index + 1;
+                return line;
+            }
+        }
+
+        if (max_length > 0 && end - start > max_length) {
+            VLOG(5) << "Splitting log line longer than " << max_length;
+            winss::LogLine line{ data + start, max_length, true };
+            start += max_length;
+            return line;
+        }
+
+        scanned = end - start;
+
+        if (!ReadBlock()) {
+            break;
+        }
+    }
+
+    eof = true;
+
+    if (start == end) {
+        return winss::LogLine{ nullptr, 0 };
+    }
+
+    winss::LogLine line{ buffer.data() + start, end - start };
+    start = end;
     return line;
 }
 
+winss::LogStreamWriter::LogStreamWriter(size_t buffer_size) :
+    buffer_size(buffer_size) {
+    buffer.reserve(buffer_size);
+}
+
+winss::LogStreamWriter::LogStreamWriter(size_t buffer_size,
+    DWORD flush_interval, const winss::EventWrapper& close_event) :
+    buffer_size(buffer_size), flush_interval(flush_interval),
+    close_event(close_event) {
+    if (buffer_size > 0) {
+        buffer.reserve(buffer_size);
+        flusher = std::thread(&LogStreamWriter::FlushLoop, this);
+    }
+}
+
 bool winss::LogStreamWriter::Open(fs::path log_path) {
     try {
         file_stream.open(log_path,
@@ -47,22 +140,99 @@ bool winss::LogStreamWriter::Open(fs::path log_path) {
 }
 
 void winss::LogStreamWriter::Write(const std::string& line) {
-    file_stream << line;
+    Write(line.data(), line.length());
+}
+
+void winss::LogStreamWriter::Write(const char* data, size_t length) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (buffer_size == 0) {
+        file_stream.write(data, length);
+        return;
+    }
+
+    buffer.insert(buffer.end(), data, data + length);
+    if (buffer.size() >= buffer_size) {
+        FlushBuffer();
+    }
 }
 
 void winss::LogStreamWriter::WriteLine() {
-    file_stream << std::endl;
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (buffer_size == 0) {
+        file_stream << std::endl;
+        return;
+    }
+
+    buffer.push_back('\n');
+    if (closing || buffer.size() >= buffer_size) {
+        FlushBuffer();
+    }
 }
 
 std::streamoff winss::LogStreamWriter::GetPos() {
-    return file_stream.tellp();
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::streamoff pos = file_stream.tellp();
+    if (pos < 0) {
+        return pos;
+    }
+
+    return pos + buffer.size();
 }
 
-void winss::LogStreamWriter::Close() {
+void winss::LogStreamWriter::FlushBuffer() {
+    if (!buffer.empty()) {
+        file_stream.write(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+
     file_stream.flush();
+}
+
+void winss::LogStreamWriter::Flush() {
+    std::lock_guard<std::mutex> lock(mutex);
+    FlushBuffer();
+}
+
+void winss::LogStreamWriter::FlushLoop() {
+    std::vector<winss::HandleWrapper> handles = {
+        stop.GetHandle(), close_event.GetHandle()
+    };
+
+    while (true) {
+        winss::WaitResult result = winss::HandleWrapper::Wait(flush_interval,
+            handles.begin(), handles.end());
+
+        if (result.state == winss::TIMEOUT) {
+            Flush();
+            continue;
+        }
+
+        if (result.state == winss::SUCCESS &&
+            result.handle == close_event.GetHandle()) {
+            VLOG(3) << "Close signal received so flushing every line";
+            std::lock_guard<std::mutex> lock(mutex);
+            closing = true;
+            FlushBuffer();
+        }
+
+        break;
+    }
+}
+
+void winss::LogStreamWriter::Close() {
+    std::lock_guard<std::mutex> lock(mutex);
+    FlushBuffer();
     file_stream.close();
 }
 
 winss::LogStreamWriter::~LogStreamWriter() {
+    if (flusher.joinable()) {
+        stop.Set();
+        flusher.join();
+    }
+
     Close();
 }
@@ -17,25 +17,68 @@
 #ifndef LIB_WINSS_LOG_LOG_STREAM_WRAPPER_HPP_
 #define LIB_WINSS_LOG_LOG_STREAM_WRAPPER_HPP_
 
+#include <windows.h>
 #include <filesystem>
 #include <fstream>
 #include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include "../event_wrapper.hpp"
 
 namespace fs = std::experimental::filesystem;
 
 namespace winss {
+/**
+ * A log line held by the reader.
+ *
+ * The characters are owned by the reader and are only valid until the next
+ * line is read. The line does not include the line terminator. A line which
+ * is longer than the maximum line length is split into chunks and every
+ * chunk but the last is flagged as partial.
+ */
+struct LogLine {
+    const char* data;  /**< The line characters or null if no line. */
+    size_t length;  /**< The number of characters. */
+    bool partial;  /**< Flags if the line continues in the next chunk. */
+};
+
 /**
  * A stream reader for reading logs.
+ *
+ * Reads large blocks from the STDIN handle and splits them into lines
+ * without copying. A line which spans blocks is moved to the front of the
+ * buffer before the next block is read so it stays contiguous. When a
+ * maximum line length is set, longer lines are returned in chunks so the
+ * buffer never grows past twice the larger of the block size and the
+ * maximum line length.
  */
 class LogStreamReader {
  private:
     bool eof = false;  /**< End of file flag. */
+    HANDLE input = nullptr;  /**< The STDIN handle. */
+    std::vector<char> buffer;  /**< The block buffer. */
+    size_t start = 0;  /**< The start of the unread bytes. */
+    size_t end = 0;  /**< The end of the read bytes. */
+    size_t max_length;  /**< The max line length or 0 for no limit. */
+
+    /**
+     * Reads the next block into the buffer.
+     *
+     * \return True if any bytes were read otherwise false.
+     */
+    bool ReadBlock();
 
  public:
+    static const DWORD kBlockSize = 65536;  /**< The read block size. */
+
     /**
      * Log stream reader constructor.
+     *
+     * \param max_length The max line length or 0 for no limit.
      */
-    LogStreamReader() {}
+    explicit LogStreamReader(size_t max_length = 0) :
+        max_length(max_length) {}
     LogStreamReader(const LogStreamReader&) = delete;  /**< No copy. */
     LogStreamReader(LogStreamReader&&) = delete;  /**< No move. */
 
@@ -50,30 +93,82 @@ class LogStreamReader {
      * Blocks for the next log line.
      *
      * This function will block the current thread until a new line character
-     * occurs or the stream reaches the end.
+     * occurs or the stream reaches the end. A trailing carriage return is
+     * removed from the line. A line longer than the max line length is
+     * returned as partial chunks of the max line length.
      *
-     * \return The next log line as a string.
+     * \return The next log line which has no data at the end of the stream.
      */
-    virtual std::string GetLine();
+    virtual winss::LogLine GetLine();
 
     /** No copy. */
     LogStreamReader& operator=(const LogStreamReader&) = delete;
     /** No move. */
     LogStreamReader& operator=(LogStreamReader&&) = delete;
+
+    /**
+     * Log stream reader destructor.
+     */
+    virtual ~LogStreamReader() {}
 };
 
 /**
  * A stream writer for writing logs.
+ *
+ * By default every line is flushed to the file as soon as it is written.
+ * When a buffer size is given the lines are kept in memory until the buffer
+ * is full or the flush interval passes without a flush. A close signal
+ * flushes what is buffered and every line after it is flushed straight away.
  */
 class LogStreamWriter {
  private:
-    std::ofstream file_stream;
+    std::ofstream file_stream;  /**< The log file stream. */
+    size_t buffer_size = 0;  /**< The flush threshold in bytes. */
+    DWORD flush_interval = 0;  /**< The max time between flushes. */
+    bool closing = false;  /**< Flags if the close signal was set. */
+    std::vector<char> buffer;  /**< The bytes not yet written. */
+    std::mutex mutex;  /**< Guards the buffer and file stream. */
+    winss::EventWrapper stop;  /**< Stops the flush thread. */
+    winss::EventWrapper close_event;  /**< The close signal. */
+    std::thread flusher;  /**< The thread flushing on an interval. */
+
+    /**
+     * Writes the buffer to the file stream and flushes it.
+     *
+     * The mutex must be held by the caller.
+     */
+    void FlushBuffer();
+
+    /**
+     * The flush thread loop.
+     */
+    void FlushLoop();
 
  public:
     /**
      * Log stream writer constructor.
      */
     LogStreamWriter() {}
+
+    /**
+     * Buffered log stream writer constructor without a flush thread.
+     *
+     * The owner must call Flush at least as often as the lines should
+     * reach the file.
+     *
+     * \param buffer_size The buffer size in bytes or 0 to flush every line.
+     */
+    explicit LogStreamWriter(size_t buffer_size);
+
+    /**
+     * Buffered log stream writer constructor.
+     *
+     * \param buffer_size The buffer size in bytes or 0 to flush every line.
+     * \param flush_interval The max time in milliseconds between flushes.
+     * \param close_event The event set when the process should close.
+     */
+    LogStreamWriter(size_t buffer_size, DWORD flush_interval,
+        const winss::EventWrapper& close_event);
     LogStreamWriter(const LogStreamWriter&) = delete;  /**< No copy. */
     LogStreamWriter(LogStreamWriter&&) = delete;  /**< No move. */
 
@@ -92,6 +187,14 @@ class LogStreamWriter {
      */
     virtual void Write(const std::string& line);
 
+    /**
+     * Writes the given characters to the log stream.
+     *
+     * \param[in] data The characters to write.
+     * \param[in] length The number of characters.
+     */
+    virtual void Write(const char* data, size_t length);
+
     /**
     * Writes a line terminator to the stream.
     */
@@ -100,12 +203,19 @@ class LogStreamWriter {
     /**
      * Gets the current position in the stream.
      *
+     * The position includes any bytes which are still buffered.
+     *
      * \return The current stream position.
      */
     virtual std::streamoff GetPos();
 
+    /**
+     * Writes any buffered bytes to the file.
+     */
+    virtual void Flush();
+
      /**
-     * Closes the currently open stream.
+     * Flushes and closes the currently open stream.
      */
     virtual void Close();
 
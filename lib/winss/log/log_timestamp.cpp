@@ -0,0 +1,54 @@
+/*
+ * Copyright 2016-2017 Morgan Stanley
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "log_timestamp.hpp"
+#include <windows.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include "date/date.hpp"
+
+size_t winss::LogTimestamp::Format(
+    const std::chrono::system_clock::time_point& time_point, char* out) {
+    auto ms = date::floor<std::chrono::milliseconds>(time_point);
+    auto secs = date::floor<std::chrono::seconds>(ms);
+
+    if (secs.time_since_epoch().count() != second) {
+        auto days = date::floor<date::days>(secs);
+        date::year_month_day ymd(days);
+        auto time = date::make_time(secs - days);
+
+        std::snprintf(prefix, sizeof(prefix),
+            "%04d-%02u-%02u %02d:%02d:%02d.",
+            static_cast<int>(ymd.year()),
+            static_cast<unsigned>(ymd.month()),
+            static_cast<unsigned>(ymd.day()),
+            static_cast<int>(time.hours().count()),
+            static_cast<int>(time.minutes().count()),
+            static_cast<int>(time.seconds().count()));
+
+        second = secs.time_since_epoch().count();
+    }
+
+    int millis = static_cast<int>((ms - secs).count());
+
+    std::memcpy(out, prefix, kLength - 3);
+    out[kLength - 3] = static_cast<char>('0' + millis / 100);
+    out[kLength - 2] = static_cast<char>('0' + millis / 10 % 10);
+    out[kLength - 1] = static_cast<char>('0' + millis % 10);
+
+    return kLength;
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2016-2017 Morgan Stanley
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIB_WINSS_LOG_LOG_TIMESTAMP_HPP_
+#define LIB_WINSS_LOG_LOG_TIMESTAMP_HPP_
+
+#include <windows.h>
+#include <chrono>
+
+namespace winss {
+/**
+ * Formats ISO 8601 timestamps for log lines.
+ *
+ * The date and time up to the second is formatted once per second and only
+ * the milliseconds are written for each line. The output is the same as
+ * Utils::ConvertToISOString but is written to a caller buffer.
+ */
+class LogTimestamp {
+ public:
+    static const size_t kLength = 23;  /**< The timestamp length. */
+
+ private:
+    __int64 second = -1;  /**< The second the prefix was formatted for. */
+    char prefix[kLength + 1];  /**< The formatted date and time. */
+
+ public:
+    /**
+     * Log timestamp constructor.
+     */
+    LogTimestamp() {}
+    LogTimestamp(const LogTimestamp&) = delete;  /**< No copy. */
+    LogTimestamp(LogTimestamp&&) = delete;  /**< No move. */
+
+    /**
+     * Formats the time point as YYYY-MM-DD HH:MM:SS.mmm.
+     *
+     * \param[in] time_point The time point to format.
+     * \param[out] out The buffer which must hold at least kLength chars.
+     * \return The number of characters written.
+     */
+    size_t Format(const std::chrono::system_clock::time_point& time_point,
+        char* out);
+
+    /** No copy. */
+    LogTimestamp& operator=(const LogTimestamp&) = delete;
+    /** No move. */
+    LogTimestamp& operator=(LogTimestamp&&) = delete;
+};
+}  // namespace winss
+
+#endif  // LIB_WINSS_LOG_LOG_TIMESTAMP_HPP_
@@ -25,6 +25,7 @@
 #include "pipe_name.hpp"
 #include "handle_wrapper.hpp"
 #include "pipe_server.hpp"
+#include "completion_port.hpp"
 #include "not_owning_ptr.hpp"
 
 namespace winss {
@@ -56,6 +57,25 @@ class PipeClient {
     winss::NotOwningPtr<winss::WaitMultiplexer> multiplexer;
     /** Listeners for the pipe client. */
     std::vector<winss::NotOwningPtr<TListener>> listeners;
+    /** The completion port to use instead of the event waits. */
+    winss::CompletionPort* completion_port = nullptr;
+
+    /**
+     * Waits for the next event of the pipe instance.
+     */
+    void Watch() {
+        auto callback = [this](winss::WaitMultiplexer&,
+            const winss::HandleWrapper& handle) {
+            this->Triggered(handle);
+        };
+
+        if (completion_port != nullptr) {
+            completion_port->AddTriggeredCallback(instance.GetHandle(),
+                callback);
+        } else {
+            multiplexer->AddTriggeredCallback(instance.GetHandle(), callback);
+        }
+    }
 
     /**
      * Called when an event is triggered.
@@ -101,10 +121,7 @@ class PipeClient {
                 return;
             }
 
-            multiplexer->AddTriggeredCallback(handle, [this](
-                winss::WaitMultiplexer&, const winss::HandleWrapper& handle) {
-                Triggered(handle);
-            });
+            Watch();
 
             if (result != SKIP) {
                 Triggered();
@@ -119,12 +136,24 @@ class PipeClient {
      * \param config The pipe client confog.
      */
     explicit PipeClient(const PipeClientConfig& config) :
-        pipe_name(config.pipe_name), multiplexer(config.multiplexer) {
-    }
+        pipe_name(config.pipe_name), multiplexer(config.multiplexer) {}
 
     PipeClient(const PipeClient&) = delete;  /**< No copy. */
     PipeClient(PipeClient&&) = delete;  /**< No move. */
 
+    /**
+     * Uses a completion port for IO instead of waiting on the event.
+     *
+     * This must be set before the client connects.
+     *
+     * \param port The completion port.
+     */
+    virtual void SetCompletionPort(
+        winss::NotOwningPtr<winss::CompletionPort> port) {
+        completion_port = port.Get();
+        instance.SetCompletionPort(port);
+    }
+
     /**
      * Add a listener to the client.
      *
@@ -153,11 +182,7 @@ class PipeClient {
             });
 
             if (instance.CreateFile(pipe_name)) {
-                multiplexer->AddTriggeredCallback(instance.GetHandle(),
-                    [this](winss::WaitMultiplexer&,
-                        const winss::HandleWrapper& handle) {
-                    this->Triggered(handle);
-                });
+                Watch();
                 if (instance.SetConnected()) {
                     Connected();
                 }
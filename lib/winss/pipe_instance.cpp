@@ -16,13 +16,16 @@
 
 #include "pipe_instance.hpp"
 #include <windows.h>
+#include <algorithm>
+#include <memory>
 #include <vector>
-#include <queue>
 #include <utility>
 #include "easylogging/easylogging++.hpp"
 #include "windows_interface.hpp"
 #include "handle_wrapper.hpp"
 #include "pipe_name.hpp"
+#include "completion_port.hpp"
+#include "not_owning_ptr.hpp"
 
 winss::PipeInstance::PipeInstance() {
     buffer.resize(kBufferSize);
@@ -48,6 +51,7 @@ winss::PipeInstance::PipeInstance(winss::PipeInstance&& instance) {
     buffer.swap(instance.buffer);
     bytes = instance.bytes;
     instance.bytes = 0;
+    completion_port = instance.completion_port;
 }
 
 bool winss::PipeInstance::IsPendingIO() const {
@@ -76,6 +80,39 @@ bool winss::PipeInstance::SetConnected() {
     return true;
 }
 
+bool winss::PipeInstance::Signal() {
+    if (completion_port != nullptr) {
+        return completion_port->Post(overlapped.hEvent);
+    }
+
+    return WINDOWS.SetEvent(overlapped.hEvent);
+}
+
+void winss::PipeInstance::SignalCompleted() {
+    if (completion_port == nullptr) {
+        WINDOWS.SetEvent(overlapped.hEvent);
+    }
+}
+
+void winss::PipeInstance::CancelIO() {
+    if (handle == nullptr || !pending_io) {
+        return;
+    }
+
+    VLOG(5) << "Cancelling pending IO of pipe instance: " << handle;
+
+    if (!WINDOWS.CancelIoEx(handle, &overlapped)) {
+        DWORD error = WINDOWS.GetLastError();
+        if (error != ERROR_NOT_FOUND) {
+            VLOG(1) << "CancelIoEx failed: " << error;
+        }
+    }
+
+    DWORD cancelled = 0;
+    WINDOWS.GetOverlappedResult(handle, &overlapped, &cancelled, TRUE);
+    pending_io = false;
+}
+
 bool winss::PipeInstance::CheckError() {
     if (handle == nullptr) {
         return false;
@@ -89,7 +126,7 @@ bool winss::PipeInstance::CheckError() {
             VLOG(1) << "overlapped failed: " << error << " (closing)";
         }
         close = true;
-        WINDOWS.SetEvent(overlapped.hEvent);
+        Signal();
         return false;
     } else {
         pending_io = true;
@@ -135,6 +172,11 @@ winss::OverlappedResult winss::PipeInstance::GetOverlappedResult() {
     return CONTINUE;
 }
 
+void winss::PipeInstance::SetCompletionPort(
+    winss::NotOwningPtr<winss::CompletionPort> port) {
+    completion_port = port.Get();
+}
+
 bool winss::PipeInstance::CreateNamedPipe(const winss::PipeName& pipe_name) {
     if (handle != nullptr) {
         return false;
@@ -153,6 +195,22 @@ bool winss::PipeInstance::CreateNamedPipe(const winss::PipeName& pipe_name) {
         return false;
     }
 
+    if (completion_port != nullptr &&
+        !completion_port->Associate(handle, overlapped.hEvent)) {
+        return false;
+    }
+
+    return ConnectNamedPipe();
+}
+
+bool winss::PipeInstance::ConnectNamedPipe() {
+    if (handle == nullptr || connected) {
+        return false;
+    }
+
+    close = false;
+    bytes = 0;
+
     VLOG(5) << "Connecting pipe instance: " << handle;
 
     if (WINDOWS.ConnectNamedPipe(handle, &overlapped)) {
@@ -170,7 +228,7 @@ bool winss::PipeInstance::CreateNamedPipe(const winss::PipeName& pipe_name) {
         return true;
     case ERROR_PIPE_CONNECTED:
         // Client is already connected, so signal an event.
-        if (WINDOWS.SetEvent(overlapped.hEvent))
+        if (Signal())
             return true;
     default:
         VLOG(1) << "ConnectNamedPipe failed: " << error;
@@ -195,6 +253,11 @@ bool winss::PipeInstance::CreateFile(const winss::PipeName& pipe_name) {
         return false;
     }
 
+    if (completion_port != nullptr &&
+        !completion_port->Associate(handle, overlapped.hEvent)) {
+        return false;
+    }
+
     return true;
 }
 
@@ -202,11 +265,13 @@ void winss::PipeInstance::Closing() {
     if (handle != nullptr && !close) {
         VLOG(6) << "Signalling close of pipe instance: " << handle;
         close = true;
-        WINDOWS.SetEvent(overlapped.hEvent);
+        Signal();
     }
 }
 
 void winss::PipeInstance::DisconnectNamedPipe() {
+    CancelIO();
+
     if (handle != nullptr && connected) {
         VLOG(5) << "Disconnecting pipe instance: " << handle;
         WINDOWS.DisconnectNamedPipe(handle);
@@ -216,9 +281,14 @@ void winss::PipeInstance::DisconnectNamedPipe() {
 
 bool winss::PipeInstance::Close() {
     if (handle != nullptr && handle != INVALID_HANDLE_VALUE) {
+        CancelIO();
         WINDOWS.CloseHandle(handle);
         VLOG(5) << "Closed pipe instance: " << handle;
 
+        if (completion_port != nullptr) {
+            completion_port->Disassociate(overlapped.hEvent);
+        }
+
         if (overlapped.hEvent != nullptr &&
             overlapped.hEvent != INVALID_HANDLE_VALUE) {
             WINDOWS.CloseHandle(overlapped.hEvent);
@@ -255,6 +325,7 @@ winss::PipeInstance& winss::PipeInstance::operator=(
     buffer.swap(instance.buffer);
     bytes = instance.bytes;
     instance.bytes = 0;
+    completion_port = instance.completion_port;
     return *this;
 }
 
@@ -268,7 +339,173 @@ winss::OutboundPipeInstance::OutboundPipeInstance() :
 winss::OutboundPipeInstance::OutboundPipeInstance(
     winss::OutboundPipeInstance&& instance) :
     winss::PipeInstance::PipeInstance(std::move(instance)) {
-    message_queue = std::move(instance.message_queue);
+    writting = instance.writting;
+    instance.writting = false;
+    messages = std::move(instance.messages);
+    instance.messages.clear();
+    next_message = instance.next_message;
+    instance.next_message = 0;
+    message_offset = instance.message_offset;
+    instance.message_offset = 0;
+    ring.swap(instance.ring);
+    ring_start = instance.ring_start;
+    instance.ring_start = 0;
+    ring_used = instance.ring_used;
+    instance.ring_used = 0;
+    chunk_size = instance.chunk_size;
+    instance.chunk_size = 0;
+    backlog = instance.backlog;
+    instance.backlog = 0;
+    backlog_limit = instance.backlog_limit;
+    backlog_policy = instance.backlog_policy;
+    counters = instance.counters;
+    instance.counters = {};
+}
+
+DWORD winss::OutboundPipeInstance::ChunkSize() const {
+    const winss::QueuedMessage& message = messages[next_message];
+    if (message.shared) {
+        return static_cast<DWORD>(std::min<size_t>(kBufferSize,
+            message.shared->size() - message_offset));
+    }
+
+    return static_cast<DWORD>(std::min<size_t>(message.size,
+        ring.size() - ring_start));
+}
+
+bool winss::OutboundPipeInstance::CopyToRing(const char* data,
+    size_t size) {
+    if (size > kCoalesceSize || size > kBufferSize - ring_used) {
+        return false;
+    }
+
+    if (ring.empty()) {
+        ring.resize(kBufferSize);
+    }
+
+    if (ring_used == 0) {
+        ring_start = 0;
+    }
+
+    size_t end = (ring_start + ring_used) % ring.size();
+    size_t first = std::min(size, ring.size() - end);
+    std::memcpy(&ring[end], data, first);
+    std::memcpy(&ring[0], data + first, size - first);
+    ring_used += size;
+
+    if (messages.size() > FirstUnsent() && !messages.back().shared) {
+        messages.back().size += size;
+        messages.back().count++;
+    } else {
+        messages.push_back({ winss::PipeMessage(), size, 1 });
+    }
+
+    return true;
+}
+
+void winss::OutboundPipeInstance::DisconnectNamedPipe() {
+    winss::PipeInstance::DisconnectNamedPipe();
+
+    writting = false;
+    messages.clear();
+    next_message = 0;
+    message_offset = 0;
+    ring_start = 0;
+    ring_used = 0;
+    chunk_size = 0;
+    backlog = 0;
+    counters = {};
+}
+
+size_t winss::OutboundPipeInstance::FirstUnsent() const {
+    if (chunk_size > 0 || message_offset > 0) {
+        return next_message + 1;
+    }
+
+    return next_message;
+}
+
+size_t winss::OutboundPipeInstance::Drop(size_t index) {
+    winss::QueuedMessage& message = messages[index];
+
+    if (!message.shared) {
+        // The ring bytes of the earlier messages come first.
+        size_t offset = 0;
+        for (size_t i = next_message; i < index; ++i) {
+            if (!messages[i].shared) {
+                offset += messages[i].size;
+            }
+        }
+
+        size_t ring_size = ring.size();
+        for (size_t i = offset; i + message.size < ring_used; ++i) {
+            ring[(ring_start + i) % ring_size] =
+                ring[(ring_start + i + message.size) % ring_size];
+        }
+
+        ring_used -= message.size;
+    }
+
+    backlog -= message.size;
+    size_t count = message.count;
+    messages.erase(messages.begin() + index);
+
+    if (!HasMessages()) {
+        messages.clear();
+        next_message = 0;
+    }
+
+    return count;
+}
+
+bool winss::OutboundPipeInstance::ReserveBacklog(size_t size) {
+    if (backlog_limit == 0 || backlog + size <= backlog_limit) {
+        return true;
+    }
+
+    switch (backlog_policy) {
+    case BACKLOG_DISCONNECT:
+        if (!close) {
+            VLOG(1)
+                << "Pipe "
+                << handle
+                << " backlog of "
+                << backlog
+                << " bytes is over the limit (closing)";
+            counters.disconnected++;
+            Closing();
+        }
+        return false;
+    case BACKLOG_COALESCE:
+        while (FirstUnsent() < messages.size()) {
+            counters.coalesced += Drop(FirstUnsent());
+        }
+        break;
+    default:
+        while (backlog + size > backlog_limit &&
+            FirstUnsent() < messages.size()) {
+            counters.dropped += Drop(FirstUnsent());
+        }
+        break;
+    }
+
+    VLOG(6) << "Pipe " << handle << " backlog is now " << backlog << " bytes";
+    return true;
+}
+
+void winss::OutboundPipeInstance::SetBacklog(size_t limit,
+    winss::BacklogPolicy policy) {
+    backlog_limit = limit;
+    backlog_policy = policy;
+}
+
+size_t winss::OutboundPipeInstance::GetBacklog() const {
+    return backlog;
+}
+
+const winss::BacklogCounters&
+    winss::OutboundPipeInstance::GetBacklogCounters() const {
+    return counters;
 }
 
 bool winss::OutboundPipeInstance::Queue(const std::vector<char>& data) {
@@ -276,25 +513,40 @@ bool winss::OutboundPipeInstance::Queue(const std::vector<char>& data) {
         return false;
     }
 
-    size_t parts = data.size() / kBufferSize;
-    auto start = data.begin();
-    for (size_t i = 0; i < parts; i++) {
-        auto end = start + kBufferSize;
-        std::vector<char> data(start, end);
-        message_queue.push(std::move(data));
-        start = end;
+    if (!ReserveBacklog(data.size())) {
+        return false;
+    }
+
+    if (!CopyToRing(data.data(), data.size())) {
+        messages.push_back({
+            std::make_shared<const std::vector<char>>(data), data.size(), 1
+        });
+    }
+
+    backlog += data.size();
+    return true;
+}
+
+bool winss::OutboundPipeInstance::QueueMessage(
+    const winss::PipeMessage& message) {
+    if (!connected || !message || message->empty()) {
+        return false;
+    }
+
+    if (!ReserveBacklog(message->size())) {
+        return false;
     }
 
-    if (start != data.end()) {
-        std::vector<char> data(start, data.end());
-        message_queue.push(std::move(data));
+    if (!CopyToRing(message->data(), message->size())) {
+        messages.push_back({ message, message->size(), 1 });
     }
 
+    backlog += message->size();
     return true;
 }
 
 bool winss::OutboundPipeInstance::HasMessages() const {
-    return !message_queue.empty();
+    return next_message < messages.size();
 }
 
 bool winss::OutboundPipeInstance::IsWriting() const {
@@ -306,32 +558,58 @@ bool winss::OutboundPipeInstance::FinishWrite() {
         return false;
     }
 
-    if (!message_queue.empty()) {
-        message_queue.pop();
-        return !message_queue.empty();
+    if (HasMessages()) {
+        winss::QueuedMessage& message = messages[next_message];
+        bool written = false;
+
+        if (message.shared) {
+            message_offset += chunk_size;
+            written = message_offset >= message.size;
+        } else {
+            ring_start = (ring_start + chunk_size) % ring.size();
+            ring_used -= chunk_size;
+            message.size -= chunk_size;
+            written = message.size == 0;
+        }
+
+        backlog -= chunk_size;
+        chunk_size = 0;
+
+        if (written) {
+            message.shared.reset();
+            message_offset = 0;
+            if (++next_message == messages.size()) {
+                messages.clear();
+                next_message = 0;
+            }
+        }
+
+        return HasMessages();
     }
 
     return false;
 }
 
 bool winss::OutboundPipeInstance::Write() {
-    if (!connected || message_queue.empty()) {
+    if (!connected || !HasMessages()) {
         return false;
     }
 
     writting = true;
     pending_io = false;
 
-    const std::vector<char>& write_buffer = message_queue.front();
+    const winss::QueuedMessage& message = messages[next_message];
+    const char* write_buffer = message.shared ?
+        message.shared->data() + message_offset : &ring[ring_start];
+    chunk_size = ChunkSize();
 
-    VLOG(5) << "Sending " << write_buffer.size() << " bytes";
+    VLOG(5) << "Sending " << chunk_size << " bytes";
 
-    bool success = WINDOWS.WriteFile(handle, &write_buffer[0],
-        static_cast<DWORD>(write_buffer.size()), &bytes,
-        &overlapped);
+    bool success = WINDOWS.WriteFile(handle, write_buffer, chunk_size,
+        &bytes, &overlapped);
 
     if (success) {
-        WINDOWS.SetEvent(overlapped.hEvent);
+        SignalCompleted();
         return true;
     } else {
         return CheckError();
@@ -350,7 +628,7 @@ void winss::OutboundPipeInstance::Read() {
         &overlapped);
 
     if (success) {
-        WINDOWS.SetEvent(overlapped.hEvent);
+        SignalCompleted();
     } else {
         CheckError();
     }
@@ -361,7 +639,25 @@ winss::OutboundPipeInstance& winss::OutboundPipeInstance::operator=(
     winss::PipeInstance::operator=(std::move(instance));
     writting = instance.writting;
     instance.writting = false;
-    message_queue = std::move(instance.message_queue);
+    messages = std::move(instance.messages);
+    instance.messages.clear();
+    next_message = instance.next_message;
+    instance.next_message = 0;
+    message_offset = instance.message_offset;
+    instance.message_offset = 0;
+    ring.swap(instance.ring);
+    ring_start = instance.ring_start;
+    instance.ring_start = 0;
+    ring_used = instance.ring_used;
+    instance.ring_used = 0;
+    chunk_size = instance.chunk_size;
+    instance.chunk_size = 0;
+    backlog = instance.backlog;
+    instance.backlog = 0;
+    backlog_limit = instance.backlog_limit;
+    backlog_policy = instance.backlog_policy;
+    counters = instance.counters;
+    instance.counters = {};
     return *this;
 }
 
@@ -394,7 +690,7 @@ void winss::InboundPipeInstance::Read() {
         static_cast<DWORD>(buffer.size()), &bytes, &overlapped);
 
     if (success) {
-        WINDOWS.SetEvent(overlapped.hEvent);
+        SignalCompleted();
     } else {
         CheckError();
     }
@@ -18,12 +18,15 @@
 #define LIB_WINSS_PIPE_INSTANCE_HPP_
 
 #include <windows.h>
+#include <memory>
 #include <vector>
-#include <queue>
 #include "handle_wrapper.hpp"
 #include "pipe_name.hpp"
+#include "not_owning_ptr.hpp"
 
 namespace winss {
+class CompletionPort;
+
 /**
  * The result of the overlapped operation.
  */
@@ -33,6 +36,39 @@ enum OverlappedResult {
     SKIP       /**< Wait till next result. */
 };
 
+/**
+ * An immutable message which is shared by every instance it is queued to.
+ */
+typedef std::shared_ptr<const std::vector<char>> PipeMessage;
+
+/**
+ * A message queued on an outbound pipe instance.
+ */
+struct QueuedMessage {
+    /** The shared message or empty if the bytes are in the ring buffer. */
+    winss::PipeMessage shared;
+    size_t size;  /**< The unwritten bytes in the ring buffer. */
+    size_t count;  /**< The number of messages coalesced into this one. */
+};
+
+/**
+ * What to do when a client falls behind its backlog limit.
+ */
+enum BacklogPolicy {
+    BACKLOG_DROP_OLDEST,  /**< Drop the oldest unsent messages. */
+    BACKLOG_COALESCE,     /**< Replace the unsent messages with the latest. */
+    BACKLOG_DISCONNECT    /**< Disconnect the client. */
+};
+
+/**
+ * The counters of messages lost to the backlog limit.
+ */
+struct BacklogCounters {
+    size_t dropped;       /**< Messages dropped. */
+    size_t coalesced;     /**< Messages replaced by a later message. */
+    size_t disconnected;  /**< Clients disconnected. */
+};
+
 /**
  * The pipe instance which is shared between client and server.
  */
@@ -45,6 +81,8 @@ class PipeInstance {
     bool close = false;        /**< Flagged if instance is closing. */
     std::vector<char> buffer;  /**< The instance byte buffer. */
     DWORD bytes = 0;           /**< The bytes read or written. */
+    /** The completion port if one is used which is not owned. */
+    winss::CompletionPort* completion_port = nullptr;
 
     /**
      * Checks if error is a real error or pending IO operation.
@@ -53,9 +91,35 @@ class PipeInstance {
      */
     bool CheckError();
 
+    /**
+     * Signals the instance without any IO.
+     *
+     * \return True if the instance was signalled otherwise false.
+     */
+    bool Signal();
+
+    /**
+     * Signals the instance for IO which completed straight away.
+     *
+     * A completion port already queues a completion so this only sets the
+     * event when no completion port is used.
+     */
+    void SignalCompleted();
+
+    /**
+     * Cancels any pending IO and waits for Windows to finish with it.
+     *
+     * The buffers and overlapped structure are in use by Windows until the
+     * IO has finished so this must be called before they are released or
+     * the instance is reused.
+     */
+    void CancelIO();
+
  public:
     static const DWORD kBufferSize = 4096;  /**< The pipe buffer. */
     static const DWORD kTimeout = 5000;     /**< The pipe timeout. */
+    /** The largest message which is copied and coalesced. */
+    static const DWORD kCoalesceSize = 256;
 
     /**
      * Creates a new pipe instance.
@@ -114,6 +178,18 @@ class PipeInstance {
      */
     virtual OverlappedResult GetOverlappedResult();
 
+    /**
+     * Uses a completion port for IO instead of waiting on the event.
+     *
+     * The event handle is still used as the key of the completions so the
+     * instance can be found the same way. This must be set before the pipe
+     * is created.
+     *
+     * \param port The completion port.
+     */
+    virtual void SetCompletionPort(
+        winss::NotOwningPtr<winss::CompletionPort> port);
+
     /**
      * Creates the Windows named pipe server.
      *
@@ -122,6 +198,16 @@ class PipeInstance {
      */
     virtual bool CreateNamedPipe(const winss::PipeName& pipe_name);
 
+    /**
+     * Waits for a client to connect to the named pipe server instance.
+     *
+     * This is called when the pipe is created and can be called again
+     * after the client has been disconnected to reuse the instance.
+     *
+     * \return True if connecting otherwise false.
+     */
+    virtual bool ConnectNamedPipe();
+
     /**
      * Creates a Windows named pipe client.
      *
@@ -139,12 +225,16 @@ class PipeInstance {
 
     /**
      * DIsconnect the client from the pipe server.
+     *
+     * Any pending IO is cancelled first.
      */
     virtual void DisconnectNamedPipe();
 
     /**
      * Close the pipe connection.
      *
+     * Any pending IO is cancelled first.
+     *
      * \return True if the close changed the state otherwise false.
      */
     virtual bool Close();
@@ -170,7 +260,65 @@ class PipeInstance {
 class OutboundPipeInstance : public PipeInstance {
  private:
     bool writting = false;  /**< Flags if writing. */
-    std::queue<std::vector<char>> message_queue;  /**< The message queue. */
+    /** The queued messages which are only cleared once all are written. */
+    std::vector<winss::QueuedMessage> messages;
+    size_t next_message = 0;  /**< The message being written. */
+    size_t message_offset = 0;  /**< The bytes of it already written. */
+    std::vector<char> ring;  /**< The ring buffer of small messages. */
+    size_t ring_start = 0;  /**< The first unwritten byte in the ring. */
+    size_t ring_used = 0;  /**< The unwritten bytes in the ring. */
+    DWORD chunk_size = 0;  /**< The bytes of the write in progress. */
+    size_t backlog = 0;  /**< The unwritten bytes of all messages. */
+    size_t backlog_limit = 0;  /**< The backlog limit or 0 if unbounded. */
+    /** What to do when the backlog limit is reached. */
+    winss::BacklogPolicy backlog_policy = BACKLOG_DROP_OLDEST;
+    winss::BacklogCounters counters{};  /**< The backlog counters. */
+
+    /**
+     * Gets the size of the next chunk of the message being written.
+     *
+     * Ring buffer bytes are only written up to the end of the ring so the
+     * chunk is always contiguous.
+     *
+     * \return The chunk size which is at most kBufferSize.
+     */
+    DWORD ChunkSize() const;
+
+    /**
+     * Copies a small message to the end of the ring buffer.
+     *
+     * Back-to-back small messages are merged into one queued message so
+     * they are sent with a single write. A message which has been partly
+     * written is never merged into.
+     *
+     * \param data The message data.
+     * \param size The size of the message.
+     * \return True if the message was copied otherwise false if too big.
+     */
+    bool CopyToRing(const char* data, size_t size);
+
+    /**
+     * Gets the first queued message which has not been partly written.
+     *
+     * \return The index of the first unsent message.
+     */
+    size_t FirstUnsent() const;
+
+    /**
+     * Drops an unsent message from the queue.
+     *
+     * \param index The index of the message to drop.
+     * \return The number of messages which were coalesced into it.
+     */
+    size_t Drop(size_t index);
+
+    /**
+     * Applies the backlog policy before queueing a message.
+     *
+     * \param size The size of the message to queue.
+     * \return True if the message can be queued otherwise false.
+     */
+    bool ReserveBacklog(size_t size);
 
  public:
     /**
@@ -188,13 +336,61 @@ class OutboundPipeInstance : public PipeInstance {
      */
     OutboundPipeInstance(OutboundPipeInstance&& instance);
 
+    /**
+     * Disconnects the client and drops anything still queued for it.
+     */
+    void DisconnectNamedPipe();
+
+    /**
+     * Limits the bytes which can be queued for the client.
+     *
+     * Messages are dropped or coalesced a queued write at a time, so small
+     * messages which were merged together are dropped together. The
+     * message being written is never dropped so the backlog can exceed the
+     * limit by at most the newest message.
+     *
+     * \param limit The backlog limit in bytes or 0 for no limit.
+     * \param policy What to do when the limit is reached.
+     */
+    void SetBacklog(size_t limit, winss::BacklogPolicy policy);
+
+    /**
+     * Gets the bytes which are queued and not yet written.
+     *
+     * \return The backlog in bytes.
+     */
+    size_t GetBacklog() const;
+
+    /**
+     * Gets the counters of messages lost to the backlog limit.
+     *
+     * \return The backlog counters.
+     */
+    const winss::BacklogCounters& GetBacklogCounters() const;
+
     /**
      * Queue the data to be sent.
      *
+     * Small messages are copied to the ring buffer and coalesced with any
+     * other small messages queued after them.
+     *
      * \param data The data to queue.
+     * \return True if the data was queued otherwise false.
      */
     bool Queue(const std::vector<char>& data);
 
+    /**
+     * Queue a shared message to be sent.
+     *
+     * Messages larger than kCoalesceSize, or which do not fit in the ring
+     * buffer, are not copied and are written in chunks of at most
+     * kBufferSize straight from the shared buffer.
+     *
+     * \param message The message to queue.
+     * \return True if the message was queued otherwise false.
+     */
+    bool QueueMessage(const winss::PipeMessage& message);
+
     /**
      * Get if the instance has messages to send.
      *
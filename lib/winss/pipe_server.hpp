@@ -18,6 +18,7 @@
 #define LIB_WINSS_PIPE_SERVER_HPP_
 
 #include <windows.h>
+#include <memory>
 #include <vector>
 #include <utility>
 #include <map>
@@ -26,6 +27,7 @@
 #include "pipe_name.hpp"
 #include "pipe_instance.hpp"
 #include "handle_wrapper.hpp"
+#include "completion_port.hpp"
 #include "not_owning_ptr.hpp"
 
 namespace winss {
@@ -35,6 +37,12 @@ namespace winss {
 struct PipeServerConfig {
     winss::PipeName pipe_name;
     winss::NotOwningPtr<winss::WaitMultiplexer> multiplexer;
+    /** The outbound backlog limit of each client or 0 if unbounded. */
+    size_t backlog_limit;
+    /** What to do when an outbound client reaches the backlog limit. */
+    winss::BacklogPolicy backlog_policy;
+    /** The number of instances waiting for clients or 0 for one. */
+    size_t listen_count;
 };
 
 /**
@@ -48,33 +56,88 @@ template<typename TPipeInstance>
 class PipeServer {
  protected:
     bool stopping = false;  /**< Flag if the server is stopping. */
-    bool open = false;      /**< Flag if the server is open for connections. */
+    size_t listening = 0;   /**< The instances waiting for clients. */
+    size_t listen_count;    /**< The instances to keep waiting. */
 
     /** A mapping of handles to instances. */
     std::map<winss::HandleWrapper, TPipeInstance> instances;
     /** The event multiplexer for the named pipe server. */
     winss::NotOwningPtr<winss::WaitMultiplexer> multiplexer;
     winss::PipeName pipe_name;  /**< The name of the pipe. */
+    /** The completion port to use instead of the event waits. */
+    winss::CompletionPort* completion_port = nullptr;
 
     /**
-     * Open a new named pipe for a new client to connect to.
+     * Waits for the next event of the instance with the given handle.
+     *
+     * \param handle The event handle of the instance.
+     */
+    void Watch(const winss::HandleWrapper& handle) {
+        auto callback = [this](winss::WaitMultiplexer&,
+            const winss::HandleWrapper& h) {
+            this->Triggered(h);
+        };
+
+        if (completion_port != nullptr) {
+            completion_port->AddTriggeredCallback(handle, callback);
+        } else {
+            multiplexer->AddTriggeredCallback(handle, callback);
+        }
+    }
+
+    /**
+     * Open new named pipes until enough are waiting for clients.
+     *
+     * The instance is created in place so that the overlapped structure
+     * given to Windows does not move.
      */
     void StartClient() {
-        while (!stopping && !open) {
-            TPipeInstance instance;
+        while (!stopping && listening < listen_count) {
+            TPipeInstance new_instance;
+            winss::HandleWrapper handle = new_instance.GetHandle();
+            auto it = instances.emplace(handle,
+                std::move(new_instance)).first;
+            TPipeInstance& instance = it->second;
+
+            if (completion_port != nullptr) {
+                instance.SetCompletionPort(winss::NotOwned(completion_port));
+            }
+
             if (instance.CreateNamedPipe(pipe_name)) {
-                winss::HandleWrapper handle = instance.GetHandle();
-                instances.emplace(handle, std::move(instance));
-                multiplexer->AddTriggeredCallback(handle, [this](
-                    winss::WaitMultiplexer&, const winss::HandleWrapper& h) {
-                    this->Triggered(h);
-                });
-                open = true;
+                Watch(handle);
+                listening++;
                 VLOG(6) << "Pipe server clients: " << instances.size();
+            } else {
+                instances.erase(it);
             }
         }
     }
 
+    /**
+     * Waits for a new client on an instance whose client has disconnected.
+     *
+     * Disconnected instances are kept waiting as spares, up to
+     * kReuseFactor times the listen count, so the next clients are
+     * accepted without creating new named pipes. Disconnecting the client
+     * has already waited for any cancelled IO so the overlapped structure
+     * is free to reuse.
+     *
+     * \param handle The event handle of the instance.
+     * \param instance The instance to reuse.
+     * \return True if the instance was reused otherwise false.
+     */
+    bool Reuse(const winss::HandleWrapper& handle, TPipeInstance* instance) {
+        if (stopping || listening >= listen_count * kReuseFactor ||
+            !instance->ConnectNamedPipe()) {
+            return false;
+        }
+
+        Watch(handle);
+        listening++;
+        VLOG(6) << "Reusing pipe server instance";
+        return true;
+    }
+
     /**
      * Stop the pipe server.
      */
@@ -99,11 +162,16 @@ class PipeServer {
         if (it != instances.end()) {
             winss::OverlappedResult result = it->second.GetOverlappedResult();
             if (result == REMOVE) {
-                if (!it->second.IsConnected()) {
+                bool connected = it->second.IsConnected();
+                if (!connected) {
                     VLOG(1) << "Pipe server client did not connect (closing)";
-                    open = false;
+                    listening--;
                 }
+                Removed(&it->second);
                 it->second.DisconnectNamedPipe();
+                if (connected && Reuse(handle, &it->second)) {
+                    return;
+                }
                 it->second.Close();
                 instances.erase(it);
                 VLOG(6) << "Pipe server clients: " << instances.size();
@@ -111,10 +179,7 @@ class PipeServer {
                 return;
             }
 
-            multiplexer->AddTriggeredCallback(handle, [this](
-                winss::WaitMultiplexer&, const winss::HandleWrapper& h) {
-                this->Triggered(h);
-            });
+            Watch(handle);
 
             if (result == SKIP) {
                 return;
@@ -122,7 +187,7 @@ class PipeServer {
 
             if (it->second.SetConnected()) {
                 Connected(&it->second);
-                open = false;
+                listening--;
                 StartClient();
             } else {
                 Triggered(&it->second);
@@ -146,14 +211,25 @@ class PipeServer {
      */
     virtual void Triggered(TPipeInstance* instance) {}
 
+    /**
+     * Called when a client is about to be removed.
+     *
+     * \param instance The associated client instance.
+     */
+    virtual void Removed(TPipeInstance* instance) {}
+
  public:
+    /** The spare waiting instances kept as a multiple of the listen count. */
+    static const size_t kReuseFactor = 2;
+
     /**
      * Create a new pipe instance with the given config.
      *
      * \param config The pipe server config.
      */
     explicit PipeServer(const PipeServerConfig& config) :
-        pipe_name(config.pipe_name), multiplexer(config.multiplexer) {
+        listen_count(config.listen_count > 0 ? config.listen_count : 1),
+        multiplexer(config.multiplexer), pipe_name(config.pipe_name) {
         multiplexer->AddInitCallback([this](winss::WaitMultiplexer&) {
             this->StartClient();
         });
@@ -166,13 +242,25 @@ class PipeServer {
     PipeServer(const PipeServer&) = delete;  /**< No copy. */
     PipeServer(PipeServer&&) = delete;  /**< No move. */
 
+    /**
+     * Uses a completion port for IO instead of waiting on the events.
+     *
+     * This must be set before the multiplexer is started.
+     *
+     * \param port The completion port.
+     */
+    virtual void SetCompletionPort(
+        winss::NotOwningPtr<winss::CompletionPort> port) {
+        completion_port = port.Get();
+    }
+
     /**
      * Gets if the pipe server is accepting a new connection.
      *
      * \return True if the pipe server is accepting otherwise false.
      */
     virtual bool IsAccepting() const {
-        return open;
+        return listening > 0;
     }
 
     /**
@@ -215,6 +303,11 @@ class PipeServer {
 template<typename TPipeInstance>
 class OutboundPipeServerTmpl : public PipeServer<TPipeInstance> {
  private:
+    size_t backlog_limit;  /**< The backlog limit of each client. */
+    winss::BacklogPolicy backlog_policy;  /**< The backlog policy. */
+    /** The backlog counters of clients which have been removed. */
+    winss::BacklogCounters removed_counters{};
+
     /**
      * Called when a client is connected.
      *
@@ -223,7 +316,10 @@ class OutboundPipeServerTmpl : public PipeServer<TPipeInstance> {
      * \param instance The associated client instance.
      */
     void Connected(TPipeInstance* instance) {
-        Send(instance, { 0 });  // Send null char to signal connected
+        instance->SetBacklog(backlog_limit, backlog_policy);
+
+        // Send null char to signal connected
+        Send(instance, std::make_shared<const std::vector<char>>(1, 0));
     }
 
     /**
@@ -240,15 +336,43 @@ class OutboundPipeServerTmpl : public PipeServer<TPipeInstance> {
     }
 
     /**
-     * Send the given data to the specified instance.
+     * Called when a client is about to be removed.
+     *
+     * Keeps the backlog counters of the client.
+     *
+     * \param instance The associated client instance.
+     */
+    void Removed(TPipeInstance* instance) {
+        const winss::BacklogCounters& counters =
+            instance->GetBacklogCounters();
+
+        if (counters.dropped > 0 || counters.coalesced > 0) {
+            VLOG(2)
+                << "Pipe client dropped "
+                << counters.dropped
+                << " and coalesced "
+                << counters.coalesced
+                << " messages";
+        }
+
+        removed_counters.dropped += counters.dropped;
+        removed_counters.coalesced += counters.coalesced;
+        removed_counters.disconnected += counters.disconnected;
+    }
+
+    /**
+     * Send the given message to the specified instance.
+     *
+     * An instance which is already writing will send the message once the
+     * current write has finished.
      *
      * \param instance The instance to send to.
-     * \param data The data to send.
-     * \return True if the data was sent otherwise false.
+     * \param message The message to send.
+     * \return True if the message was sent otherwise false.
      */
-    bool Send(TPipeInstance* instance, const std::vector<char>& data) {
-        if (instance->Queue(data)) {
-            return instance->Write();
+    bool Send(TPipeInstance* instance, const winss::PipeMessage& message) {
+        if (instance->QueueMessage(message)) {
+            return instance->IsWriting() || instance->Write();
         }
 
         return false;
@@ -256,7 +380,9 @@ class OutboundPipeServerTmpl : public PipeServer<TPipeInstance> {
 
  public:
     explicit OutboundPipeServerTmpl(const PipeServerConfig& config) :
-        winss::PipeServer<TPipeInstance>::PipeServer(config) {}
+        winss::PipeServer<TPipeInstance>::PipeServer(config),
+        backlog_limit(config.backlog_limit),
+        backlog_policy(config.backlog_policy) {}
 
     /** No copy. */
     OutboundPipeServerTmpl(const OutboundPipeServerTmpl&) = delete;
@@ -266,12 +392,17 @@ class OutboundPipeServerTmpl : public PipeServer<TPipeInstance> {
     /**
      * Send the given data to all instances.
      *
+     * The data is copied once into a message which every instance shares.
+     *
      * \param data The data to send.
      */
     virtual bool Send(const std::vector<char>& data) {
+        winss::PipeMessage message =
+            std::make_shared<const std::vector<char>>(data);
+
         bool sent = true;
         for (auto it = instances.begin(); it != instances.end(); ++it) {
-            if (!Send(&it->second, data)) {
+            if (!Send(&it->second, message)) {
                 sent = false;
             }
         }
@@ -279,6 +410,27 @@ class OutboundPipeServerTmpl : public PipeServer<TPipeInstance> {
         return sent;
     }
 
+    /**
+     * Gets the counters of messages lost to the backlog limit.
+     *
+     * The counters include clients which have already been removed.
+     *
+     * \return The backlog counters of all clients.
+     */
+    virtual winss::BacklogCounters GetBacklogCounters() const {
+        winss::BacklogCounters total = removed_counters;
+
+        for (auto it = instances.begin(); it != instances.end(); ++it) {
+            const winss::BacklogCounters& counters =
+                it->second.GetBacklogCounters();
+            total.dropped += counters.dropped;
+            total.coalesced += counters.coalesced;
+            total.disconnected += counters.disconnected;
+        }
+
+        return total;
+    }
+
     /** No copy. */
     OutboundPipeServerTmpl& operator=(const OutboundPipeServerTmpl&) = delete;
     /** No move. */
@@ -0,0 +1,182 @@
+/*
+ * Copyright 2016-2017 Morgan Stanley
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sharded_wait.hpp"
+#include <windows.h>
+#include <algorithm>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "easylogging/easylogging++.hpp"
+#include "windows_interface.hpp"
+#include "handle_wrapper.hpp"
+#include "event_wrapper.hpp"
+
+winss::WaitResultState winss::ShardedWait::Wait(DWORD timeout,
+    const HANDLE* handles, size_t count, size_t* index) {
+    if (count > MAXIMUM_WAIT_OBJECTS) {
+        return WaitShards(timeout, handles, count, index);
+    }
+
+    DWORD size = static_cast<DWORD>(count);
+    DWORD result_code = WINDOWS.WaitForMultipleObjects(size, handles, false,
+        timeout);
+
+    if (result_code == WAIT_TIMEOUT) {
+        VLOG(7) << "HANDLE Wait timeout";
+        return TIMEOUT;
+    } else if (result_code == WAIT_FAILED) {
+        VLOG(1) << "HANDLE Wait failed: " << WINDOWS.GetLastError();
+        return FAILED;
+    }
+
+    DWORD offset = result_code - WAIT_OBJECT_0;
+    if (offset >= size) {
+        VLOG(1) << "HANDLE index " << offset << " out of range " << size;
+        return FAILED;
+    }
+
+    VLOG(7) << "HANDLE " << handles[offset] << "/" << size << " fired";
+    *index = offset;
+    return SUCCESS;
+}
+
+winss::WaitResultState winss::ShardedWait::WaitShards(DWORD timeout,
+    const HANDLE* handles, size_t count, size_t* index) {
+    size_t needed = (count + kShardSize - 1) / kShardSize;
+
+    if (!cancel) {
+        cancel = std::make_unique<winss::EventWrapper>();
+    }
+
+    cancel->Reset();
+    HANDLE cancel_handle = cancel->GetHandle().handle;
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (shards.size() < needed) {
+        VLOG(5) << "Starting wait shard " << shards.size();
+        auto shard = std::make_unique<Shard>();
+        shard->thread = std::thread(&ShardedWait::ShardLoop, this,
+            shards.size(), generation);
+        shards.push_back(std::move(shard));
+    }
+
+    for (size_t i = 0; i < needed; ++i) {
+        size_t first = i * kShardSize;
+        size_t last = std::min(first + kShardSize, count);
+
+        std::vector<HANDLE>& shard_handles = shards[i]->handles;
+        shard_handles.assign(handles + first, handles + last);
+        shard_handles.push_back(cancel_handle);
+    }
+
+    VLOG(7)
+        << "Waiting on "
+        << count
+        << " handles using "
+        << needed
+        << " shards";
+
+    active = needed;
+    pending = needed;
+    round_timeout = timeout;
+    state = TIMEOUT;
+    ++generation;
+    round_start.notify_all();
+
+    round_done.wait(lock, [this]() { return pending == 0; });
+
+    if (state == SUCCESS) {
+        VLOG(7)
+            << "HANDLE "
+            << handles[winner]
+            << "/"
+            << count
+            << " fired";
+        *index = winner;
+    }
+
+    return state;
+}
+
+void winss::ShardedWait::ShardLoop(size_t index, size_t seen) {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        round_start.wait(lock, [this, seen]() {
+            return shutdown || generation != seen;
+        });
+
+        if (shutdown) {
+            break;
+        }
+
+        seen = generation;
+        if (index >= active) {
+            continue;
+        }
+
+        const std::vector<HANDLE>& shard_handles = shards[index]->handles;
+        DWORD size = static_cast<DWORD>(shard_handles.size());
+        DWORD timeout = round_timeout;
+
+        lock.unlock();
+        DWORD result_code = WINDOWS.WaitForMultipleObjects(size,
+            shard_handles.data(), false, timeout);
+        DWORD error = result_code == WAIT_FAILED ? WINDOWS.GetLastError() : 0;
+        lock.lock();
+
+        if (result_code == WAIT_FAILED) {
+            VLOG(1) << "Shard " << index << " wait failed: " << error;
+            if (state != SUCCESS) {
+                state = FAILED;
+            }
+            cancel->Set();
+        } else if (result_code != WAIT_TIMEOUT) {
+            DWORD offset = result_code - WAIT_OBJECT_0;
+            if (offset < size - 1) {
+                size_t found = index * kShardSize + offset;
+                if (state != SUCCESS || found < winner) {
+                    state = SUCCESS;
+                    winner = found;
+                }
+                cancel->Set();
+            }
+        }
+
+        if (--pending == 0) {
+            round_done.notify_one();
+        }
+    }
+}
+
+winss::ShardedWait::~ShardedWait() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        shutdown = true;
+    }
+
+    round_start.notify_all();
+
+    for (auto& shard : shards) {
+        if (shard->thread.joinable()) {
+            shard->thread.join();
+        }
+    }
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2016-2017 Morgan Stanley
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIB_WINSS_SHARDED_WAIT_HPP_
+#define LIB_WINSS_SHARDED_WAIT_HPP_
+
+#include <windows.h>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "handle_wrapper.hpp"
+#include "event_wrapper.hpp"
+
+namespace winss {
+/**
+ * Waits on any number of handles.
+ *
+ * WaitForMultipleObjects is limited to MAXIMUM_WAIT_OBJECTS handles. When
+ * there are more handles than that they are split into shards which are
+ * each waited on by a helper thread. The first shard to be signalled sets a
+ * cancel event which every shard also waits on so that the other helpers
+ * return and the result can be handed back to the calling thread.
+ *
+ * Helper threads are only created when they are first needed and are kept
+ * for the lifetime of the instance. The handles never change while the
+ * shards are waiting so callers stay single threaded.
+ *
+ * Only one handle is reported per wait so auto-reset objects signalled in
+ * two shards at once could lose a signal. The handles winss waits on are
+ * processes and manual-reset events which stay signalled until handled.
+ */
+class ShardedWait {
+ public:
+    /** The number of handles a single shard can wait on. */
+    static const DWORD kShardSize = MAXIMUM_WAIT_OBJECTS - 1;
+
+ private:
+    /**
+     * A shard of handles waited on by a helper thread.
+     */
+    struct Shard {
+        std::vector<HANDLE> handles;  /**< The shard handles. */
+        std::thread thread;  /**< The helper thread. */
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;  /**< The shards. */
+    std::unique_ptr<winss::EventWrapper> cancel;  /**< The cancel event. */
+    std::mutex mutex;  /**< Guards the shared round state. */
+    std::condition_variable round_start;  /**< Signals a new round. */
+    std::condition_variable round_done;  /**< Signals a finished shard. */
+    size_t generation = 0;  /**< The current round. */
+    size_t active = 0;  /**< The number of shards in the round. */
+    size_t pending = 0;  /**< The number of shards still waiting. */
+    size_t winner = 0;  /**< The index of the signalled handle. */
+    DWORD round_timeout = INFINITE;  /**< The timeout of the round. */
+    winss::WaitResultState state = TIMEOUT;  /**< The round result. */
+    bool shutdown = false;  /**< Flags the helper threads to exit. */
+
+    /**
+     * Waits on the handles using as many shards as needed.
+     *
+     * \param[in] timeout The wait timeout.
+     * \param[in] handles The handles to wait on.
+     * \param[in] count The number of handles.
+     * \param[out] index The index of the signalled handle.
+     * \return The wait result state.
+     */
+    winss::WaitResultState WaitShards(DWORD timeout, const HANDLE* handles,
+        size_t count, size_t* index);
+
+    /**
+     * The helper thread loop for a shard.
+     *
+     * \param[in] index The index of the shard.
+     * \param[in] seen The round before the thread was started.
+     */
+    void ShardLoop(size_t index, size_t seen);
+
+ public:
+    /** The default constructor. */
+    ShardedWait() {}
+    ShardedWait(const ShardedWait&) = delete;  /**< No copy. */
+    ShardedWait(ShardedWait&&) = delete;  /**< No move. */
+
+    /**
+     * Waits for an event on a list of handles.
+     *
+     * Up to MAXIMUM_WAIT_OBJECTS handles are waited on directly on the
+     * calling thread otherwise the handles are sharded.
+     *
+     * \param[in] timeout The wait timeout.
+     * \param[in] handles The handles to wait on.
+     * \param[in] count The number of handles.
+     * \param[out] index The index of the signalled handle.
+     * \return The wait result state.
+     */
+    winss::WaitResultState Wait(DWORD timeout, const HANDLE* handles,
+        size_t count, size_t* index);
+
+    /**
+     * Stops and joins all the helper threads.
+     */
+    ~ShardedWait();
+
+    /** No copy. */
+    ShardedWait& operator=(const ShardedWait&) = delete;
+    /** No move. */
+    ShardedWait& operator=(ShardedWait&&) = delete;
+};
+}  // namespace winss
+
+#endif  // LIB_WINSS_SHARDED_WAIT_HPP_
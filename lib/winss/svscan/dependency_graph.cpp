@@ -0,0 +1,95 @@
+/*
+ * Copyright 2016-2017 Morgan Stanley
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "dependency_graph.hpp"
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+void winss::DependencyGraph::Set(const std::string& name,
+    std::vector<std::string> dependencies) {
+    this->dependencies[name] = std::move(dependencies);
+}
+
+void winss::DependencyGraph::Remove(const std::string& name) {
+    dependencies.erase(name);
+    ready.erase(name);
+}
+
+void winss::DependencyGraph::Ready(const std::string& name) {
+    ready.insert(name);
+}
+
+bool winss::DependencyGraph::IsReady(const std::string& name) const {
+    return ready.find(name) != ready.end();
+}
+
+std::vector<std::string> winss::DependencyGraph::Waiting(
+    const std::string& name) const {
+    std::vector<std::string> waiting;
+
+    auto it = dependencies.find(name);
+    if (it != dependencies.end()) {
+        for (const std::string& dependency : it->second) {
+            if (!IsReady(dependency)) {
+                waiting.push_back(dependency);
+            }
+        }
+    }
+
+    return waiting;
+}
+
+bool winss::DependencyGraph::Follow(const std::string& name,
+    const std::string& target, std::unordered_set<std::string>* visited,
+    std::vector<std::string>* path) const {
+    auto it = dependencies.find(name);
+    if (it == dependencies.end()) {
+        return false;
+    }
+
+    for (const std::string& dependency : it->second) {
+        if (dependency == target) {
+            path->push_back(dependency);
+            return true;
+        }
+
+        if (visited->insert(dependency).second) {
+            path->push_back(dependency);
+            if (Follow(dependency, target, visited, path)) {
+                return true;
+            }
+
+            path->pop_back();
+        }
+    }
+
+    return false;
+}
+
+std::vector<std::string> winss::DependencyGraph::FindCycle(
+    const std::string& name) const {
+    std::unordered_set<std::string> visited{ name };
+    std::vector<std::string> path{ name };
+
+    if (!Follow(name, name, &visited, &path)) {
+        path.clear();
+    }
+
+    return path;
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2016-2017 Morgan Stanley
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIB_WINSS_SVSCAN_DEPENDENCY_GRAPH_HPP_
+#define LIB_WINSS_SVSCAN_DEPENDENCY_GRAPH_HPP_
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace winss {
+/**
+ * The start-up order of services.
+ *
+ * Each service lists the services it depends on. A service can start once
+ * all of its dependencies are ready.
+ */
+class DependencyGraph {
+ private:
+    /** The dependencies of each service. */
+    std::unordered_map<std::string, std::vector<std::string>> dependencies;
+    std::unordered_set<std::string> ready;  /**< The ready services. */
+
+    /**
+     * Follows the dependencies of a service looking for a target.
+     *
+     * \param[in] name The service to follow.
+     * \param[in] target The service which closes the cycle.
+     * \param[in,out] visited The services already followed.
+     * \param[in,out] path The dependencies followed so far.
+     * \return True if the target was found otherwise false.
+     */
+    bool Follow(const std::string& name, const std::string& target,
+        std::unordered_set<std::string>* visited,
+        std::vector<std::string>* path) const;
+
+ public:
+    /**
+     * Sets the dependencies of a service.
+     *
+     * \param name The name of the service.
+     * \param dependencies The names of the services it depends on.
+     */
+    void Set(const std::string& name, std::vector<std::string> dependencies);
+
+    /**
+     * Removes a service and its dependencies.
+     *
+     * \param name The name of the service.
+     */
+    void Remove(const std::string& name);
+
+    /**
+     * Marks a service as ready.
+     *
+     * \param name The name of the service.
+     */
+    void Ready(const std::string& name);
+
+    /**
+     * Gets if a service is ready.
+     *
+     * \param name The name of the service.
+     * \return True if the service is ready otherwise false.
+     */
+    bool IsReady(const std::string& name) const;
+
+    /**
+     * Gets the dependencies of a service which are not ready.
+     *
+     * \param name The name of the service.
+     * \return The names of the dependencies which are not ready.
+     */
+    std::vector<std::string> Waiting(const std::string& name) const;
+
+    /**
+     * Finds a dependency cycle which goes through a service.
+     *
+     * \param name The name of the service.
+     * \return The services in the cycle starting and ending with the given
+     * service or empty if there is no cycle.
+     */
+    std::vector<std::string> FindCycle(const std::string& name) const;
+};
+}  // namespace winss
+
+#endif  // LIB_WINSS_SVSCAN_DEPENDENCY_GRAPH_HPP_
@@ -19,13 +19,16 @@
 
 #include <windows.h>
 #include <filesystem>
+#include <memory>
 #include <utility>
 #include <string>
 #include "easylogging/easylogging++.hpp"
 #include "../windows_interface.hpp"
 #include "../filesystem_interface.hpp"
 #include "../handle_wrapper.hpp"
+#include "../log/log_aggregator.hpp"
 #include "service_process.hpp"
+#include "startup_scheduler.hpp"
 
 namespace fs = std::experimental::filesystem;
 
@@ -34,7 +37,11 @@ namespace winss {
  * A template for a service.
  *
  * Models a service directory and has knowledge about redirecting logs for
- * service directories which include a log definition.
+ * service directories which include a log definition. When a log
+ * aggregator is used, log definitions with a logging script are written by
+ * the aggregator instead of their own log supervisor. When a startup
+ * scheduler is used, the supervisors are created on one of its workers and
+ * moved into the service once they have started.
  *
  * \tparam TServiceProcess The service process implementation type.
  */
@@ -45,6 +52,25 @@ class ServiceTmpl {
     TServiceProcess main;  /**< The main supervisor. */
     TServiceProcess log;  /**< The log supervisor. */
     bool flagged = false;  /**< Flagged for removal. */
+    /** The log aggregator which is not owned or nullptr. */
+    winss::LogAggregatorInterface* log_aggregator = nullptr;
+    bool aggregated = false;  /**< Flags if the logs are aggregated. */
+    /** The startup scheduler which is not owned or nullptr. */
+    winss::StartupSchedulerInterface* scheduler = nullptr;
+
+    /**
+     * The supervisors of a service while they are being started.
+     */
+    struct Starting {
+        ServiceTmpl* owner = nullptr;  /**< The service or nullptr. */
+        winss::ServicePipes pipes;  /**< The redirected pipes. */
+        TServiceProcess main;  /**< The main supervisor. */
+        TServiceProcess log;  /**< The log supervisor. */
+        bool start_log = false;  /**< Flags if the log is started. */
+    };
+
+    /** The supervisors being started or nullptr. */
+    std::shared_ptr<Starting> starting;
 
     /**
      * Creates pipes for redirecting STDIN and STDOUT.
@@ -71,6 +97,77 @@ class ServiceTmpl {
         };
     }
 
+    /**
+     * Checks if the logs should be written by the log aggregator.
+     *
+     * \return True if the log definition has a logging script for the
+     * aggregator otherwise false.
+     */
+    bool IsAggregated() const {
+        return log_aggregator != nullptr && FILESYSTEM.FileExists(
+            log.GetServiceDir() / fs::path(winss::LogAggregator::kScriptFile));
+    }
+
+    /**
+     * Starts the supervisors on a worker of the startup scheduler.
+     *
+     * \param pipes The redirected pipes.
+     * \param start_log Start the log supervisor as well.
+     */
+    void Schedule(winss::ServicePipes pipes, bool start_log) {
+        auto start = std::make_shared<Starting>();
+        start->owner = this;
+        start->pipes = std::move(pipes);
+        start->main = TServiceProcess(name);
+        start->log = TServiceProcess(name / fs::path(kLogDir));
+        start->start_log = start_log && !log.IsCreated();
+        starting = start;
+
+        VLOG(3) << "Scheduling start of service " << name;
+
+        scheduler->Submit([start]() {
+            if (start->start_log) {
+                start->log.Start(start->pipes, true);
+            }
+
+            start->main.Start(start->pipes, false);
+        }, [start]() {
+            if (start->owner != nullptr) {
+                start->owner->Started(start.get());
+            } else {
+                /* The service was closed while it was starting */
+                start->main.Close();
+                start->log.Close();
+            }
+        });
+    }
+
+    /**
+     * Takes over the supervisors once they have started.
+     *
+     * \param start The supervisors which were started.
+     */
+    void Started(Starting* start) {
+        VLOG(3) << "Started service " << name;
+
+        main = std::move(start->main);
+        if (start->start_log) {
+            log = std::move(start->log);
+        }
+
+        starting.reset();
+    }
+
+    /**
+     * Stops taking over the supervisors being started.
+     */
+    void CancelStart() {
+        if (starting != nullptr) {
+            starting->owner = nullptr;
+            starting.reset();
+        }
+    }
+
  public:
     static constexpr const char kLogDir[4] = "log";  /**< The log definition. */
 
@@ -83,10 +180,15 @@ class ServiceTmpl {
      * Initializes the service with the name and directory.
      *
      * \param name The name of the service.
+     * \param log_aggregator The optional log aggregator.
+     * \param scheduler The optional startup scheduler.
      */
-    explicit ServiceTmpl(const std::string& name) : name(name),
-        main(TServiceProcess(name)),
-        log(TServiceProcess(name / fs::path(kLogDir))) {}
+    explicit ServiceTmpl(const std::string& name,
+        winss::LogAggregatorInterface* log_aggregator = nullptr,
+        winss::StartupSchedulerInterface* scheduler = nullptr) :
+        name(name), main(TServiceProcess(name)),
+        log(TServiceProcess(name / fs::path(kLogDir))),
+        log_aggregator(log_aggregator), scheduler(scheduler) {}
 
     ServiceTmpl(const ServiceTmpl&) = delete;  /**< No copy. */
 
@@ -97,7 +199,13 @@ class ServiceTmpl {
      */
     ServiceTmpl(ServiceTmpl&& s) : name(std::move(s.name)),
         main(std::move(s.main)), log(std::move(s.log)),
-        flagged(s.flagged) {}
+        flagged(s.flagged), log_aggregator(s.log_aggregator),
+        aggregated(s.aggregated), scheduler(s.scheduler),
+        starting(std::move(s.starting)) {
+        if (starting != nullptr) {
+            starting->owner = this;
+        }
+    }
 
     /**
      * Gets the name of the service
@@ -126,19 +234,38 @@ class ServiceTmpl {
 
     /**
      * Checks the service is running.
+     *
+     * A service which is still being started by the startup scheduler is
+     * treated as running.
      */
     virtual void Check() {
         flagged = true;
 
-        if (main.IsCreated()) {
+        if (starting != nullptr || main.IsCreated()) {
             return;
         }
 
         winss::ServicePipes pipes;
+        bool start_log = false;
 
         if (FILESYSTEM.DirectoryExists(log.GetServiceDir())) {
             VLOG(3) << "Log directory exists for service " << name;
-            pipes = CreatePipes();
+            if (IsAggregated()) {
+                pipes.stdout_pipe = log_aggregator->Add(name,
+                    log.GetServiceDir());
+                aggregated = true;
+            } else {
+                pipes = CreatePipes();
+                start_log = true;
+            }
+        }
+
+        if (scheduler != nullptr) {
+            Schedule(std::move(pipes), start_log);
+            return;
+        }
+
+        if (start_log) {
             log.Start(pipes, true);
         }
 
@@ -153,9 +280,15 @@ class ServiceTmpl {
      */
     virtual bool Close(bool ignore_flagged) {
         if (ignore_flagged || !flagged) {
+            CancelStart();
             main.Close();
             log.Close();
             flagged = false;
+
+            if (aggregated) {
+                log_aggregator->Remove(name);
+                aggregated = false;
+            }
         }
 
         return flagged;
@@ -174,8 +307,24 @@ class ServiceTmpl {
         main = std::move(s.main);
         log = std::move(s.log);
         flagged = s.flagged;
+        log_aggregator = s.log_aggregator;
+        aggregated = s.aggregated;
+        scheduler = s.scheduler;
+        CancelStart();
+        starting = std::move(s.starting);
+        if (starting != nullptr) {
+            starting->owner = this;
+        }
+
         return *this;
     }
+
+    /**
+     * Stops taking over any supervisors still being started.
+     */
+    virtual ~ServiceTmpl() {
+        CancelStart();
+    }
 };
 
 /**
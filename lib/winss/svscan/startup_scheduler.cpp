@@ -0,0 +1,160 @@
+/*
+ * Copyright 2016-2017 Morgan Stanley
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "startup_scheduler.hpp"
+#include <windows.h>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include "easylogging/easylogging++.hpp"
+#include "../not_owning_ptr.hpp"
+#include "../wait_multiplexer.hpp"
+
+winss::StartupScheduler::StartupScheduler(
+    winss::NotOwningPtr<winss::WaitMultiplexer> multiplexer,
+    size_t concurrency, size_t rate) : multiplexer(multiplexer),
+    concurrency(concurrency > 0 ? concurrency : 1),
+    interval(rate > 0 ? 1000000 / rate : 0) {
+    multiplexer->AddStopCallback([this](winss::WaitMultiplexer&) {
+        this->Stop();
+    });
+}
+
+void winss::StartupScheduler::Submit(std::function<void()> work,
+    std::function<void()> done) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!stopping) {
+            if (workers.empty()) {
+                VLOG(3) << "Starting " << concurrency << " startup workers";
+                for (size_t i = 0; i < concurrency; ++i) {
+                    workers.emplace_back(&StartupScheduler::WorkLoop, this);
+                }
+            }
+
+            queued.push_back({ std::move(work), std::move(done) });
+            ++outstanding;
+            changed.notify_one();
+            Watch();
+            return;
+        }
+    }
+
+    /* The scheduler has stopped so do not defer the work */
+    work();
+    done();
+}
+
+size_t winss::StartupScheduler::Outstanding() const {
+    return outstanding;
+}
+
+void winss::StartupScheduler::Watch() {
+    if (waiting || stopping || outstanding == 0) {
+        return;
+    }
+
+    waiting = true;
+    multiplexer->AddTriggeredCallback(finished_event.GetHandle(),
+        [this](winss::WaitMultiplexer&, const winss::HandleWrapper&) {
+        this->waiting = false;
+        this->Complete();
+    });
+}
+
+void winss::StartupScheduler::Complete() {
+    std::deque<Job> done;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished_event.Reset();
+        done.swap(finished);
+    }
+
+    VLOG(5) << "Completing " << done.size() << " startup jobs";
+
+    outstanding -= done.size();
+    for (Job& job : done) {
+        job.done();
+    }
+
+    Watch();
+}
+
+void winss::StartupScheduler::WorkLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        changed.wait(lock, [this]() { return stopping || !queued.empty(); });
+
+        if (stopping) {
+            break;
+        }
+
+        if (interval.count() > 0) {
+            auto now = std::chrono::steady_clock::now();
+            if (now < next_start) {
+                changed.wait_until(lock, next_start);
+                continue;
+            }
+
+            next_start = now + interval;
+        }
+
+        Job job = std::move(queued.front());
+        queued.pop_front();
+
+        lock.unlock();
+        job.work();
+        lock.lock();
+
+        finished.push_back(std::move(job));
+        finished_event.Set();
+    }
+}
+
+void winss::StartupScheduler::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping) {
+            return;
+        }
+
+        stopping = true;
+        outstanding -= queued.size();
+        queued.clear();
+        changed.notify_all();
+    }
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    workers.clear();
+
+    if (waiting) {
+        multiplexer->RemoveTriggeredCallback(finished_event.GetHandle());
+        waiting = false;
+    }
+
+    Complete();
+}
+
+winss::StartupScheduler::~StartupScheduler() {
+    Stop();
+}
@@ -0,0 +1,154 @@
+/*
+ * Copyright 2016-2017 Morgan Stanley
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIB_WINSS_SVSCAN_STARTUP_SCHEDULER_HPP_
+#define LIB_WINSS_SVSCAN_STARTUP_SCHEDULER_HPP_
+
+#include <windows.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../event_wrapper.hpp"
+#include "../not_owning_ptr.hpp"
+#include "../wait_multiplexer.hpp"
+
+namespace winss {
+/**
+ * Runs the start-up of services away from the multiplexer thread.
+ */
+class StartupSchedulerInterface {
+ public:
+    /**
+     * Submits work to be run on a worker.
+     *
+     * \param work The work to run on a worker.
+     * \param done Called on the multiplexer thread once the work is done.
+     */
+    virtual void Submit(std::function<void()> work,
+        std::function<void()> done) = 0;
+
+    /** Default destructor. */
+    virtual ~StartupSchedulerInterface() {}
+};
+
+/**
+ * Starts supervisors from a pool of workers.
+ *
+ * At most the concurrency limit of jobs run at once and jobs are started
+ * no faster than the rate limit. Finished jobs are handed back to the
+ * multiplexer through an event so the done callbacks run on the same
+ * thread as everything else in svscan.
+ */
+class StartupScheduler : public StartupSchedulerInterface {
+ private:
+    /**
+     * A job submitted to the scheduler.
+     */
+    struct Job {
+        std::function<void()> work;  /**< Runs on a worker. */
+        std::function<void()> done;  /**< Runs on the multiplexer. */
+    };
+
+    /** The event multiplexer. */
+    winss::NotOwningPtr<winss::WaitMultiplexer> multiplexer;
+    const size_t concurrency;  /**< The number of workers. */
+    /** The minimum time between the start of two jobs. */
+    const std::chrono::microseconds interval;
+    std::deque<Job> queued;  /**< Jobs waiting for a worker. */
+    std::deque<Job> finished;  /**< Jobs waiting for their done callback. */
+    size_t outstanding = 0;  /**< Jobs submitted but not yet done. */
+    /** The earliest time the next job can start. */
+    std::chrono::steady_clock::time_point next_start;
+    bool stopping = false;  /**< Flags if the workers should stop. */
+    bool waiting = false;  /**< Flags if waiting on the finished event. */
+    mutable std::mutex mutex;  /**< Guards the queues. */
+    std::condition_variable changed;  /**< Signals the workers. */
+    winss::EventWrapper finished_event;  /**< Signals the multiplexer. */
+    std::vector<std::thread> workers;  /**< The worker pool. */
+
+    /**
+     * Waits on the finished event while there are jobs outstanding.
+     */
+    void Watch();
+
+    /**
+     * Runs the done callbacks of the finished jobs.
+     */
+    void Complete();
+
+    /**
+     * The worker loop.
+     */
+    void WorkLoop();
+
+ public:
+    /**
+     * Startup scheduler constructor.
+     *
+     * \param multiplexer The shared multiplexer.
+     * \param concurrency The number of jobs which can run at once.
+     * \param rate The number of jobs which can start a second or 0 for no
+     * limit.
+     */
+    StartupScheduler(winss::NotOwningPtr<winss::WaitMultiplexer> multiplexer,
+        size_t concurrency, size_t rate);
+    StartupScheduler(const StartupScheduler&) = delete;  /**< No copy. */
+    StartupScheduler(StartupScheduler&&) = delete;  /**< No move. */
+
+    /**
+     * Submits work to be run on a worker.
+     *
+     * The workers are started with the first job. Once stopped the work
+     * and the done callback run straight away.
+     *
+     * \param work The work to run on a worker.
+     * \param done Called on the multiplexer thread once the work is done.
+     */
+    void Submit(std::function<void()> work,
+        std::function<void()> done) override;
+
+    /**
+     * Gets the number of jobs which are not done yet.
+     *
+     * \return The number of jobs queued, running or finished but waiting
+     * for their done callback.
+     */
+    virtual size_t Outstanding() const;
+
+    /**
+     * Drops the queued jobs, waits for the running jobs and then runs the
+     * done callbacks of every job which ran.
+     */
+    virtual void Stop();
+
+    /**
+     * Stops the workers.
+     */
+    virtual ~StartupScheduler();
+
+    /** No copy. */
+    StartupScheduler& operator=(const StartupScheduler&) = delete;
+    /** No move. */
+    StartupScheduler& operator=(StartupScheduler&&) = delete;
+};
+}  // namespace winss
+
+#endif  // LIB_WINSS_SVSCAN_STARTUP_SCHEDULER_HPP_
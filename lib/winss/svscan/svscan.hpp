@@ -20,9 +20,12 @@
 #include <windows.h>
 #include <filesystem>
 #include <functional>
+#include <tuple>
 #include <utility>
 #include <vector>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include "easylogging/easylogging++.hpp"
 #include "../windows_interface.hpp"
 #include "../environment.hpp"
@@ -35,16 +38,47 @@
 #include "../handle_wrapper.hpp"
 #include "../event_wrapper.hpp"
 #include "../ctrl_handler.hpp"
+#include "../log/log_aggregator.hpp"
+#include "../supervise/state_file.hpp"
+#include "../supervise/supervise.hpp"
+#include "dependency_graph.hpp"
 #include "service.hpp"
+#include "startup_scheduler.hpp"
 
 namespace fs = std::experimental::filesystem;
 
 namespace winss {
+/**
+ * The service directories which changed since the last scan.
+ */
+struct ScanChanges {
+    /** The service directories which were added or modified. */
+    std::vector<fs::path> checked;
+    /** The names of the service directories which were not modified. */
+    std::vector<std::string> unchanged;
+    /** The names of the service directories which were removed. */
+    std::vector<std::string> removed;
+};
+
+/**
+ * The write times of a service directory and its dependencies file.
+ */
+typedef std::pair<unsigned __int64, unsigned __int64> ScanTimes;
+
 /**
  * The svscan template.
  *
  * Scans a directory either on a timer or on demand and starts supervisors
- * for each service directory it sees.
+ * for each service directory it sees. It can also watch the directory and
+ * scan as soon as a service directory is added or removed.
+ *
+ * Scans on demand only act on the service directories which were added,
+ * removed or modified since the last scan while scans on the timer check
+ * every service directory.
+ *
+ * A service directory can list the services it depends on in a
+ * dependencies file. The service is only started once the run process of
+ * each of its dependencies has started.
  *
  * \tparam TService The service implementation type.
  * \tparam TMutex The mutex implementation type.
@@ -62,8 +96,25 @@ class SvScanTmpl {
     bool close_on_exit = true;  /**< Option to close services on exit. */
     bool signals = false;  /**< Use handlers for signals. */
     winss::EventWrapper close_event;  /**< Event when to stop. */
-
-    std::vector<TService> services;  /**< A list of services. */
+    /** The log aggregator which is not owned or nullptr. */
+    winss::LogAggregatorInterface* log_aggregator;
+    bool watch = false;  /**< Scan when the scan directory changes. */
+    HANDLE change = nullptr;  /**< The directory change notification. */
+    bool change_pending = false;  /**< Flags if a change scan is pending. */
+    /** The startup scheduler which is not owned or nullptr. */
+    winss::StartupSchedulerInterface* scheduler;
+
+    /** The services keyed by name which never move once added. */
+    std::unordered_map<std::string, TService> services;
+    /** The write times of each service directory at the last scan. */
+    std::unordered_map<std::string, winss::ScanTimes> snapshot;
+    /** The names of the services which were removed since the last close. */
+    std::unordered_set<std::string> inactive;
+    winss::DependencyGraph graph;  /**< The start-up order of services. */
+    /** The directories of the services waiting on dependencies. */
+    std::unordered_map<std::string, fs::path> held;
+    /** Flags if a dependency check is pending. */
+    bool dependency_pending = false;
 
     /**
      * Initializes svscan.
@@ -91,9 +142,90 @@ class SvScanTmpl {
 
         ReadEnv();
 
+        Watch();
         Scan(false);
     }
 
+    /**
+     * Waits on a change notification for the scan directory.
+     *
+     * Only directories being added, removed or renamed are notified. If
+     * the directory cannot be watched then only the timer will scan.
+     */
+    void Watch() {
+        if (!watch || exiting) {
+            return;
+        }
+
+        if (change == nullptr) {
+            change = WINDOWS.FindFirstChangeNotification(
+                scan_dir.string().c_str(), false,
+                FILE_NOTIFY_CHANGE_DIR_NAME);
+
+            if (change == INVALID_HANDLE_VALUE) {
+                change = nullptr;
+                LOG(WARNING)
+                    << "Unable to watch directory "
+                    << scan_dir
+                    << ": "
+                    << WINDOWS.GetLastError();
+                return;
+            }
+
+            VLOG(3) << "Watching directory " << scan_dir;
+        }
+
+        multiplexer->AddTriggeredCallback(winss::HandleWrapper(change, false),
+            [this](winss::WaitMultiplexer&, const winss::HandleWrapper&) {
+            this->Changed();
+        });
+    }
+
+    /**
+     * Handles a change to the scan directory.
+     *
+     * The scan is delayed slightly so a burst of changes results in a
+     * single scan.
+     */
+    void Changed() {
+        if (!WINDOWS.FindNextChangeNotification(change)) {
+            LOG(WARNING)
+                << "Unable to keep watching directory "
+                << scan_dir
+                << ": "
+                << WINDOWS.GetLastError();
+            CloseWatch();
+            return;
+        }
+
+        VLOG(4) << "Directory " << scan_dir << " changed";
+        Watch();
+
+        if (!change_pending) {
+            change_pending = true;
+            multiplexer->AddTimeoutCallback(kWatchDelay,
+                [this](winss::WaitMultiplexer&) {
+                this->change_pending = false;
+                this->Scan(false);
+            }, kWatchGroup);
+        }
+    }
+
+    /**
+     * Stops watching the scan directory.
+     */
+    void CloseWatch() {
+        multiplexer->RemoveTimeoutCallback(kWatchGroup);
+        change_pending = false;
+
+        if (change != nullptr) {
+            multiplexer->RemoveTriggeredCallback(
+                winss::HandleWrapper(change, false));
+            WINDOWS.FindCloseChangeNotification(change);
+            change = nullptr;
+        }
+    }
+
     /**
      * Reads the env directory into the current environment.
      */
@@ -132,20 +264,258 @@ class SvScanTmpl {
             return;
         }
 
-        auto pred = [name](const TService& service) {
-            return service.GetName() == name;
-        };
-
-        auto it = find_if(services.begin(), services.end(), pred);
+        auto it = services.find(name);
         if (it == services.end()) {
-            TService service(name);
+            if (!CanStart(name, service_dir)) {
+                return;
+            }
+
             VLOG(2) << "Found new service " << name;
-            service.Check();
-            services.push_back(std::move(service));
+            it = services.emplace(std::piecewise_construct,
+                std::forward_as_tuple(name),
+                std::forward_as_tuple(name, log_aggregator, scheduler)).first;
         } else {
             VLOG(3) << "Found existing service " << name;
-            it->Check();
+            inactive.erase(name);
+        }
+
+        it->second.Check();
+    }
+
+    /**
+     * Reads the services which a service depends on.
+     *
+     * \param[in] service_dir The service directory.
+     * \return The names of the services from the dependencies file.
+     */
+    static std::vector<std::string> ReadDependencies(
+        const fs::path& service_dir) {
+        std::vector<std::string> dependencies;
+
+        std::string content = FILESYSTEM.Read(
+            service_dir / fs::path(kDependenciesFile));
+
+        for (std::string line : winss::Utils::SplitString(content)) {
+            line.erase(line.find_last_not_of(" \t\r") + 1);
+            line.erase(0, line.find_first_not_of(" \t"));
+
+            if (!line.empty()) {
+                dependencies.push_back(line);
+            }
+        }
+
+        return dependencies;
+    }
+
+    /**
+     * Checks if a new service can start or has to wait on its dependencies.
+     *
+     * A service in a dependency cycle or which depends on a service without
+     * a service directory is reported and started without waiting so the
+     * rest of the services can still start.
+     *
+     * \param[in] name The name of the service.
+     * \param[in] service_dir The service directory.
+     * \return True if the service can start otherwise false.
+     */
+    bool CanStart(const std::string& name, const fs::path& service_dir) {
+        graph.Set(name, ReadDependencies(service_dir));
+
+        std::vector<std::string> waiting = graph.Waiting(name);
+        if (waiting.empty()) {
+            held.erase(name);
+            return true;
+        }
+
+        std::vector<std::string> cycle = graph.FindCycle(name);
+        if (!cycle.empty()) {
+            std::string path;
+            for (const std::string& dependency : cycle) {
+                path += (path.empty() ? "" : " -> ") + dependency;
+            }
+
+            LOG(ERROR)
+                << "Service "
+                << name
+                << " has a dependency cycle ("
+                << path
+                << ") and will start without waiting";
+            held.erase(name);
+            return true;
+        }
+
+        std::string unknown;
+        for (const std::string& dependency : waiting) {
+            if (!IsKnown(dependency)) {
+                unknown += (unknown.empty() ? "" : ", ") + dependency;
+            }
+        }
+
+        if (!unknown.empty()) {
+            LOG(ERROR)
+                << "Service "
+                << name
+                << " depends on unknown services ("
+                << unknown
+                << ") and will start without waiting";
+            held.erase(name);
+            return true;
+        }
+
+        if (held.find(name) == held.end()) {
+            VLOG(2)
+                << "Service "
+                << name
+                << " is waiting on "
+                << waiting.size()
+                << " dependencies";
+        }
+
+        held[name] = service_dir;
+        WatchDependencies();
+        return false;
+    }
+
+    /**
+     * Checks if a service directory was found by the last scan.
+     *
+     * \param[in] name The name of the service.
+     * \return True if the service directory exists otherwise false.
+     */
+    bool IsKnown(const std::string& name) const {
+        return snapshot.find(name) != snapshot.end();
+    }
+
+    /**
+     * Checks if the run process of a service has started.
+     *
+     * The state file is only trusted while a supervisor holds the service
+     * mutex as it is left behind when the supervisor dies.
+     *
+     * \param[in] name The name of the service.
+     * \return True if the service is up otherwise false.
+     */
+    bool IsRunning(const std::string& name) const {
+        TMutex supervise_mutex(name, winss::Supervise::kMutexName);
+        if (supervise_mutex.CanLock()) {
+            return false;
         }
+
+        winss::SuperviseStateFile state_file(name);
+        winss::SuperviseState state{};
+        return state_file.Read(&state) && state.is_up &&
+            state.is_run_process;
+    }
+
+    /**
+     * Schedules the next check of the dependencies of waiting services.
+     */
+    void WatchDependencies() {
+        if (held.empty() || dependency_pending || exiting) {
+            return;
+        }
+
+        dependency_pending = true;
+        multiplexer->AddTimeoutCallback(kDependencyDelay,
+            [this](winss::WaitMultiplexer&) {
+            this->dependency_pending = false;
+            this->CheckDependencies();
+        }, kDependencyGroup);
+    }
+
+    /**
+     * Starts the waiting services whose dependencies are now running.
+     *
+     * Services waiting on a dependency whose service directory has gone
+     * are checked again so they are reported rather than polled forever.
+     */
+    void CheckDependencies() {
+        std::unordered_set<std::string> checked;
+        std::unordered_set<std::string> unknown;
+        std::vector<fs::path> released;
+
+        for (const auto& kv : held) {
+            for (const std::string& dependency : graph.Waiting(kv.first)) {
+                if (!checked.insert(dependency).second) {
+                    continue;
+                }
+
+                if (!IsKnown(dependency)) {
+                    unknown.insert(dependency);
+                } else if (IsRunning(dependency)) {
+                    VLOG(3) << "Dependency " << dependency << " is running";
+                    graph.Ready(dependency);
+                }
+            }
+        }
+
+        for (const auto& kv : held) {
+            std::vector<std::string> waiting = graph.Waiting(kv.first);
+            bool release = waiting.empty();
+            for (const std::string& dependency : waiting) {
+                release = release || unknown.count(dependency) > 0;
+            }
+
+            if (release) {
+                released.push_back(kv.second);
+            }
+        }
+
+        for (const fs::path& service_dir : released) {
+            Check(service_dir);
+        }
+
+        WatchDependencies();
+    }
+
+    /**
+     * Diffs the scan directory against the snapshot of the last scan.
+     *
+     * A service directory is changed if its name was not seen before or
+     * the write time of the directory or of its dependencies file differs.
+     * The dependencies file is tracked separately as editing it does not
+     * touch the directory. The snapshot is replaced with the current
+     * listing.
+     *
+     * \param[in] full Treat every service directory as changed.
+     * \return The service directories which changed since the last scan.
+     */
+    winss::ScanChanges Diff(bool full) {
+        winss::ScanChanges changes;
+        std::unordered_map<std::string, winss::ScanTimes> current;
+
+        for (const auto& dir : FILESYSTEM.GetDirectories(scan_dir)) {
+            std::string name = dir.filename().string();
+
+            /* Current, parent and hidden directories should be ignored */
+            if (name.empty() || name.front() == '.') {
+                VLOG(4) << "Skipping directory " << name;
+                continue;
+            }
+
+            fs::path dependencies = dir / fs::path(kDependenciesFile);
+            winss::ScanTimes write_times(FILESYSTEM.LastWriteTime(dir),
+                FILESYSTEM.FileExists(dependencies) ?
+                FILESYSTEM.LastWriteTime(dependencies) : 0);
+
+            auto it = snapshot.find(name);
+            if (full || it == snapshot.end() || it->second != write_times) {
+                changes.checked.push_back(dir);
+            } else {
+                changes.unchanged.push_back(name);
+            }
+
+            current.emplace(std::move(name), write_times);
+        }
+
+        for (const auto& kv : snapshot) {
+            if (current.find(kv.first) == current.end()) {
+                changes.removed.push_back(kv.first);
+            }
+        }
+
+        snapshot.swap(current);
+        return changes;
     }
 
     /**
@@ -211,6 +581,9 @@ class SvScanTmpl {
         }
 
         multiplexer->RemoveTimeoutCallback(kTimeoutGroup);
+        multiplexer->RemoveTimeoutCallback(kDependencyGroup);
+        dependency_pending = false;
+        CloseWatch();
         exiting = true;
         if (close_on_exit) {
             CloseAllServices(true);
@@ -249,6 +622,16 @@ class SvScanTmpl {
     static constexpr const char kMutexName[7] = "svscan"; /**< Mutex name. */
     /** The timeout group for the multiplexer. */
     static constexpr const char kTimeoutGroup[7] = "svscan";
+    /** The timeout group for scans after a change. */
+    static constexpr const char kWatchGroup[13] = "svscan-watch";
+    /** The delay in ms before scanning after a change. */
+    static const DWORD kWatchDelay = 100;
+    /** The timeout group for dependency checks. */
+    static constexpr const char kDependencyGroup[18] = "svscan-dependency";
+    /** The delay in ms between dependency checks. */
+    static const DWORD kDependencyDelay = 100;
+    /** The file listing the services a service depends on. */
+    static constexpr const char kDependenciesFile[13] = "dependencies";
     /** The directory for svscan data. */
     static constexpr const char kSvscanDir[14] = ".winss-svscan";
     static constexpr const char kFinishFile[7] = "finish";  /**< Finish file. */
@@ -265,12 +648,20 @@ class SvScanTmpl {
      * \param rescan The scan period.
      * \param signals Use handlers for signals.
      * \param close_event Event when to stop.
+     * \param log_aggregator The optional log aggregator for services.
+     * \param watch Scan when the scan directory changes.
+     * \param scheduler The optional startup scheduler for services.
      */
     SvScanTmpl(winss::NotOwningPtr<winss::WaitMultiplexer> multiplexer,
         const fs::path& scan_dir, DWORD rescan, bool signals,
-        winss::EventWrapper close_event) : multiplexer(multiplexer),
-        scan_dir(scan_dir), rescan(rescan),  mutex(scan_dir, kMutexName),
-        signals(signals), close_event(close_event) {
+        winss::EventWrapper close_event,
+        winss::LogAggregatorInterface* log_aggregator = nullptr,
+        bool watch = false,
+        winss::StartupSchedulerInterface* scheduler = nullptr) :
+        multiplexer(multiplexer), scan_dir(scan_dir), rescan(rescan),
+        mutex(scan_dir, kMutexName), signals(signals),
+        close_event(close_event), log_aggregator(log_aggregator),
+        watch(watch), scheduler(scheduler) {
         multiplexer->AddInitCallback([this](winss::WaitMultiplexer&) {
             this->Init();
         });
@@ -292,6 +683,12 @@ class SvScanTmpl {
 
     /**
      * Does a scan of the scan directory.
+     *
+     * Only the changed service directories are read again but the
+     * supervisor of every known service is always checked so one which
+     * died is restarted.
+     *
+     * \param timeout Check every service rather than only the changes.
      */
     virtual void Scan(bool timeout) {
         if (!mutex.HasLock() || exiting) {
@@ -304,20 +701,47 @@ class SvScanTmpl {
 
         VLOG(2) << "Scanning directory " << scan_dir;
 
-        for (TService& service : services) {
-            service.Reset();
+        winss::ScanChanges changes = Diff(timeout);
+
+        VLOG(3)
+            << "Found "
+            << changes.checked.size()
+            << " changed and "
+            << changes.removed.size()
+            << " removed service directories";
+
+        for (const auto& name : changes.removed) {
+            held.erase(name);
+            graph.Remove(name);
+
+            auto it = services.find(name);
+            if (it != services.end()) {
+                VLOG(2) << "Service " << name << " was removed";
+                it->second.Reset();
+                inactive.insert(name);
+            }
         }
 
-        for (auto dir : FILESYSTEM.GetDirectories(scan_dir)) {
+        for (const auto& dir : changes.checked) {
             Check(dir);
         }
 
+        for (const auto& name : changes.unchanged) {
+            auto it = services.find(name);
+            if (it != services.end()) {
+                it->second.Check();
+            }
+        }
+
         Schedule();
     }
 
     /**
      * Closes all the services.
      *
+     * Unless forced only the services which were removed since the last
+     * close are visited.
+     *
      * \param ignore_flagged Force the services to close.
      */
     virtual void CloseAllServices(bool ignore_flagged) {
@@ -327,16 +751,28 @@ class SvScanTmpl {
 
         VLOG(3) << "Closing all services (forced: " << ignore_flagged << ")";
 
-        auto it = services.begin();
-        while (it != services.end()) {
-            bool flagged = it->Close(ignore_flagged);
-            if (!flagged) {
-                VLOG(2) << "Removing service " << it->GetName();
-                it = services.erase(it);
-            } else {
-                ++it;
+        if (ignore_flagged) {
+            auto it = services.begin();
+            while (it != services.end()) {
+                bool flagged = it->second.Close(true);
+                if (!flagged) {
+                    VLOG(2) << "Removing service " << it->first;
+                    it = services.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        } else {
+            for (const auto& name : inactive) {
+                auto it = services.find(name);
+                if (it != services.end() && !it->second.Close(false)) {
+                    VLOG(2) << "Removing service " << it->first;
+                    services.erase(it);
+                }
             }
         }
+
+        inactive.clear();
     }
 
 
@@ -350,6 +786,15 @@ class SvScanTmpl {
         multiplexer->Stop(0);
     }
 
+    /**
+     * Closes the change notification if still open.
+     */
+    virtual ~SvScanTmpl() {
+        if (change != nullptr) {
+            WINDOWS.FindCloseChangeNotification(change);
+        }
+    }
+
     SvScanTmpl& operator=(const SvScanTmpl&) = delete;  /**< No copy. */
     SvScanTmpl& operator=(SvScanTmpl&&) = delete;  /**< No move. */
 };
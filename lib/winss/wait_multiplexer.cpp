@@ -16,24 +16,155 @@
 
 #include "wait_multiplexer.hpp"
 #include <windows.h>
+#include <algorithm>
 #include <chrono>
 #include <vector>
 #include <string>
-#include <map>
-#include <set>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <functional>
 #include "easylogging/easylogging++.hpp"
 #include "windows_interface.hpp"
 #include "handle_wrapper.hpp"
 #include "event_wrapper.hpp"
-#include "map_value_iterator.hpp"
+#include "sharded_wait.hpp"
 
 bool winss::WaitTimeoutItem::operator<(const winss::WaitTimeoutItem& rhs)
     const {
+    if (timeout == rhs.timeout) {
+        return id < rhs.id;
+    }
+
     return timeout < rhs.timeout;
 }
 
+void winss::WaitTimeoutHeap::Swap(size_t a, size_t b) {
+    std::swap(items[a], items[b]);
+    positions[items[a].id] = a;
+    positions[items[b].id] = b;
+}
+
+void winss::WaitTimeoutHeap::SiftUp(size_t pos) {
+    while (pos > 0) {
+        size_t parent = (pos - 1) / 2;
+        if (!(items[pos] < items[parent])) {
+            break;
+        }
+
+        Swap(pos, parent);
+        pos = parent;
+    }
+}
+
+void winss::WaitTimeoutHeap::SiftDown(size_t pos) {
+    size_t size = items.size();
+
+    while (true) {
+        size_t child = pos * 2 + 1;
+        if (child >= size) {
+            break;
+        }
+
+        if (child + 1 < size && items[child + 1] < items[child]) {
+            ++child;
+        }
+
+        if (!(items[child] < items[pos])) {
+            break;
+        }
+
+        Swap(pos, child);
+        pos = child;
+    }
+}
+
+winss::WaitTimeoutItem winss::WaitTimeoutHeap::RemoveAt(size_t pos) {
+    size_t last = items.size() - 1;
+    if (pos != last) {
+        Swap(pos, last);
+    }
+
+    winss::WaitTimeoutItem item = std::move(items.back());
+    items.pop_back();
+    positions.erase(item.id);
+
+    auto group_it = groups.find(item.group);
+    if (group_it != groups.end()) {
+        group_it->second.erase(item.id);
+        if (group_it->second.empty()) {
+            groups.erase(group_it);
+        }
+    }
+
+    if (pos < items.size()) {
+        SiftDown(pos);
+        SiftUp(pos);
+    }
+
+    return item;
+}
+
+winss::TimeoutId winss::WaitTimeoutHeap::Add(std::string group,
+    std::chrono::steady_clock::time_point timeout, winss::Callback callback) {
+    winss::TimeoutId id = next_id++;
+
+    groups[group].insert(id);
+    positions[id] = items.size();
+    items.push_back(winss::WaitTimeoutItem{
+        std::move(group), timeout, std::move(callback), id
+    });
+    SiftUp(items.size() - 1);
+
+    return id;
+}
+
+bool winss::WaitTimeoutHeap::Empty() const {
+    return items.empty();
+}
+
+size_t winss::WaitTimeoutHeap::Size() const {
+    return items.size();
+}
+
+const winss::WaitTimeoutItem& winss::WaitTimeoutHeap::Top() const {
+    return items.front();
+}
+
+winss::Callback winss::WaitTimeoutHeap::Pop() {
+    if (items.empty()) {
+        return winss::Callback();
+    }
+
+    return RemoveAt(0).callback;
+}
+
+bool winss::WaitTimeoutHeap::Remove(winss::TimeoutId id) {
+    auto it = positions.find(id);
+    if (it == positions.end()) {
+        return false;
+    }
+
+    RemoveAt(it->second);
+    return true;
+}
+
+bool winss::WaitTimeoutHeap::RemoveGroup(const std::string& group) {
+    auto group_it = groups.find(group);
+    if (group_it == groups.end()) {
+        return false;
+    }
+
+    std::vector<winss::TimeoutId> ids(group_it->second.begin(),
+        group_it->second.end());
+
+    for (winss::TimeoutId id : ids) {
+        RemoveAt(positions.at(id));
+    }
+
+    return true;
+}
+
 void winss::WaitMultiplexer::AddInitCallback(winss::Callback callback) {
     if (callback) {
         init_callbacks.push_back(std::move(callback));
@@ -43,18 +174,25 @@ void winss::WaitMultiplexer::AddInitCallback(winss::Callback callback) {
 void winss::WaitMultiplexer::AddTriggeredCallback(
     const winss::HandleWrapper& handle, winss::TriggeredCallback callback) {
     if (handle.HasHandle() && callback) {
-        trigger_callbacks.emplace(handle, std::move(callback));
+        auto inserted = trigger_slots.emplace(handle.handle,
+            trigger_handles.size());
+        if (inserted.second) {
+            trigger_handles.push_back(handle.handle);
+            trigger_callbacks.push_back(std::move(callback));
+        }
     }
 }
 
-void winss::WaitMultiplexer::AddTimeoutCallback(DWORD timeout,
+winss::TimeoutId winss::WaitMultiplexer::AddTimeoutCallback(DWORD timeout,
     winss::Callback callback, std::string group) {
     if (callback && timeout != INFINITE) {
-        auto now = std::chrono::system_clock::now();
+        auto now = std::chrono::steady_clock::now();
         auto timeout_time = now + std::chrono::milliseconds(timeout);
-        timeout_callbacks.insert(std::move(
-            winss::WaitTimeoutItem{ group, timeout_time, callback }));
+        return timeout_callbacks.Add(std::move(group), timeout_time,
+            std::move(callback));
     }
+
+    return 0;
 }
 
 void winss::WaitMultiplexer::AddStopCallback(winss::Callback callback) {
@@ -65,37 +203,103 @@ void winss::WaitMultiplexer::AddStopCallback(winss::Callback callback) {
 
 bool winss::WaitMultiplexer::RemoveTriggeredCallback(
     const winss::HandleWrapper& handle) {
-    auto mapping_it = trigger_callbacks.find(handle);
-    if (mapping_it != trigger_callbacks.end()) {
-        trigger_callbacks.erase(mapping_it);
+    auto it = trigger_slots.find(handle.handle);
+    if (it != trigger_slots.end()) {
+        RemoveTriggeredSlot(it->second);
         return true;
     }
 
     return false;
 }
 
-bool winss::WaitMultiplexer::RemoveTimeoutCallback(std::string group) {
-    bool found = false;
+void winss::WaitMultiplexer::RemoveTriggeredSlot(size_t slot) {
+    size_t last = trigger_handles.size() - 1;
+    trigger_slots.erase(trigger_handles[slot]);
 
-    auto it = timeout_callbacks.begin();
-    while (it != timeout_callbacks.end()) {
-        if (it->group == group) {
-            it = timeout_callbacks.erase(it);
-            found = true;
-        } else {
-            ++it;
+    if (slot != last) {
+        trigger_handles[slot] = trigger_handles[last];
+        trigger_callbacks[slot] = std::move(trigger_callbacks[last]);
+        trigger_slots[trigger_handles[slot]] = slot;
+    }
+
+    trigger_handles.pop_back();
+    trigger_callbacks.pop_back();
+}
+
+void winss::WaitMultiplexer::DispatchSlot(size_t slot) {
+    winss::HandleWrapper handle(trigger_handles[slot], false);
+    auto callback = std::move(trigger_callbacks[slot]);
+    RemoveTriggeredSlot(slot);
+    callback(*this, handle);
+}
+
+void winss::WaitMultiplexer::GatherReady(size_t first, size_t last,
+    HANDLE skip) {
+    while (first < last) {
+        size_t end = std::min<size_t>(first + MAXIMUM_WAIT_OBJECTS, last);
+        size_t offset = 0;
+        winss::WaitResultState state = waiter.Wait(0,
+            trigger_handles.data() + first, end - first, &offset);
+
+        if (state == FAILED) {
+            break;
+        } else if (state == TIMEOUT) {
+            first = end;
+            continue;
+        }
+
+        HANDLE handle = trigger_handles[first + offset];
+        if (handle != skip) {
+            ready.push_back(handle);
         }
+
+        first += offset + 1;
+    }
+}
+
+void winss::WaitMultiplexer::DispatchReady(size_t slot) {
+    size_t size = trigger_handles.size();
+    HANDLE signalled = trigger_handles[slot];
+
+    ready.clear();
+    ready.push_back(signalled);
+
+    if (dispatch_mode == DISPATCH_FAIR) {
+        size_t start = fair_start++ % size;
+        GatherReady(start, size, signalled);
+        GatherReady(0, start, signalled);
+    } else {
+        GatherReady(slot + 1, size, signalled);
     }
 
-    return found;
+    VLOG(7) << "Dispatching " << ready.size() << " signalled handles";
+
+    for (HANDLE handle : ready) {
+        auto it = trigger_slots.find(handle);
+        if (it != trigger_slots.end()) {
+            DispatchSlot(it->second);
+        }
+    }
+}
+
+bool winss::WaitMultiplexer::RemoveTimeoutCallback(std::string group) {
+    return timeout_callbacks.RemoveGroup(group);
+}
+
+bool winss::WaitMultiplexer::RemoveTimeoutCallbackById(winss::TimeoutId id) {
+    return timeout_callbacks.Remove(id);
+}
+
+void winss::WaitMultiplexer::SetDispatchMode(
+    winss::WaitDispatchMode mode) {
+    dispatch_mode = mode;
 }
 
 DWORD winss::WaitMultiplexer::GetTimeout() const {
-    auto it = timeout_callbacks.begin();
-    if (it != timeout_callbacks.end()) {
-        auto now = std::chrono::system_clock::now();
+    if (!timeout_callbacks.Empty()) {
+        auto now = std::chrono::steady_clock::now();
         auto timeout = std::chrono::duration_cast<std::chrono::milliseconds>(
-            it->timeout - now);
+            timeout_callbacks.Top().timeout - now);
 
         auto timeout_count = timeout.count();
         if (timeout_count > 0) {
@@ -110,15 +314,7 @@ DWORD winss::WaitMultiplexer::GetTimeout() const {
 }
 
 winss::Callback winss::WaitMultiplexer::GetTimeoutCallback() {
-    Callback func;
-
-    auto it = timeout_callbacks.begin();
-    if (it != timeout_callbacks.end()) {
-        func = std::move(it->callback);
-        timeout_callbacks.erase(it);
-    }
-
-    return func;
+    return timeout_callbacks.Pop();
 }
 
 int winss::WaitMultiplexer::Start() {
@@ -133,47 +329,43 @@ int winss::WaitMultiplexer::Start() {
         callback(*this);
     }
 
-    while (!trigger_callbacks.empty()) {
+    while (!trigger_handles.empty()) {
         VLOG(7)
             << "Multiplexer waiting with "
-            << trigger_callbacks.size()
+            << trigger_handles.size()
             << " handles";
 
         DWORD timeout = GetTimeout();
-        winss::WaitResult result{ TIMEOUT };
+        winss::WaitResultState state = TIMEOUT;
+        size_t slot = 0;
         if (timeout > 0) {
-            auto begin = winss::MapKeyIterator<winss::HandleWrapper,
-                winss::TriggeredCallback>(
-                    trigger_callbacks.begin());
-
-            auto end = winss::MapKeyIterator<winss::HandleWrapper,
-                winss::TriggeredCallback>(
-                    trigger_callbacks.end());
-
-            result = winss::HandleWrapper::Wait(timeout, begin, end);
+            state = waiter.Wait(timeout, trigger_handles.data(),
+                trigger_handles.size(), &slot);
         }
 
-        if (result.state == TIMEOUT) {
+        if (state == TIMEOUT) {
             auto callback = GetTimeoutCallback();
             if (callback) {
                 callback(*this);
-                continue;
             }
+            continue;
         }
 
-        if (result.state == FAILED) {
+        if (state == FAILED) {
             VLOG(1)
                 << "Failed to wait on handles: "
                 << WINDOWS.GetLastError();
             break;
         }
 
-        auto callback = trigger_callbacks.at(result.handle);
-        RemoveTriggeredCallback(result.handle);
-        callback(*this, result.handle);
+        if (dispatch_mode == DISPATCH_SINGLE) {
+            DispatchSlot(slot);
+        } else {
+            DispatchReady(slot);
+        }
     }
 
-    if (trigger_callbacks.empty()) {
+    if (trigger_handles.empty()) {
         VLOG(7)
             << "No more callbacks to wait on (exiting: "
             << return_code
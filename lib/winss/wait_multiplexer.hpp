@@ -19,13 +19,15 @@
 
 #include <windows.h>
 #include <chrono>
+#include <cstdint>
 #include <vector>
 #include <string>
-#include <map>
-#include <set>
+#include <unordered_map>
+#include <unordered_set>
 #include <functional>
 #include "handle_wrapper.hpp"
 #include "event_wrapper.hpp"
+#include "sharded_wait.hpp"
 
 namespace winss {
 class WaitMultiplexer;
@@ -41,6 +43,11 @@ typedef std::function<void(WaitMultiplexer&)> Callback;
 typedef std::function<void(WaitMultiplexer&,
     const winss::HandleWrapper&)> TriggeredCallback;
 
+/**
+ * Identifies a timeout item. Zero is never used as an ID.
+ */
+typedef uint64_t TimeoutId;
+
 /**
  * Holds timeout information such that when a timeout occurs the multiplexer
  * knows how to handle it.
@@ -51,19 +58,137 @@ struct WaitTimeoutItem {
     /** Used to identify the group of items when removing them. */
     std::string group;
     /** The point in time the timeout will be in effect. **/
-    std::chrono::system_clock::time_point timeout;
+    std::chrono::steady_clock::time_point timeout;
     Callback callback;  /**< The call back for when the timeout occurs. */
+    TimeoutId id;  /**< The unique ID of the item. */
 
     /**
      * Used to order the timeout items such as next item is the one with the
      * point in time closest to now.
      *
+     * Items with the same point in time are ordered by ID so the one added
+     * first comes first.
+     *
      * \param rhs The other timeout item.
      * \return True if this point in time is less than rhs otherwise false.
      */
     bool operator<(const WaitTimeoutItem& rhs) const;
 };
 
+/**
+ * A binary min-heap of timeout items indexed by ID and group.
+ *
+ * Adding, removing by ID and taking the next item are O(log n) and removing
+ * a group is O(k log n) for the k items in the group.
+ */
+class WaitTimeoutHeap {
+ private:
+    std::vector<WaitTimeoutItem> items;  /**< The heap of items. */
+    /** The position of each item in the heap. */
+    std::unordered_map<TimeoutId, size_t> positions;
+    /** The IDs of the items in each group. */
+    std::unordered_map<std::string, std::unordered_set<TimeoutId>> groups;
+    TimeoutId next_id = 1;  /**< The ID of the next item. */
+
+    /**
+     * Swaps two items in the heap keeping the positions up to date.
+     *
+     * \param a The position of the first item.
+     * \param b The position of the second item.
+     */
+    void Swap(size_t a, size_t b);
+
+    /**
+     * Moves an item up the heap until its parent comes before it.
+     *
+     * \param pos The position of the item.
+     */
+    void SiftUp(size_t pos);
+
+    /**
+     * Moves an item down the heap until it comes before its children.
+     *
+     * \param pos The position of the item.
+     */
+    void SiftDown(size_t pos);
+
+    /**
+     * Removes the item at the given position.
+     *
+     * \param pos The position of the item.
+     * \return The removed item.
+     */
+    WaitTimeoutItem RemoveAt(size_t pos);
+
+ public:
+    /**
+     * Adds a timeout item.
+     *
+     * \param group The group of the item.
+     * \param timeout The point in time of the timeout.
+     * \param callback The callback for when the timeout occurs.
+     * \return The ID of the new item.
+     */
+    TimeoutId Add(std::string group,
+        std::chrono::steady_clock::time_point timeout, Callback callback);
+
+    /**
+     * Gets if there are no items.
+     *
+     * \return True if there are no items otherwise false.
+     */
+    bool Empty() const;
+
+    /**
+     * Gets the number of items.
+     *
+     * \return The number of items.
+     */
+    size_t Size() const;
+
+    /**
+     * Gets the next item which must not be called when empty.
+     *
+     * \return The item with the point in time closest to now.
+     */
+    const WaitTimeoutItem& Top() const;
+
+    /**
+     * Removes the next item if there is one.
+     *
+     * \return The callback of the removed item or an empty callback.
+     */
+    Callback Pop();
+
+    /**
+     * Removes the item with the given ID.
+     *
+     * \param id The ID of the item.
+     * \return True if the item was removed otherwise false.
+     */
+    bool Remove(TimeoutId id);
+
+    /**
+     * Removes all the items in the given group.
+     *
+     * \param group The group of the items.
+     * \return True if any items were removed otherwise false.
+     */
+    bool RemoveGroup(const std::string& group);
+};
+
+/**
+ * How the multiplexer dispatches signalled handles.
+ */
+enum WaitDispatchMode {
+    /** Dispatch the lowest signalled handle on each wake-up. */
+    DISPATCH_SINGLE,
+    /** Dispatch every signalled handle on each wake-up in rotating order. */
+    DISPATCH_FAIR,
+    /** Dispatch every signalled handle on each wake-up in slot order. */
+    DISPATCH_BATCH
+};
+
 /**
 * A HANDLE wait multiplexer 
 */
@@ -75,23 +200,76 @@ class WaitMultiplexer {
     int return_code = 0;
     /** Callbacks to call on initialization. */
     std::vector<Callback> init_callbacks;
-    /** Wait events translate to trigger callbacks. */
-    std::map<winss::HandleWrapper, TriggeredCallback> trigger_callbacks;
+    /** The handles to wait on which is only changed on add and remove. */
+    std::vector<HANDLE> trigger_handles;
+    /** Trigger callbacks in the same slot as their handle. */
+    std::vector<TriggeredCallback> trigger_callbacks;
+    /** The slot of each handle. */
+    std::unordered_map<HANDLE, size_t> trigger_slots;
     /** The timeout callback items. */
-    std::set<WaitTimeoutItem> timeout_callbacks;
+    WaitTimeoutHeap timeout_callbacks;
     /** Callbacks to call on stop. */
     std::vector<Callback> stop_callbacks;
+    /** Waits on the trigger handles even beyond MAXIMUM_WAIT_OBJECTS. */
+    winss::ShardedWait waiter;
+    /** How signalled handles are dispatched. */
+    WaitDispatchMode dispatch_mode = DISPATCH_SINGLE;
+    /** Where the next fair dispatch starts polling. */
+    size_t fair_start = 0;
+    /** The signalled handles gathered on a wake-up. */
+    std::vector<HANDLE> ready;
 
     /**
      * Gets the next timeout callback.
      *
-     * It will simply get the first item in the timeout_callbacks which is a
-     * sorted set of callback items.
+     * It pops the earliest item off the timeout_callbacks heap, removing it
+     * from its group as well.
      *
      * \return The callback which can be directly invoked.
      */
     Callback GetTimeoutCallback();
 
+    /**
+     * Removes the triggered callback in the given slot.
+     *
+     * The last slot is moved into its place so the handles stay contiguous.
+     *
+     * \param slot The slot of the handle and callback.
+     */
+    void RemoveTriggeredSlot(size_t slot);
+
+    /**
+     * Removes the triggered callback in the given slot and calls it.
+     *
+     * \param slot The slot of the handle and callback.
+     */
+    void DispatchSlot(size_t slot);
+
+    /**
+     * Gathers every signalled handle in the given range of slots.
+     *
+     * Each poll has a zero timeout and continues after the handle it found.
+     * At most MAXIMUM_WAIT_OBJECTS slots are polled at once so polls never
+     * need the shard threads.
+     *
+     * \param first The first slot to poll.
+     * \param last One past the last slot to poll.
+     * \param skip A handle which has already been gathered.
+     */
+    void GatherReady(size_t first, size_t last, HANDLE skip);
+
+    /**
+     * Dispatches the signalled handle and then every other handle which is
+     * signalled before waiting again.
+     *
+     * In fair mode polling starts at a slot which moves on with each wake-up.
+     * In batch mode only the slots after the signalled one are polled as the
+     * wait always reports the lowest signalled slot.
+     *
+     * \param slot The slot which was signalled.
+     */
+    void DispatchReady(size_t slot);
+
  public:
     /** The default constructor. */
     WaitMultiplexer() {}
@@ -121,8 +299,9 @@ class WaitMultiplexer {
      * \param timeout The time in ms from now.
      * \param callback The callback to call on timeout event.
      * \param group The group to identify the callback.
+     * \return The ID of the timeout or 0 if it was not added.
      */
-    virtual void AddTimeoutCallback(DWORD timeout,
+    virtual TimeoutId AddTimeoutCallback(DWORD timeout,
         Callback callback, std::string group = "");
 
     /**
@@ -146,6 +325,27 @@ class WaitMultiplexer {
      */
     virtual bool RemoveTimeoutCallback(std::string group);
 
+    /**
+     * Removes the timeout call back with the given ID.
+     *
+     * \param id The ID which was returned when the callback was added.
+     * \return True if the timeout callback was removed otherwise false.
+     */
+    virtual bool RemoveTimeoutCallbackById(TimeoutId id);
+
+    /**
+     * Sets how signalled handles are dispatched.
+     *
+     * In fair mode every handle which is signalled when the multiplexer
+     * wakes up is dispatched before waiting again so a handle which is
+     * always busy cannot starve the others. Batch mode also drains every
+     * signalled handle but with the fewest polls which suits bursts such as
+     * many supervisors changing state at once.
+     *
+     * \param mode The dispatch mode.
+     */
+    virtual void SetDispatchMode(WaitDispatchMode mode);
+
     /**
      * Gets the next timeout in ms from now.
      *
@@ -157,7 +357,9 @@ class WaitMultiplexer {
      * Starts the multiplexer which will block until some other event stops it.
      *
      * It will go into a loop calling WaitForMultipleObjects with all handles
-     * and the next timeout. When this returns the multiplexer will work out
+     * and the next timeout. More than MAXIMUM_WAIT_OBJECTS handles are
+     * waited on in shards by helper threads though callbacks are only ever
+     * called on this thread. When this returns the multiplexer will work out
      * which event fired or timed out and will call the appropriate callback.
      *
      * \return The exit code which was set.
@@ -96,6 +96,11 @@ bool winss::WindowsInterface::GetOverlappedResult(HANDLE handle,
     return ::GetOverlappedResult(handle, overlapped, bytes, wait) != 0;
 }
 
+bool winss::WindowsInterface::CancelIoEx(HANDLE handle,
+    LPOVERLAPPED overlapped) const {
+    return ::CancelIoEx(handle, overlapped) != 0;
+}
+
 bool winss::WindowsInterface::ReadFile(HANDLE handle, LPVOID buffer,
     DWORD to_read, LPDWORD read, LPOVERLAPPED overlapped) const {
     return ::ReadFile(handle, buffer, to_read, read, overlapped) != 0;
@@ -106,6 +111,42 @@ bool winss::WindowsInterface::WriteFile(HANDLE handle, LPCVOID buffer,
     return ::WriteFile(handle, buffer, to_write, written, overlapped) != 0;
 }
 
+HANDLE winss::WindowsInterface::CreateIoCompletionPort(HANDLE file_handle,
+    HANDLE existing_port, ULONG_PTR completion_key,
+    DWORD concurrent_threads) const {
+    return ::CreateIoCompletionPort(file_handle, existing_port,
+        completion_key, concurrent_threads);
+}
+
+bool winss::WindowsInterface::GetQueuedCompletionStatusEx(HANDLE port,
+    LPOVERLAPPED_ENTRY entries, ULONG count, PULONG removed,
+    DWORD timeout, bool alertable) const {
+    return ::GetQueuedCompletionStatusEx(port, entries, count, removed,
+        timeout, alertable) != 0;
+}
+
+bool winss::WindowsInterface::PostQueuedCompletionStatus(HANDLE port,
+    DWORD bytes, ULONG_PTR completion_key, LPOVERLAPPED overlapped) const {
+    return ::PostQueuedCompletionStatus(port, bytes, completion_key,
+        overlapped) != 0;
+}
+
+HANDLE winss::WindowsInterface::FindFirstChangeNotification(
+    LPCTSTR path_name, bool watch_subtree, DWORD notify_filter) const {
+    return ::FindFirstChangeNotification(path_name, watch_subtree,
+        notify_filter);
+}
+
+bool winss::WindowsInterface::FindNextChangeNotification(
+    HANDLE handle) const {
+    return ::FindNextChangeNotification(handle) != 0;
+}
+
+bool winss::WindowsInterface::FindCloseChangeNotification(
+    HANDLE handle) const {
+    return ::FindCloseChangeNotification(handle) != 0;
+}
+
 DWORD winss::WindowsInterface::WaitForSingleObject(
     HANDLE handle, DWORD timeout) const {
     return ::WaitForSingleObject(handle, timeout);
@@ -120,6 +120,11 @@ class WindowsInterface {
     virtual bool GetOverlappedResult(HANDLE handle, LPOVERLAPPED overlapped,
         LPDWORD bytes, BOOL wait) const;
 
+    /**
+     * <a href="https://msdn.microsoft.com/en-us/library/windows/desktop/aa363792.aspx">CancelIoEx</a>
+     */
+    virtual bool CancelIoEx(HANDLE handle, LPOVERLAPPED overlapped) const;
+
     /**
      * <a href="https://msdn.microsoft.com/en-us/library/windows/desktop/aa365467.aspx">ReadFile</a>
      */
@@ -132,6 +137,42 @@ class WindowsInterface {
     virtual bool WriteFile(HANDLE handle, LPCVOID buffer, DWORD to_write,
         LPDWORD written, LPOVERLAPPED overlapped) const;
 
+    /**
+     * <a href="https://msdn.microsoft.com/en-us/library/windows/desktop/aa363862.aspx">CreateIoCompletionPort</a>
+     */
+    virtual HANDLE CreateIoCompletionPort(HANDLE file_handle,
+        HANDLE existing_port, ULONG_PTR completion_key,
+        DWORD concurrent_threads) const;
+
+    /**
+     * <a href="https://msdn.microsoft.com/en-us/library/windows/desktop/aa364988.aspx">GetQueuedCompletionStatusEx</a>
+     */
+    virtual bool GetQueuedCompletionStatusEx(HANDLE port,
+        LPOVERLAPPED_ENTRY entries, ULONG count, PULONG removed,
+        DWORD timeout, bool alertable) const;
+
+    /**
+     * <a href="https://msdn.microsoft.com/en-us/library/windows/desktop/aa365458.aspx">PostQueuedCompletionStatus</a>
+     */
+    virtual bool PostQueuedCompletionStatus(HANDLE port, DWORD bytes,
+        ULONG_PTR completion_key, LPOVERLAPPED overlapped) const;
+
+    /**
+     * <a href="https://msdn.microsoft.com/en-us/library/windows/desktop/aa364417.aspx">FindFirstChangeNotification</a>
+     */
+    virtual HANDLE FindFirstChangeNotification(LPCTSTR path_name,
+        bool watch_subtree, DWORD notify_filter) const;
+
+    /**
+     * <a href="https://msdn.microsoft.com/en-us/library/windows/desktop/aa364427.aspx">FindNextChangeNotification</a>
+     */
+    virtual bool FindNextChangeNotification(HANDLE handle) const;
+
+    /**
+     * <a href="https://msdn.microsoft.com/en-us/library/windows/desktop/aa364413.aspx">FindCloseChangeNotification</a>
+     */
+    virtual bool FindCloseChangeNotification(HANDLE handle) const;
+
     /**
      * <a href="https://msdn.microsoft.com/en-us/library/windows/desktop/ms687032.aspx">WaitForSingleObject</a>
      */
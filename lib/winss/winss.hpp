@@ -19,6 +19,9 @@
 
 #define ELPP_NO_DEFAULT_LOG_FILE
 #define ELPP_CUSTOM_COUT std::cerr
+#ifndef ELPP_THREAD_SAFE
+#define ELPP_THREAD_SAFE
+#endif
 #ifndef SUFFIX
 #define SUFFIX ""
 #endif
@@ -8,6 +8,7 @@ workspace "WindowsSupervisionSuite"
     defines {
       "VC_EXTRALEAN",
       "WINS32_LEAN_AND_MEAN",
+      "ELPP_THREAD_SAFE",
       'PROJECT_NAME="$(ProjectName)"',
       'YEAR=' .. os.date("%Y")
     }
@@ -106,3 +107,11 @@ workspace "WindowsSupervisionSuite"
       files { "test/**", "bin/resource/*" }
       buildoptions { "/bigobj" }
       linkoptions { "/OPT:NOREF", "/OPT:NOICF", "/INCREMENTAL:NO" }
+
+    project "winss-benchmark"
+      kind "ConsoleApp"
+      links { "winss" }
+      includedirs { "lib" }
+      nuget { "gmock:1.7.0" }
+      files { "benchmark/**", "bin/resource/*" }
+      buildoptions { "/bigobj" }
@@ -0,0 +1,302 @@
+/*
+* Copyright 2016-2017 Morgan Stanley
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <windows.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include "winss/winss.hpp"
+#include "winss/completion_port.hpp"
+#include "winss/handle_wrapper.hpp"
+#include "winss/not_owning_ptr.hpp"
+#include "mock_interface.hpp"
+#include "mock_windows_interface.hpp"
+#include "mock_wait_multiplexer.hpp"
+
+using ::testing::_;
+using ::testing::AnyNumber;
+using ::testing::Invoke;
+using ::testing::NiceMock;
+using ::testing::Return;
+
+namespace winss {
+class CompletionPortTest : public testing::Test {
+ protected:
+    HANDLE port = reinterpret_cast<HANDLE>(7000);
+    std::mutex mutex;
+    std::condition_variable posted;
+    std::deque<OVERLAPPED_ENTRY> queued;
+    size_t dequeue_calls = 0;
+
+    /**
+     * Routes the completion port functions to an in memory queue.
+     */
+    void SetupPort(MockInterface<winss::MockWindowsInterface>* windows) {
+        (*windows)->SetupDefaults();
+
+        EXPECT_CALL(**windows, CreateIoCompletionPort(_, _, _, _))
+            .WillRepeatedly(Return(port));
+
+        EXPECT_CALL(**windows, PostQueuedCompletionStatus(port, _, _, _))
+            .WillRepeatedly(Invoke([this](HANDLE, DWORD bytes, ULONG_PTR key,
+                LPOVERLAPPED overlapped) {
+            std::lock_guard<std::mutex> lock(mutex);
+            queued.push_back({ key, overlapped, 0, bytes });
+            posted.notify_all();
+            return true;
+        }));
+
+        EXPECT_CALL(**windows,
+            GetQueuedCompletionStatusEx(port, _, _, _, _, _))
+            .WillRepeatedly(Invoke([this](HANDLE,
+                LPOVERLAPPED_ENTRY entries, ULONG count, PULONG removed,
+                DWORD, bool) {
+            std::unique_lock<std::mutex> lock(mutex);
+            posted.wait(lock, [this]() { return !queued.empty(); });
+            dequeue_calls++;
+
+            ULONG i = 0;
+            for (; i < count && !queued.empty(); ++i) {
+                entries[i] = queued.front();
+                queued.pop_front();
+            }
+
+            *removed = i;
+            return true;
+        }));
+
+        EXPECT_CALL(**windows, CloseHandle(_)).Times(AnyNumber());
+        EXPECT_CALL(**windows, CloseHandle(port)).WillOnce(Return(true));
+    }
+
+    /**
+     * Dispatches the ready callback until the expected number of keys have
+     * been dispatched.
+     */
+    void DispatchUntil(NiceMock<winss::MockWaitMultiplexer>* multiplexer,
+        const size_t* dispatched, size_t expected) {
+        for (int i = 0; i < 100 && *dispatched < expected; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            winss::TriggeredCallback callback =
+                multiplexer->mock_triggered_callbacks.back();
+            multiplexer->mock_triggered_callbacks.clear();
+            callback(*multiplexer, winss::HandleWrapper());
+        }
+    }
+};
+
+TEST_F(CompletionPortTest, AddTriggeredCallback) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    NiceMock<winss::MockWaitMultiplexer> multiplexer;
+
+    EXPECT_CALL(multiplexer, AddTriggeredCallback(_, _)).Times(1);
+
+    winss::CompletionPort completion_port(winss::NotOwned(&multiplexer));
+
+    for (int i = 1; i <= 100; ++i) {
+        completion_port.AddTriggeredCallback(winss::HandleWrapper(
+            reinterpret_cast<HANDLE>(i), false),
+            [](winss::WaitMultiplexer&, const winss::HandleWrapper&) {});
+    }
+
+    EXPECT_EQ(100, completion_port.CallbackCount());
+    EXPECT_TRUE(completion_port.RemoveTriggeredCallback(
+        winss::HandleWrapper(reinterpret_cast<HANDLE>(1), false)));
+    EXPECT_FALSE(completion_port.RemoveTriggeredCallback(
+        winss::HandleWrapper(reinterpret_cast<HANDLE>(1), false)));
+    EXPECT_EQ(99, completion_port.CallbackCount());
+}
+
+TEST_F(CompletionPortTest, AssociateFailed) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    NiceMock<winss::MockWaitMultiplexer> multiplexer;
+
+    EXPECT_CALL(*windows, CreateIoCompletionPort(_, _, _, _))
+        .WillOnce(Return(nullptr));
+    EXPECT_CALL(*windows, GetQueuedCompletionStatusEx(_, _, _, _, _, _))
+        .Times(0);
+
+    winss::CompletionPort completion_port(winss::NotOwned(&multiplexer));
+
+    EXPECT_FALSE(completion_port.Associate(
+        reinterpret_cast<HANDLE>(10000), reinterpret_cast<HANDLE>(9000)));
+    EXPECT_FALSE(completion_port.Post(reinterpret_cast<HANDLE>(9000)));
+}
+
+TEST_F(CompletionPortTest, Dispatch) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    NiceMock<winss::MockWaitMultiplexer> multiplexer;
+    SetupPort(&windows);
+
+    HANDLE file1 = reinterpret_cast<HANDLE>(10000);
+    HANDLE file2 = reinterpret_cast<HANDLE>(20000);
+    HANDLE key1 = reinterpret_cast<HANDLE>(9000);
+    HANDLE key2 = reinterpret_cast<HANDLE>(9001);
+
+    EXPECT_CALL(*windows, CreateIoCompletionPort(INVALID_HANDLE_VALUE,
+        nullptr, 0, 1)).WillOnce(Return(port));
+    EXPECT_CALL(*windows, CreateIoCompletionPort(file1, port,
+        reinterpret_cast<ULONG_PTR>(key1), 0)).WillOnce(Return(port));
+    EXPECT_CALL(*windows, CreateIoCompletionPort(file2, port,
+        reinterpret_cast<ULONG_PTR>(key2), 0)).WillOnce(Return(port));
+
+    {
+        winss::CompletionPort completion_port(winss::NotOwned(&multiplexer));
+
+        EXPECT_TRUE(completion_port.Associate(file1, key1));
+        EXPECT_TRUE(completion_port.Associate(file2, key2));
+
+        std::vector<HANDLE> order;
+        size_t dispatched = 0;
+        winss::TriggeredCallback callback = [&](winss::WaitMultiplexer& m,
+            const winss::HandleWrapper& handle) {
+            EXPECT_EQ(&multiplexer, &m);
+            order.push_back(handle == key1 ? key1 : key2);
+            dispatched++;
+        };
+
+        completion_port.AddTriggeredCallback(
+            winss::HandleWrapper(key1, false), callback);
+        completion_port.AddTriggeredCallback(
+            winss::HandleWrapper(key2, false), callback);
+        EXPECT_EQ(1, multiplexer.mock_triggered_callbacks.size());
+
+        EXPECT_TRUE(completion_port.Post(key2));
+        EXPECT_TRUE(completion_port.Post(key1));
+
+        DispatchUntil(&multiplexer, &dispatched, 2);
+
+        ASSERT_EQ(2, order.size());
+        EXPECT_EQ(key2, order[0]);
+        EXPECT_EQ(key1, order[1]);
+        EXPECT_EQ(0, completion_port.CallbackCount());
+        EXPECT_TRUE(multiplexer.mock_triggered_callbacks.empty());
+    }
+
+    EXPECT_TRUE(queued.empty());
+}
+
+TEST_F(CompletionPortTest, DispatchUnknownKey) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    NiceMock<winss::MockWaitMultiplexer> multiplexer;
+    SetupPort(&windows);
+
+    HANDLE key1 = reinterpret_cast<HANDLE>(9000);
+    HANDLE key2 = reinterpret_cast<HANDLE>(9001);
+
+    winss::CompletionPort completion_port(winss::NotOwned(&multiplexer));
+    EXPECT_TRUE(completion_port.Associate(reinterpret_cast<HANDLE>(10000),
+        key1));
+
+    size_t dispatched = 0;
+    completion_port.AddTriggeredCallback(winss::HandleWrapper(key1, false),
+        [&](winss::WaitMultiplexer& m, const winss::HandleWrapper&) {
+        dispatched++;
+    });
+
+    EXPECT_TRUE(completion_port.Post(key2));
+
+    for (int i = 0; i < 100; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        std::lock_guard<std::mutex> lock(mutex);
+        if (dequeue_calls > 0) {
+            break;
+        }
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    multiplexer.mock_triggered_callbacks.at(0)(multiplexer,
+        winss::HandleWrapper());
+
+    EXPECT_EQ(0, dispatched);
+    EXPECT_EQ(1, completion_port.CallbackCount());
+    EXPECT_EQ(2, multiplexer.mock_triggered_callbacks.size());
+
+    size_t late = 0;
+    completion_port.AddTriggeredCallback(winss::HandleWrapper(key2, false),
+        [&](winss::WaitMultiplexer& m, const winss::HandleWrapper& handle) {
+        EXPECT_EQ(key2, handle);
+        late++;
+    });
+
+    ASSERT_EQ(2, multiplexer.mock_triggered_callbacks.size());
+    multiplexer.mock_triggered_callbacks.at(1)(multiplexer,
+        winss::HandleWrapper());
+
+    EXPECT_EQ(0, dispatched);
+    EXPECT_EQ(1, late);
+    EXPECT_EQ(1, completion_port.CallbackCount());
+}
+
+TEST_F(CompletionPortTest, Disassociate) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    NiceMock<winss::MockWaitMultiplexer> multiplexer;
+    SetupPort(&windows);
+
+    HANDLE file = reinterpret_cast<HANDLE>(10000);
+    HANDLE key = reinterpret_cast<HANDLE>(9000);
+
+    winss::CompletionPort completion_port(winss::NotOwned(&multiplexer));
+    EXPECT_TRUE(completion_port.Associate(file, key));
+
+    size_t dispatched = 0;
+    winss::TriggeredCallback callback = [&](winss::WaitMultiplexer&,
+        const winss::HandleWrapper&) {
+        dispatched++;
+    };
+
+    completion_port.AddTriggeredCallback(winss::HandleWrapper(key, false),
+        callback);
+
+    // The last completion of the file is queued before it is closed.
+    EXPECT_TRUE(completion_port.Post(key));
+    completion_port.Disassociate(key);
+    EXPECT_EQ(0, completion_port.CallbackCount());
+    EXPECT_EQ(1, completion_port.ClosedCount());
+
+    // The handle value is reused by a new file.
+    EXPECT_TRUE(completion_port.Associate(file, key));
+    completion_port.AddTriggeredCallback(winss::HandleWrapper(key, false),
+        callback);
+
+    for (int i = 0; i < 100; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        std::lock_guard<std::mutex> lock(mutex);
+        if (queued.empty()) {
+            break;
+        }
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    multiplexer.mock_triggered_callbacks.back()(multiplexer,
+        winss::HandleWrapper());
+
+    EXPECT_EQ(0, dispatched);
+    EXPECT_EQ(0, completion_port.ClosedCount());
+    EXPECT_EQ(1, completion_port.CallbackCount());
+
+    EXPECT_TRUE(completion_port.Post(key));
+    DispatchUntil(&multiplexer, &dispatched, 1);
+
+    EXPECT_EQ(1, dispatched);
+    EXPECT_EQ(0, completion_port.CallbackCount());
+}
+}  // namespace winss
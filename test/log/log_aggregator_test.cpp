@@ -0,0 +1,357 @@
+/*
+* Copyright 2016-2017 Morgan Stanley
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <windows.h>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include "winss/winss.hpp"
+#include "winss/handle_wrapper.hpp"
+#include "winss/not_owning_ptr.hpp"
+#include "winss/log/log_aggregator.hpp"
+#include "../mock_interface.hpp"
+#include "../mock_windows_interface.hpp"
+#include "../mock_filesystem_interface.hpp"
+#include "../mock_path_mutex.hpp"
+#include "../mock_pipe_instance.hpp"
+#include "../mock_pipe_name.hpp"
+#include "../mock_wait_multiplexer.hpp"
+#include "mock_log_stream_wrapper.hpp"
+
+namespace fs = std::experimental::filesystem;
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::InSequence;
+using ::testing::NiceMock;
+using ::testing::Return;
+
+namespace winss {
+class LogAggregatorTest : public testing::Test {
+ protected:
+    /**
+     * Resolves relative paths against a fake scan directory.
+     */
+    void SetupFiles(MockInterface<winss::MockFilesystemInterface>* file,
+        const std::string& script) {
+        EXPECT_CALL(**file, Absolute(_))
+            .WillRepeatedly(Invoke([](const fs::path& path) {
+            std::string s = path.string();
+            if (s.size() > 1 && s[1] == ':') {
+                return path;
+            }
+
+            return fs::path("C:\\scan\\" + s);
+        }));
+        EXPECT_CALL(**file, Read(_)).WillRepeatedly(Return(script));
+        EXPECT_CALL(**file, DirectoryExists(_)).WillRepeatedly(Return(true));
+    }
+};
+class LockedPathMutex : public NiceMock<winss::MockPathMutex> {
+ public:
+    LockedPathMutex(fs::path path, std::string name) :
+        NiceMock<winss::MockPathMutex>(path, name) {
+        ON_CALL(*this, Lock()).WillByDefault(Return(true));
+    }
+};
+class OpenLogStreamWriter : public NiceMock<winss::MockLogStreamWriter> {
+ public:
+    explicit OpenLogStreamWriter(size_t buffer_size) :
+        NiceMock<winss::MockLogStreamWriter>(buffer_size) {
+        ON_CALL(*this, Open(_)).WillByDefault(Return(true));
+    }
+};
+class MockedLogAggregator : public winss::LogAggregatorTmpl<
+    winss::NiceMockInboundPipeInstance, winss::LockedPathMutex,
+    winss::OpenLogStreamWriter> {
+ public:
+    MockedLogAggregator(
+        winss::NotOwningPtr<winss::WaitMultiplexer> multiplexer,
+        const winss::PipeName& pipe_name) :
+        winss::LogAggregatorTmpl<winss::NiceMockInboundPipeInstance,
+        winss::LockedPathMutex, winss::OpenLogStreamWriter>
+        ::LogAggregatorTmpl(multiplexer, pipe_name) {}
+
+    winss::NiceMockInboundPipeInstance* GetPipe() {
+        return &pipes.begin()->second.instance;
+    }
+
+    winss::OpenLogStreamWriter* GetWriter(const std::string& name) {
+        return &streams.at(name).writer;
+    }
+
+    const winss::LogSettings& GetSettings(const std::string& name) {
+        return streams.at(name).settings;
+    }
+};
+
+TEST_F(LogAggregatorTest, Add) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    MockInterface<winss::MockFilesystemInterface> file;
+    NiceMock<winss::MockWaitMultiplexer> multiplexer;
+    SetupFiles(&file, "T s4096\n.\\main\n");
+
+    HANDLE client = reinterpret_cast<HANDLE>(10000);
+    EXPECT_CALL(*windows, CreateFile(_, GENERIC_WRITE, _, _, OPEN_EXISTING,
+        _, _)).WillOnce(Return(client));
+
+    winss::MockPipeName pipe_name("test");
+    MockedLogAggregator aggregator(winss::NotOwned(&multiplexer), pipe_name);
+
+    winss::HandleWrapper handle = aggregator.Add("svc", "svc\\log");
+    EXPECT_TRUE(handle == client);
+    EXPECT_EQ(1, aggregator.StreamCount());
+    EXPECT_EQ(1, aggregator.PipeCount());
+    EXPECT_EQ(1, multiplexer.mock_triggered_callbacks.size());
+
+    const winss::LogSettings& settings = aggregator.GetSettings("svc");
+    EXPECT_EQ(fs::path("C:\\scan\\svc\\log") / fs::path(".\\main"),
+        settings.log_dir);
+    EXPECT_TRUE(settings.timestamp);
+    EXPECT_EQ(4096, settings.file_size);
+
+    EXPECT_CALL(*windows, CreateFile(_, _, _, _, _, _, _))
+        .WillOnce(Return(reinterpret_cast<HANDLE>(20000)));
+
+    aggregator.Add("svc", "svc\\log");
+    EXPECT_EQ(1, aggregator.StreamCount());
+    EXPECT_EQ(2, aggregator.PipeCount());
+}
+
+TEST_F(LogAggregatorTest, AddDirectoryDoesNotExist) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    MockInterface<winss::MockFilesystemInterface> file;
+    NiceMock<winss::MockWaitMultiplexer> multiplexer;
+    SetupFiles(&file, "");
+
+    EXPECT_CALL(*file, DirectoryExists(_)).WillRepeatedly(Return(false));
+    EXPECT_CALL(*windows, CreateFile(_, _, _, _, _, _, _)).Times(0);
+
+    winss::MockPipeName pipe_name("test");
+    MockedLogAggregator aggregator(winss::NotOwned(&multiplexer), pipe_name);
+
+    EXPECT_FALSE(aggregator.Add("svc", "svc\\log").HasHandle());
+    EXPECT_EQ(0, aggregator.StreamCount());
+    EXPECT_EQ(0, aggregator.PipeCount());
+}
+
+TEST_F(LogAggregatorTest, AddCreateFileFailed) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    MockInterface<winss::MockFilesystemInterface> file;
+    NiceMock<winss::MockWaitMultiplexer> multiplexer;
+    SetupFiles(&file, "");
+
+    EXPECT_CALL(*windows, CreateFile(_, _, _, _, _, _, _))
+        .WillOnce(Return(INVALID_HANDLE_VALUE));
+
+    winss::MockPipeName pipe_name("test");
+    MockedLogAggregator aggregator(winss::NotOwned(&multiplexer), pipe_name);
+
+    EXPECT_FALSE(aggregator.Add("svc", "svc\\log").HasHandle());
+    EXPECT_EQ(1, aggregator.PipeCount());
+
+    winss::NiceMockInboundPipeInstance* pipe = aggregator.GetPipe();
+    EXPECT_CALL(*pipe, GetOverlappedResult()).WillOnce(Return(REMOVE));
+
+    multiplexer.mock_triggered_callbacks.at(0)(multiplexer,
+        pipe->GetHandle());
+    EXPECT_EQ(0, aggregator.PipeCount());
+    EXPECT_EQ(1, aggregator.StreamCount());
+}
+
+TEST_F(LogAggregatorTest, Lines) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    MockInterface<winss::MockFilesystemInterface> file;
+    NiceMock<winss::MockWaitMultiplexer> multiplexer;
+    SetupFiles(&file, "");
+
+    EXPECT_CALL(*windows, CreateFile(_, _, _, _, _, _, _))
+        .WillOnce(Return(reinterpret_cast<HANDLE>(10000)));
+
+    winss::MockPipeName pipe_name("test");
+    MockedLogAggregator aggregator(winss::NotOwned(&multiplexer), pipe_name);
+    aggregator.Add("svc", "svc\\log");
+
+    winss::NiceMockInboundPipeInstance* pipe = aggregator.GetPipe();
+    winss::OpenLogStreamWriter* writer = aggregator.GetWriter("svc");
+    winss::HandleWrapper handle = pipe->GetHandle();
+
+    EXPECT_CALL(*pipe, GetOverlappedResult())
+        .WillOnce(Return(CONTINUE))
+        .WillOnce(Return(CONTINUE))
+        .WillOnce(Return(CONTINUE))
+        .WillOnce(Return(REMOVE));
+    EXPECT_CALL(*pipe, SetConnected())
+        .WillOnce(Return(true))
+        .WillRepeatedly(Return(false));
+    EXPECT_CALL(*pipe, FinishRead()).WillRepeatedly(Return(true));
+    EXPECT_CALL(*pipe, SwapBuffer())
+        .WillOnce(Return(std::vector<char>{
+            'o', 'n', 'e', '\r', '\n', 't', 'w'
+        }))
+        .WillOnce(Return(std::vector<char>{
+            'o', '\n', '\n', 't', 'h', 'r', 'e', 'e'
+        }));
+    EXPECT_CALL(*pipe, Read()).Times(3);
+
+    {
+        InSequence sequence;
+        EXPECT_CALL(*writer, Write("one")).Times(1);
+        EXPECT_CALL(*writer, Write("two")).Times(1);
+        EXPECT_CALL(*writer, Write("")).Times(1);
+        EXPECT_CALL(*writer, Write("three")).Times(1);
+    }
+
+    for (int i = 0; i < 3; ++i) {
+        multiplexer.mock_triggered_callbacks.at(i)(multiplexer, handle);
+    }
+
+    aggregator.Remove("svc");
+    EXPECT_EQ(1, aggregator.StreamCount());
+
+    EXPECT_CALL(*writer, Close()).Times(1);
+    multiplexer.mock_triggered_callbacks.at(3)(multiplexer, handle);
+
+    EXPECT_EQ(0, aggregator.PipeCount());
+    EXPECT_EQ(0, aggregator.StreamCount());
+}
+
+TEST_F(LogAggregatorTest, LineChunks) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    MockInterface<winss::MockFilesystemInterface> file;
+    NiceMock<winss::MockWaitMultiplexer> multiplexer;
+    SetupFiles(&file, "l256");
+
+    EXPECT_CALL(*windows, CreateFile(_, _, _, _, _, _, _))
+        .WillOnce(Return(reinterpret_cast<HANDLE>(10000)));
+
+    winss::MockPipeName pipe_name("test");
+    MockedLogAggregator aggregator(winss::NotOwned(&multiplexer), pipe_name);
+    aggregator.Add("svc", "svc\\log");
+
+    winss::NiceMockInboundPipeInstance* pipe = aggregator.GetPipe();
+    winss::OpenLogStreamWriter* writer = aggregator.GetWriter("svc");
+    winss::HandleWrapper handle = pipe->GetHandle();
+
+    std::vector<char> head(300, 'x');
+    std::vector<char> tail(300, 'x');
+    tail.push_back('\n');
+
+    EXPECT_CALL(*pipe, GetOverlappedResult())
+        .WillRepeatedly(Return(CONTINUE));
+    EXPECT_CALL(*pipe, SetConnected())
+        .WillOnce(Return(true))
+        .WillRepeatedly(Return(false));
+    EXPECT_CALL(*pipe, FinishRead()).WillRepeatedly(Return(true));
+    EXPECT_CALL(*pipe, SwapBuffer())
+        .WillOnce(Return(head))
+        .WillOnce(Return(tail));
+
+    {
+        InSequence sequence;
+        EXPECT_CALL(*writer, Write(std::string(256, 'x'))).Times(2);
+        EXPECT_CALL(*writer, Write(std::string(88, 'x'))).Times(1);
+    }
+
+    for (int i = 0; i < 3; ++i) {
+        multiplexer.mock_triggered_callbacks.at(i)(multiplexer, handle);
+    }
+
+    EXPECT_EQ(256, aggregator.GetSettings("svc").line_length);
+}
+
+TEST_F(LogAggregatorTest, Remove) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    MockInterface<winss::MockFilesystemInterface> file;
+    NiceMock<winss::MockWaitMultiplexer> multiplexer;
+    SetupFiles(&file, "");
+
+    EXPECT_CALL(*windows, CreateFile(_, _, _, _, _, _, _))
+        .WillOnce(Return(reinterpret_cast<HANDLE>(10000)));
+
+    winss::MockPipeName pipe_name("test");
+    MockedLogAggregator aggregator(winss::NotOwned(&multiplexer), pipe_name);
+    aggregator.Add("svc", "svc\\log");
+
+    winss::NiceMockInboundPipeInstance* pipe = aggregator.GetPipe();
+    EXPECT_CALL(*pipe, GetOverlappedResult()).WillOnce(Return(REMOVE));
+
+    multiplexer.mock_triggered_callbacks.at(0)(multiplexer,
+        pipe->GetHandle());
+    EXPECT_EQ(1, aggregator.StreamCount());
+
+    aggregator.Remove("svc");
+    aggregator.Remove("other");
+    EXPECT_EQ(0, aggregator.StreamCount());
+}
+
+TEST_F(LogAggregatorTest, Buffered) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    MockInterface<winss::MockFilesystemInterface> file;
+    NiceMock<winss::MockWaitMultiplexer> multiplexer;
+    SetupFiles(&file, "b4096 f500\n");
+
+    EXPECT_CALL(*windows, CreateFile(_, _, _, _, _, _, _))
+        .WillOnce(Return(reinterpret_cast<HANDLE>(10000)));
+    EXPECT_CALL(multiplexer, AddTimeoutCallback(500, _, _)).Times(2);
+
+    winss::MockPipeName pipe_name("test");
+    MockedLogAggregator aggregator(winss::NotOwned(&multiplexer), pipe_name);
+    aggregator.Add("svc", "svc\\log");
+    EXPECT_EQ(4096, aggregator.GetSettings("svc").buffer_size);
+    ASSERT_EQ(1, multiplexer.mock_timeout_callbacks.size());
+
+    EXPECT_CALL(*aggregator.GetWriter("svc"), Flush()).Times(1);
+    multiplexer.mock_timeout_callbacks.at(0)(multiplexer);
+    EXPECT_EQ(2, multiplexer.mock_timeout_callbacks.size());
+
+    EXPECT_CALL(multiplexer, RemoveTimeoutCallbackById(2)).Times(1);
+}
+
+TEST_F(LogAggregatorTest, Stop) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    MockInterface<winss::MockFilesystemInterface> file;
+    NiceMock<winss::MockWaitMultiplexer> multiplexer;
+    SetupFiles(&file, "");
+
+    EXPECT_CALL(*windows, CreateFile(_, _, _, _, _, _, _))
+        .WillOnce(Return(reinterpret_cast<HANDLE>(10000)));
+
+    winss::MockPipeName pipe_name("test");
+    MockedLogAggregator aggregator(winss::NotOwned(&multiplexer), pipe_name);
+    aggregator.Add("svc", "svc\\log");
+
+    winss::NiceMockInboundPipeInstance* pipe = aggregator.GetPipe();
+    EXPECT_CALL(*pipe, IsConnected()).WillOnce(Return(true));
+    EXPECT_CALL(*pipe, Closing()).Times(0);
+    EXPECT_CALL(multiplexer, AddTimeoutCallback(
+        MockedLogAggregator::kDrainTimeout, _, _)).Times(1);
+
+    multiplexer.mock_stop_callbacks.at(0)(multiplexer);
+
+    EXPECT_FALSE(aggregator.Add("other", "other\\log").HasHandle());
+    EXPECT_EQ(1, aggregator.PipeCount());
+
+    EXPECT_CALL(multiplexer, RemoveTriggeredCallback(_)).Times(1);
+    multiplexer.mock_timeout_callbacks.at(0)(multiplexer);
+
+    EXPECT_EQ(0, aggregator.PipeCount());
+    EXPECT_EQ(0, aggregator.StreamCount());
+}
+}  // namespace winss
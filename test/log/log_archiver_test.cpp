@@ -0,0 +1,154 @@
+/*
+* Copyright 2016-2017 Morgan Stanley
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <filesystem>
+#include <vector>
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include "winss/winss.hpp"
+#include "winss/not_owning_ptr.hpp"
+#include "winss/log/log_archiver.hpp"
+#include "winss/log/log_settings.hpp"
+#include "../mock_interface.hpp"
+#include "../mock_filesystem_interface.hpp"
+
+namespace fs = std::experimental::filesystem;
+
+using ::testing::_;
+using ::testing::Return;
+
+namespace winss {
+class LogArchiverTest : public testing::Test {
+};
+
+TEST_F(LogArchiverTest, Load) {
+    MockInterface<winss::MockFilesystemInterface> file;
+
+    EXPECT_CALL(*file, GetFiles(_)).WillOnce(Return(std::vector<fs::path>{
+        "@3.u", "@1.u", "current", "@2.u", "@x.u", "log"
+    }));
+    EXPECT_CALL(*file, Remove(fs::path("@1.u"))).WillOnce(Return(true));
+
+    winss::LogSettings settings{};
+    settings.number = 2;
+
+    winss::LogArchiver archiver(settings, "@");
+    archiver.Start();
+    archiver.Stop();
+
+    EXPECT_EQ(2, archiver.Count());
+}
+
+TEST_F(LogArchiverTest, Add) {
+    MockInterface<winss::MockFilesystemInterface> file;
+
+    EXPECT_CALL(*file, GetFiles(_)).WillOnce(Return(std::vector<fs::path>{
+        "@2.u"
+    }));
+    EXPECT_CALL(*file, Remove(_)).Times(0);
+    EXPECT_CALL(*file, Remove(fs::path("@1.u"))).WillOnce(Return(true));
+    EXPECT_CALL(*file, Remove(fs::path("@2.u"))).WillOnce(Return(true));
+
+    winss::LogSettings settings{};
+    settings.number = 2;
+
+    winss::LogArchiver archiver(settings, "@");
+    archiver.Add("@1.u", 1);
+    archiver.Start();
+    archiver.Add("@2.u", 2);
+    archiver.Add("@3.u", 3);
+    archiver.Add("@4.u", 4);
+    archiver.Stop();
+
+    EXPECT_EQ(2, archiver.Count());
+}
+
+TEST_F(LogArchiverTest, TotalSize) {
+    MockInterface<winss::MockFilesystemInterface> file;
+
+    EXPECT_CALL(*file, GetFiles(_)).WillOnce(Return(std::vector<fs::path>{
+        "@1.u", "@2.u", "@3.u"
+    }));
+    EXPECT_CALL(*file, FileSize(_)).WillRepeatedly(Return(100));
+    EXPECT_CALL(*file, Remove(_)).Times(0);
+    EXPECT_CALL(*file, Remove(fs::path("@1.u"))).WillOnce(Return(true));
+    EXPECT_CALL(*file, Remove(fs::path("@2.u"))).WillOnce(Return(true));
+
+    winss::LogSettings settings{};
+    settings.number = 10;
+    settings.total_size = 250;
+
+    winss::LogArchiver archiver(settings, "@");
+    archiver.Start();
+    archiver.Add("@4.u", 4);
+    archiver.Stop();
+
+    EXPECT_EQ(2, archiver.Count());
+    EXPECT_EQ(200, archiver.TotalSize());
+}
+
+TEST_F(LogArchiverTest, SharedWorker) {
+    MockInterface<winss::MockFilesystemInterface> file;
+
+    EXPECT_CALL(*file, GetFiles(fs::path("a")))
+        .WillOnce(Return(std::vector<fs::path>{
+        fs::path("a") / "@1.u", fs::path("a") / "@2.u"
+    }));
+    EXPECT_CALL(*file, GetFiles(fs::path("b")))
+        .WillOnce(Return(std::vector<fs::path>{
+        fs::path("b") / "@1.u"
+    }));
+    EXPECT_CALL(*file, Remove(_)).Times(0);
+    EXPECT_CALL(*file, Remove(fs::path("a") / "@1.u"))
+        .WillOnce(Return(true));
+    EXPECT_CALL(*file, Remove(fs::path("b") / "@1.u"))
+        .WillOnce(Return(true));
+
+    winss::LogSettings settings1{};
+    settings1.number = 1;
+    settings1.log_dir = "a";
+
+    winss::LogSettings settings2{};
+    settings2.number = 1;
+    settings2.log_dir = "b";
+
+    winss::LogArchiveWorker worker;
+    winss::LogArchiver archiver1(settings1, "@", winss::NotOwned(&worker));
+    winss::LogArchiver archiver2(settings2, "@", winss::NotOwned(&worker));
+    archiver1.Start();
+    archiver2.Start();
+    archiver2.Add(fs::path("b") / "@2.u", 2);
+    archiver1.Stop();
+    archiver2.Stop();
+
+    EXPECT_EQ(1, archiver1.Count());
+    EXPECT_EQ(1, archiver2.Count());
+
+    worker.Stop();
+}
+
+TEST_F(LogArchiverTest, StopWithoutStart) {
+    MockInterface<winss::MockFilesystemInterface> file;
+
+    EXPECT_CALL(*file, GetFiles(_)).Times(0);
+
+    winss::LogSettings settings{};
+    winss::LogArchiver archiver(settings, "@");
+    archiver.Stop();
+
+    EXPECT_EQ(0, archiver.Count());
+}
+}  // namespace winss
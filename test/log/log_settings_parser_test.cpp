@@ -46,5 +46,83 @@ TEST_F(LogSettingsParserTest, ParseDefault) {
     EXPECT_EQ(2, settings.number);
     EXPECT_EQ(4096, settings.file_size);
     EXPECT_EQ(fs::path("C:\\"), settings.log_dir);
+    EXPECT_EQ(0, settings.buffer_size);
+    EXPECT_EQ(1000, settings.flush_interval);
+}
+
+TEST_F(LogSettingsParserTest, ParseBuffered) {
+    MockInterface<winss::MockFilesystemInterface> file;
+
+    EXPECT_CALL(*file, Absolute(fs::path(".\test"))).
+        WillRepeatedly(Return(fs::path("C:\\")));
+
+    LogSettingsParser parser;
+    winss::LogSettings settings = parser.Parse({
+        "b65536", "f250", ".\test"
+    });
+
+    EXPECT_EQ(65536, settings.buffer_size);
+    EXPECT_EQ(250, settings.flush_interval);
+
+    settings = parser.Parse({ "bx", "f0", ".\test" });
+
+    EXPECT_EQ(0, settings.buffer_size);
+    EXPECT_EQ(1, settings.flush_interval);
+}
+
+TEST_F(LogSettingsParserTest, ParseRetention) {
+    MockInterface<winss::MockFilesystemInterface> file;
+
+    EXPECT_CALL(*file, Absolute(fs::path(".\test"))).
+        WillRepeatedly(Return(fs::path("C:\\")));
+
+    LogSettingsParser parser;
+    winss::LogSettings settings = parser.Parse({
+        "S10000000000", "r3600", ".\test"
+    });
+
+    EXPECT_EQ(10000000000, settings.total_size);
+    EXPECT_EQ(3600, settings.rotate_interval);
+
+    settings = parser.Parse({ "Sx", "rx", ".\test" });
+
+    EXPECT_EQ(0, settings.total_size);
+    EXPECT_EQ(0, settings.rotate_interval);
+}
+
+TEST_F(LogSettingsParserTest, ParseJson) {
+    MockInterface<winss::MockFilesystemInterface> file;
+
+    EXPECT_CALL(*file, Absolute(_)).WillRepeatedly(Return(fs::path("C:\\")));
+
+    LogSettingsParser parser;
+    winss::LogSettings settings = parser.Parse({ "J", "." });
+
+    EXPECT_TRUE(settings.json);
+    EXPECT_EQ("", settings.service);
+
+    settings = parser.Parse({ "Jweb", "." });
+
+    EXPECT_TRUE(settings.json);
+    EXPECT_EQ("web", settings.service);
+}
+
+TEST_F(LogSettingsParserTest, ParseLineLength) {
+    MockInterface<winss::MockFilesystemInterface> file;
+
+    EXPECT_CALL(*file, Absolute(_)).WillRepeatedly(Return(fs::path("C:\\")));
+
+    LogSettingsParser parser;
+    winss::LogSettings settings = parser.Parse({ "l8192", "." });
+
+    EXPECT_EQ(8192, settings.line_length);
+
+    settings = parser.Parse({ "l10", "." });
+
+    EXPECT_EQ(256, settings.line_length);
+
+    settings = parser.Parse({ "lx", "." });
+
+    EXPECT_EQ(0, settings.line_length);
 }
 }  // namespace winss
@@ -0,0 +1,268 @@
+/*
+* Copyright 2016-2017 Morgan Stanley
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include "winss/winss.hpp"
+#include "winss/event_wrapper.hpp"
+#include "winss/log/log_stream_wrapper.hpp"
+#include "../mock_interface.hpp"
+#include "../mock_windows_interface.hpp"
+
+namespace fs = std::experimental::filesystem;
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::Return;
+
+namespace winss {
+class LogStreamReaderTest : public testing::Test {
+ protected:
+    HANDLE input = reinterpret_cast<HANDLE>(10000);
+    std::vector<std::string> blocks;
+    size_t reads = 0;
+
+    /**
+     * Routes reads of STDIN to the blocks in order.
+     */
+    void SetupInput(MockInterface<winss::MockWindowsInterface>* windows) {
+        EXPECT_CALL(**windows, GetStdHandle(STD_INPUT_HANDLE))
+            .WillOnce(Return(input));
+        EXPECT_CALL(**windows, ReadFile(input, _, _, _, nullptr))
+            .WillRepeatedly(Invoke([this](HANDLE, LPVOID buffer,
+                DWORD to_read, LPDWORD read, LPOVERLAPPED) {
+            if (reads == blocks.size()) {
+                return false;
+            }
+
+            std::string& block = blocks.at(reads);
+            size_t length = std::min<size_t>(to_read, block.length());
+            std::memcpy(buffer, block.data(), length);
+            *read = static_cast<DWORD>(length);
+
+            block.erase(0, length);
+            if (block.empty()) {
+                reads++;
+            }
+
+            return true;
+        }));
+    }
+
+    static std::string ToString(const winss::LogLine& line) {
+        return std::string(line.data, line.length);
+    }
+};
+
+TEST_F(LogStreamReaderTest, GetLine) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    blocks = { "line1\nli", "ne2\r\n\nline", "3" };
+    SetupInput(&windows);
+
+    winss::LogStreamReader reader;
+
+    EXPECT_EQ("line1", ToString(reader.GetLine()));
+    EXPECT_EQ("line2", ToString(reader.GetLine()));
+    EXPECT_EQ("", ToString(reader.GetLine()));
+    EXPECT_FALSE(reader.IsEOF());
+    EXPECT_EQ("line3", ToString(reader.GetLine()));
+    EXPECT_TRUE(reader.IsEOF());
+    EXPECT_EQ(nullptr, reader.GetLine().data);
+}
+
+TEST_F(LogStreamReaderTest, GetLineEmpty) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    SetupInput(&windows);
+
+    winss::LogStreamReader reader;
+
+    winss::LogLine line = reader.GetLine();
+    EXPECT_EQ(nullptr, line.data);
+    EXPECT_EQ(0, line.length);
+    EXPECT_TRUE(reader.IsEOF());
+}
+
+TEST_F(LogStreamReaderTest, GetLineLongerThanBlock) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    std::string head(winss::LogStreamReader::kBlockSize - 2, 'x');
+    std::string tail(winss::LogStreamReader::kBlockSize, 'y');
+    blocks = { "a\n" + head, tail + "\nb\n" };
+    SetupInput(&windows);
+
+    winss::LogStreamReader reader;
+
+    EXPECT_EQ("a", ToString(reader.GetLine()));
+    EXPECT_EQ(head + tail, ToString(reader.GetLine()));
+    EXPECT_EQ("b", ToString(reader.GetLine()));
+    EXPECT_FALSE(reader.IsEOF());
+}
+
+TEST_F(LogStreamReaderTest, GetLineMaxLength) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    blocks = { "abcdefghij\nwxyz", "\r\n123", "4" };
+    SetupInput(&windows);
+
+    winss::LogStreamReader reader(4);
+
+    winss::LogLine line = reader.GetLine();
+    EXPECT_EQ("abcd", ToString(line));
+    EXPECT_TRUE(line.partial);
+    line = reader.GetLine();
+    EXPECT_EQ("efgh", ToString(line));
+    EXPECT_TRUE(line.partial);
+    line = reader.GetLine();
+    EXPECT_EQ("ij", ToString(line));
+    EXPECT_FALSE(line.partial);
+    line = reader.GetLine();
+    EXPECT_EQ("wxyz", ToString(line));
+    EXPECT_FALSE(line.partial);
+    line = reader.GetLine();
+    EXPECT_EQ("1234", ToString(line));
+    EXPECT_FALSE(line.partial);
+    EXPECT_TRUE(reader.IsEOF());
+}
+
+class LogStreamWriterTest : public testing::Test {
+ protected:
+    fs::path log_path;
+
+    void SetUp() override {
+        log_path = fs::temp_directory_path() / "winss_log_stream_test";
+        fs::remove(log_path);
+        std::ofstream create(log_path);
+    }
+
+    void TearDown() override {
+        fs::remove(log_path);
+    }
+
+    std::string ReadLog() const {
+        std::ifstream file(log_path);
+        std::stringstream contents;
+        contents << file.rdbuf();
+        return contents.str();
+    }
+};
+
+TEST_F(LogStreamWriterTest, Unbuffered) {
+    winss::LogStreamWriter writer;
+
+    ASSERT_TRUE(writer.Open(log_path));
+    writer.Write("line");
+    writer.WriteLine();
+
+    EXPECT_EQ("line\n", ReadLog());
+}
+
+TEST_F(LogStreamWriterTest, BufferedThreshold) {
+    winss::EventWrapper close_event;
+    winss::LogStreamWriter writer(12, INFINITE, close_event);
+
+    ASSERT_TRUE(writer.Open(log_path));
+    writer.Write("line1");
+    writer.WriteLine();
+
+    EXPECT_EQ("", ReadLog());
+    EXPECT_EQ(6, writer.GetPos());
+
+    writer.Write("line2");
+    writer.WriteLine();
+
+    EXPECT_EQ("line1\nline2\n", ReadLog());
+
+    writer.Write("line3");
+    writer.WriteLine();
+    writer.Flush();
+
+    EXPECT_EQ("line1\nline2\nline3\n", ReadLog());
+}
+
+TEST_F(LogStreamWriterTest, BufferedWithoutInterval) {
+    winss::LogStreamWriter writer(1024);
+
+    ASSERT_TRUE(writer.Open(log_path));
+    writer.Write("line");
+    writer.WriteLine();
+
+    EXPECT_EQ("", ReadLog());
+
+    writer.Flush();
+
+    EXPECT_EQ("line\n", ReadLog());
+}
+
+TEST_F(LogStreamWriterTest, BufferedClose) {
+    winss::EventWrapper close_event;
+    winss::LogStreamWriter writer(1024, INFINITE, close_event);
+
+    ASSERT_TRUE(writer.Open(log_path));
+    writer.Write("line");
+    writer.WriteLine();
+    writer.Close();
+
+    EXPECT_EQ("line\n", ReadLog());
+}
+
+TEST_F(LogStreamWriterTest, BufferedInterval) {
+    winss::EventWrapper close_event;
+    winss::LogStreamWriter writer(1024, 10, close_event);
+
+    ASSERT_TRUE(writer.Open(log_path));
+    writer.Write("line");
+    writer.WriteLine();
+
+    std::string contents;
+    for (int i = 0; i < 100 && contents.empty(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        contents = ReadLog();
+    }
+
+    EXPECT_EQ("line\n", contents);
+}
+
+TEST_F(LogStreamWriterTest, BufferedCloseSignal) {
+    winss::EventWrapper close_event;
+    winss::LogStreamWriter writer(1024, INFINITE, close_event);
+
+    ASSERT_TRUE(writer.Open(log_path));
+    writer.Write("line1");
+    writer.WriteLine();
+
+    close_event.Set();
+
+    std::string contents;
+    for (int i = 0; i < 100 && contents.empty(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        contents = ReadLog();
+    }
+
+    EXPECT_EQ("line1\n", contents);
+
+    writer.Write("line2");
+    writer.WriteLine();
+
+    EXPECT_EQ("line1\nline2\n", ReadLog());
+}
+}  // namespace winss
@@ -14,7 +14,9 @@
 * limitations under the License.
 */
 
+#include <chrono>
 #include <filesystem>
+#include <string>
 #include <vector>
 #include "gtest/gtest.h"
 #include "gmock/gmock.h"
@@ -29,10 +31,17 @@
 namespace fs = std::experimental::filesystem;
 
 using ::testing::_;
+using ::testing::HasSubstr;
+using ::testing::InSequence;
+using ::testing::Invoke;
 using ::testing::NiceMock;
 using ::testing::Return;
+using ::testing::SizeIs;
+using ::testing::StartsWith;
 
 namespace winss {
+static const char kLine[] = "This is a test";
+
 class LogTest : public testing::Test {
 };
 class MockedLog : public LogTmpl<winss::MockPathMutex> {
@@ -46,6 +55,10 @@ class MockedLog : public LogTmpl<winss::MockPathMutex> {
     winss::MockPathMutex* GetMutex() {
         return &mutex;
     }
+
+    void Age(std::chrono::seconds by) {
+        opened -= by;
+    }
 };
 
 TEST_F(LogTest, DirectoryDoesNotExist) {
@@ -106,7 +119,7 @@ TEST_F(LogTest, Simple) {
         .WillOnce(Return(false))
         .WillOnce(Return(true));
     EXPECT_CALL(reader, GetLine())
-        .WillOnce(Return("This is a test"));
+        .WillOnce(Return(winss::LogLine{ kLine, sizeof(kLine) - 1 }));
 
     EXPECT_CALL(writer, Open(_)).WillOnce(Return(true));
     EXPECT_CALL(writer, GetPos()).WillOnce(Return(0));
@@ -121,6 +134,62 @@ TEST_F(LogTest, Simple) {
     EXPECT_EQ(0, log.Start());
 }
 
+TEST_F(LogTest, Timestamp) {
+    MockInterface<winss::MockFilesystemInterface> file;
+    NiceMock<winss::MockLogStreamReader> reader;
+    NiceMock<winss::MockLogStreamWriter> writer;
+
+    EXPECT_CALL(*file, DirectoryExists(_)).WillOnce(Return(true));
+
+    EXPECT_CALL(reader, IsEOF())
+        .WillOnce(Return(false))
+        .WillOnce(Return(true));
+    EXPECT_CALL(reader, GetLine())
+        .WillOnce(Return(winss::LogLine{ kLine, sizeof(kLine) - 1 }));
+
+    EXPECT_CALL(writer, Open(_)).WillOnce(Return(true));
+    EXPECT_CALL(writer, GetPos()).WillOnce(Return(0));
+    EXPECT_CALL(writer, Write(SizeIs(winss::LogTimestamp::kLength + 1)))
+        .Times(1);
+    EXPECT_CALL(writer, Write("This is a test")).Times(1);
+
+    winss::LogSettings settings{};
+    settings.timestamp = true;
+
+    winss::MockedLog log(winss::NotOwned(&reader), winss::NotOwned(&writer),
+        settings);
+    EXPECT_CALL(*log.GetMutex(), Lock()).WillOnce(Return(true));
+
+    EXPECT_EQ(0, log.Start());
+}
+
+TEST_F(LogTest, EndOfInput) {
+    MockInterface<winss::MockFilesystemInterface> file;
+    NiceMock<winss::MockLogStreamReader> reader;
+    NiceMock<winss::MockLogStreamWriter> writer;
+
+    EXPECT_CALL(*file, DirectoryExists(_)).WillOnce(Return(true));
+
+    EXPECT_CALL(reader, IsEOF())
+        .WillOnce(Return(false))
+        .WillOnce(Return(true));
+    EXPECT_CALL(reader, GetLine())
+        .WillOnce(Return(winss::LogLine{ nullptr, 0 }));
+
+    EXPECT_CALL(writer, Open(_)).WillOnce(Return(true));
+    EXPECT_CALL(writer, GetPos()).Times(0);
+    EXPECT_CALL(writer, Write(_)).Times(0);
+
+    winss::LogSettings settings{};
+    settings.timestamp = true;
+
+    winss::MockedLog log(winss::NotOwned(&reader), winss::NotOwned(&writer),
+        settings);
+    EXPECT_CALL(*log.GetMutex(), Lock()).WillOnce(Return(true));
+
+    EXPECT_EQ(0, log.Start());
+}
+
 TEST_F(LogTest, Rotate) {
     MockInterface<winss::MockFilesystemInterface> file;
     NiceMock<winss::MockLogStreamReader> reader;
@@ -130,14 +199,18 @@ TEST_F(LogTest, Rotate) {
     EXPECT_CALL(*file, GetFiles(_)).WillOnce(Return(std::vector<fs::path>{
         "@14768836971725029.u", "@14768836971725028.u", "log", "current"
     }));
+    EXPECT_CALL(*file, Rename(_, _))
+        .WillOnce(Return(true));
     EXPECT_CALL(*file, Remove(fs::path("@14768836971725028.u")))
         .WillOnce(Return(true));
+    EXPECT_CALL(*file, Remove(fs::path("@14768836971725029.u")))
+        .WillOnce(Return(true));
 
     EXPECT_CALL(reader, IsEOF())
         .WillOnce(Return(false))
         .WillOnce(Return(true));
     EXPECT_CALL(reader, GetLine())
-        .WillOnce(Return("This is a test"));
+        .WillOnce(Return(winss::LogLine{ kLine, sizeof(kLine) - 1 }));
 
     EXPECT_CALL(writer, Open(_))
         .WillOnce(Return(true))
@@ -155,4 +228,222 @@ TEST_F(LogTest, Rotate) {
 
     EXPECT_EQ(0, log.Start());
 }
+
+TEST_F(LogTest, RotateInterval) {
+    MockInterface<winss::MockFilesystemInterface> file;
+    NiceMock<winss::MockLogStreamReader> reader;
+    NiceMock<winss::MockLogStreamWriter> writer;
+
+    winss::LogSettings settings{};
+    settings.file_size = 1000000;
+    settings.number = 10;
+    settings.rotate_interval = 60;
+
+    winss::MockedLog log(winss::NotOwned(&reader), winss::NotOwned(&writer),
+        settings);
+    EXPECT_CALL(*log.GetMutex(), Lock()).WillOnce(Return(true));
+
+    EXPECT_CALL(*file, DirectoryExists(_)).WillOnce(Return(true));
+    EXPECT_CALL(*file, GetFiles(_))
+        .WillOnce(Return(std::vector<fs::path>{}));
+    EXPECT_CALL(*file, Rename(_, _)).WillOnce(Return(true));
+    EXPECT_CALL(*file, Remove(_)).Times(0);
+
+    EXPECT_CALL(reader, IsEOF())
+        .WillOnce(Return(false))
+        .WillOnce(Return(false))
+        .WillOnce(Return(true));
+    EXPECT_CALL(reader, GetLine())
+        .WillOnce(Return(winss::LogLine{ kLine, sizeof(kLine) - 1 }))
+        .WillOnce(Invoke([&log]() {
+            log.Age(std::chrono::seconds(60));
+            return winss::LogLine{ kLine, sizeof(kLine) - 1 };
+        }));
+
+    EXPECT_CALL(writer, Open(_))
+        .WillOnce(Return(true))
+        .WillOnce(Return(true));
+    EXPECT_CALL(writer, GetPos())
+        .WillOnce(Return(0))
+        .WillRepeatedly(Return(15));
+    EXPECT_CALL(writer, Write("This is a test")).Times(2);
+
+    EXPECT_EQ(0, log.Start());
+}
+
+TEST_F(LogTest, Json) {
+    MockInterface<winss::MockFilesystemInterface> file;
+    NiceMock<winss::MockLogStreamReader> reader;
+    NiceMock<winss::MockLogStreamWriter> writer;
+
+    static const char kEscaped[] = "Say \"hi\"\tC:\\";
+
+    EXPECT_CALL(*file, DirectoryExists(_)).WillOnce(Return(true));
+
+    EXPECT_CALL(reader, IsEOF())
+        .WillOnce(Return(false))
+        .WillOnce(Return(false))
+        .WillOnce(Return(true));
+    EXPECT_CALL(reader, GetLine())
+        .WillOnce(Return(winss::LogLine{ kLine, sizeof(kLine) - 1 }))
+        .WillOnce(Return(winss::LogLine{ kEscaped, sizeof(kEscaped) - 1 }));
+
+    std::vector<std::string> records(1);
+    EXPECT_CALL(writer, Open(_)).WillOnce(Return(true));
+    EXPECT_CALL(writer, GetPos()).WillRepeatedly(Invoke([&records]() {
+        records.emplace_back();
+        return 0;
+    }));
+    EXPECT_CALL(writer, Write(_)).WillRepeatedly(Invoke(
+        [&records](const std::string& data) {
+        records.back() += data;
+    }));
+
+    winss::LogSettings settings{};
+    settings.json = true;
+    settings.timestamp = true;
+    settings.service = "test\"svc";
+
+    winss::MockedLog log(winss::NotOwned(&reader), winss::NotOwned(&writer),
+        settings);
+    EXPECT_CALL(*log.GetMutex(), Lock()).WillOnce(Return(true));
+
+    EXPECT_EQ(0, log.Start());
+
+    ASSERT_EQ(3, records.size());
+    EXPECT_THAT(records[1], StartsWith(
+        "{\"service\":\"test\\\"svc\",\"seq\":0,\"ts\":"));
+    EXPECT_THAT(records[1], HasSubstr(
+        ",\"len\":14,\"line\":\"This is a test\"}"));
+    EXPECT_THAT(records[2], HasSubstr(",\"seq\":1,"));
+    EXPECT_THAT(records[2], HasSubstr(
+        ",\"len\":12,\"line\":\"Say \\\"hi\\\"\\u0009C:\\\\\"}"));
+}
+
+TEST_F(LogTest, JsonInvalidUtf8) {
+    MockInterface<winss::MockFilesystemInterface> file;
+    NiceMock<winss::MockLogStreamReader> reader;
+    NiceMock<winss::MockLogStreamWriter> writer;
+
+    // Latin-1, valid UTF-8 and a truncated UTF-8 sequence.
+    static const char kMixed[] = "caf\xe9 caf\xc3\xa9 \xe2\x82";
+
+    EXPECT_CALL(*file, DirectoryExists(_)).WillOnce(Return(true));
+
+    EXPECT_CALL(reader, IsEOF())
+        .WillOnce(Return(false))
+        .WillOnce(Return(true));
+    EXPECT_CALL(reader, GetLine())
+        .WillOnce(Return(winss::LogLine{ kMixed, sizeof(kMixed) - 1 }));
+
+    std::vector<std::string> records(1);
+    EXPECT_CALL(writer, Open(_)).WillOnce(Return(true));
+    EXPECT_CALL(writer, GetPos()).WillRepeatedly(Invoke([&records]() {
+        records.emplace_back();
+        return 0;
+    }));
+    EXPECT_CALL(writer, Write(_)).WillRepeatedly(Invoke(
+        [&records](const std::string& data) {
+        records.back() += data;
+    }));
+
+    winss::LogSettings settings{};
+    settings.json = true;
+    settings.service = "test";
+
+    winss::MockedLog log(winss::NotOwned(&reader), winss::NotOwned(&writer),
+        settings);
+    EXPECT_CALL(*log.GetMutex(), Lock()).WillOnce(Return(true));
+
+    EXPECT_EQ(0, log.Start());
+
+    ASSERT_EQ(2, records.size());
+    EXPECT_THAT(records[1], HasSubstr(
+        ",\"len\":13,\"line\":\"caf\\u00e9 caf\xc3\xa9 \\u00e2\\u0082\"}"));
+}
+
+TEST_F(LogTest, JsonInvalidUtf8Service) {
+    MockInterface<winss::MockFilesystemInterface> file;
+    NiceMock<winss::MockLogStreamReader> reader;
+    NiceMock<winss::MockLogStreamWriter> writer;
+
+    EXPECT_CALL(*file, DirectoryExists(_)).WillOnce(Return(true));
+
+    EXPECT_CALL(reader, IsEOF())
+        .WillOnce(Return(false))
+        .WillOnce(Return(true));
+    EXPECT_CALL(reader, GetLine())
+        .WillOnce(Return(winss::LogLine{ "line", 4 }));
+
+    std::vector<std::string> records(1);
+    EXPECT_CALL(writer, Open(_)).WillOnce(Return(true));
+    EXPECT_CALL(writer, GetPos()).WillRepeatedly(Invoke([&records]() {
+        records.emplace_back();
+        return 0;
+    }));
+    EXPECT_CALL(writer, Write(_)).WillRepeatedly(Invoke(
+        [&records](const std::string& data) {
+        records.back() += data;
+    }));
+
+    // A directory name in the Latin-1 code page.
+    winss::LogSettings settings{};
+    settings.json = true;
+    settings.service = "caf\xe9 \"svc\"";
+
+    winss::MockedLog log(winss::NotOwned(&reader), winss::NotOwned(&writer),
+        settings);
+    EXPECT_CALL(*log.GetMutex(), Lock()).WillOnce(Return(true));
+
+    EXPECT_EQ(0, log.Start());
+
+    ASSERT_EQ(2, records.size());
+    EXPECT_THAT(records[1], StartsWith(
+        "{\"service\":\"caf\\u00e9 \\\"svc\\\"\",\"seq\":0,"));
+}
+
+TEST_F(LogTest, LineChunks) {
+    MockInterface<winss::MockFilesystemInterface> file;
+    NiceMock<winss::MockLogStreamReader> reader;
+    NiceMock<winss::MockLogStreamWriter> writer;
+
+    EXPECT_CALL(*file, DirectoryExists(_)).WillOnce(Return(true));
+    EXPECT_CALL(*file, GetFiles(_))
+        .WillOnce(Return(std::vector<fs::path>{}));
+    EXPECT_CALL(*file, Rename(_, _)).WillOnce(Return(true));
+
+    EXPECT_CALL(reader, IsEOF())
+        .WillOnce(Return(false))
+        .WillOnce(Return(false))
+        .WillOnce(Return(true));
+    EXPECT_CALL(reader, GetLine())
+        .WillOnce(Return(winss::LogLine{ kLine, 5, true }))
+        .WillOnce(Return(winss::LogLine{ kLine + 5, sizeof(kLine) - 6 }));
+
+    EXPECT_CALL(writer, Open(_))
+        .WillOnce(Return(true))
+        .WillOnce(Return(true));
+    EXPECT_CALL(writer, GetPos())
+        .WillOnce(Return(0))
+        .WillOnce(Return(25));
+    {
+        InSequence sequence;
+        EXPECT_CALL(writer, Write(SizeIs(winss::LogTimestamp::kLength + 1)))
+            .Times(1);
+        EXPECT_CALL(writer, Write("This ")).Times(1);
+        EXPECT_CALL(writer, Close()).Times(1);
+        EXPECT_CALL(writer, Write("is a test")).Times(1);
+        EXPECT_CALL(writer, Close()).Times(1);
+    }
+
+    winss::LogSettings settings{};
+    settings.file_size = 20;
+    settings.timestamp = true;
+
+    winss::MockedLog log(winss::NotOwned(&reader), winss::NotOwned(&writer),
+        settings);
+    EXPECT_CALL(*log.GetMutex(), Lock()).WillOnce(Return(true));
+
+    EXPECT_EQ(0, log.Start());
+}
 }  // namespace winss
@@ -0,0 +1,69 @@
+/*
+* Copyright 2016-2017 Morgan Stanley
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <chrono>
+#include <string>
+#include "gtest/gtest.h"
+#include "winss/winss.hpp"
+#include "winss/utils.hpp"
+#include "winss/log/log_timestamp.hpp"
+
+namespace winss {
+class LogTimestampTest : public testing::Test {
+ protected:
+    winss::LogTimestamp timestamp;
+
+    std::string Format(const std::chrono::system_clock::time_point& time) {
+        char buffer[winss::LogTimestamp::kLength];
+        size_t length = timestamp.Format(time, buffer);
+        return std::string(buffer, length);
+    }
+};
+
+TEST_F(LogTimestampTest, Format) {
+    std::chrono::system_clock::time_point time(
+        std::chrono::milliseconds(1476883697172));
+
+    EXPECT_EQ("2016-10-19 13:28:17.172", Format(time));
+    EXPECT_EQ(winss::Utils::ConvertToISOString(time), Format(time));
+}
+
+TEST_F(LogTimestampTest, FormatCached) {
+    std::chrono::system_clock::time_point time(
+        std::chrono::milliseconds(1476883697000));
+
+    for (int i = 0; i < 2500; i += 7) {
+        auto next = time + std::chrono::milliseconds(i);
+        EXPECT_EQ(winss::Utils::ConvertToISOString(next), Format(next));
+    }
+}
+
+TEST_F(LogTimestampTest, FormatBackwards) {
+    std::chrono::system_clock::time_point time(
+        std::chrono::milliseconds(1483228799999));
+
+    EXPECT_EQ("2016-12-31 23:59:59.999", Format(time));
+    EXPECT_EQ("2017-01-01 00:00:00.000",
+        Format(time + std::chrono::milliseconds(1)));
+    EXPECT_EQ("2016-12-31 23:59:59.998",
+        Format(time - std::chrono::milliseconds(1)));
+}
+
+TEST_F(LogTimestampTest, Now) {
+    auto now = std::chrono::system_clock::now();
+    EXPECT_EQ(winss::Utils::ConvertToISOString(now), Format(now));
+}
+}  // namespace winss
@@ -0,0 +1,44 @@
+/*
+* Copyright 2016-2017 Morgan Stanley
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef TEST_LOG_MOCK_LOG_AGGREGATOR_HPP_
+#define TEST_LOG_MOCK_LOG_AGGREGATOR_HPP_
+
+#include <filesystem>
+#include <string>
+#include "gmock/gmock.h"
+#include "winss/handle_wrapper.hpp"
+#include "winss/log/log_aggregator.hpp"
+
+namespace fs = std::experimental::filesystem;
+
+namespace winss {
+class MockLogAggregator : public winss::LogAggregatorInterface {
+ public:
+    MockLogAggregator() {}
+    MockLogAggregator(const MockLogAggregator&) = delete;
+    MockLogAggregator(MockLogAggregator&&) = delete;
+
+    MOCK_METHOD2(Add, winss::HandleWrapper(const std::string& name,
+        const fs::path& log_service_dir));
+    MOCK_METHOD1(Remove, void(const std::string& name));
+
+    MockLogAggregator& operator=(const MockLogAggregator&) = delete;
+    MockLogAggregator& operator=(MockLogAggregator&&) = delete;
+};
+}  // namespace winss
+
+#endif  // TEST_LOG_MOCK_LOG_AGGREGATOR_HPP_
@@ -32,7 +32,7 @@ class MockLogStreamReader : public winss::LogStreamReader {
     MockLogStreamReader(MockLogStreamReader&&) = delete;
 
     MOCK_CONST_METHOD0(IsEOF, bool());
-    MOCK_METHOD0(GetLine, std::string());
+    MOCK_METHOD0(GetLine, winss::LogLine());
 
     MockLogStreamReader& operator=(const MockLogStreamReader&) = delete;
     MockLogStreamReader& operator=(MockLogStreamReader&&) = delete;
@@ -40,12 +40,19 @@ class MockLogStreamReader : public winss::LogStreamReader {
 class MockLogStreamWriter : public winss::LogStreamWriter {
  public:
     MockLogStreamWriter() {}
+    explicit MockLogStreamWriter(size_t buffer_size) :
+        winss::LogStreamWriter(buffer_size) {}
     MockLogStreamWriter(const MockLogStreamWriter&) = delete;
     MockLogStreamWriter(MockLogStreamWriter&&) = delete;
 
     MOCK_METHOD1(Open, bool(fs::path log_path));
     MOCK_METHOD1(Write, void(const std::string& line));
+
+    void Write(const char* data, size_t length) override {
+        Write(std::string(data, length));
+    }
     MOCK_METHOD0(GetPos, std::streamoff());
+    MOCK_METHOD0(Flush, void());
     MOCK_METHOD0(Close, void());
 
     MockLogStreamWriter& operator=(const MockLogStreamWriter&) = delete;
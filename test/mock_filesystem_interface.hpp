@@ -43,6 +43,9 @@ class MockFilesystemInterface : public winss::FilesystemInterface {
     MOCK_CONST_METHOD2(Rename, bool(const fs::path& fro1, const fs::path& to));
     MOCK_CONST_METHOD1(Remove, bool(const fs::path& path));
     MOCK_CONST_METHOD1(FileExists, bool(const fs::path& path));
+    MOCK_CONST_METHOD1(FileSize, unsigned __int64(const fs::path& path));
+    MOCK_CONST_METHOD1(LastWriteTime,
+        unsigned __int64(const fs::path& path));
     MOCK_CONST_METHOD1(Absolute, fs::path(const fs::path& path));
     MOCK_CONST_METHOD1(CanonicalUncPath, fs::path(const fs::path& path));
     MOCK_CONST_METHOD1(GetDirectories, std::vector<fs::path>(
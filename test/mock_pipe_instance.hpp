@@ -27,6 +27,7 @@
 using ::testing::_;
 using ::testing::NiceMock;
 using ::testing::Return;
+using ::testing::ReturnRef;
 
 namespace winss {
 class MockPipeInstance : public virtual winss::PipeInstance {
@@ -61,6 +62,7 @@ class MockPipeInstance : public virtual winss::PipeInstance {
 
     MOCK_METHOD1(CreateNamedPipe, bool(const winss::PipeName& pipe_name));
     MOCK_METHOD1(CreateFile, bool(const winss::PipeName& pipe_name));
+    MOCK_METHOD0(ConnectNamedPipe, bool());
 
     MOCK_METHOD0(Closing, void());
     MOCK_METHOD0(DisconnectNamedPipe, void());
@@ -108,6 +110,7 @@ class MockOutboundPipeInstance : public virtual winss::OutboundPipeInstance {
  protected:
     HANDLE handle = reinterpret_cast<HANDLE>(
         static_cast<intptr_t>(std::rand()));
+    winss::BacklogCounters mock_counters{};
 
  public:
     MockOutboundPipeInstance() :
@@ -116,6 +119,8 @@ class MockOutboundPipeInstance : public virtual winss::OutboundPipeInstance {
             winss::HandleWrapper(handle, false)));
         ON_CALL(*this, CreateNamedPipe(_)).WillByDefault(Return(true));
         ON_CALL(*this, CreateFile(_)).WillByDefault(Return(true));
+        ON_CALL(*this, GetBacklogCounters()).WillByDefault(ReturnRef(
+            mock_counters));
     }
 
     MockOutboundPipeInstance(const MockOutboundPipeInstance&) = delete;
@@ -125,6 +130,8 @@ class MockOutboundPipeInstance : public virtual winss::OutboundPipeInstance {
         handle = other.handle;
         ON_CALL(*this, GetHandle()).WillByDefault(Return(
             winss::HandleWrapper(handle, false)));
+        ON_CALL(*this, GetBacklogCounters()).WillByDefault(ReturnRef(
+            mock_counters));
     }
 
     MOCK_CONST_METHOD0(IsPendingIO, bool());
@@ -137,12 +144,18 @@ class MockOutboundPipeInstance : public virtual winss::OutboundPipeInstance {
 
     MOCK_METHOD1(CreateNamedPipe, bool(const winss::PipeName& pipe_name));
     MOCK_METHOD1(CreateFile, bool(const winss::PipeName& pipe_name));
+    MOCK_METHOD0(ConnectNamedPipe, bool());
 
     MOCK_METHOD0(Closing, void());
     MOCK_METHOD0(DisconnectNamedPipe, void());
     MOCK_METHOD0(Close, bool());
 
+    MOCK_METHOD2(SetBacklog, void(size_t limit,
+        winss::BacklogPolicy policy));
+    MOCK_CONST_METHOD0(GetBacklogCounters, const winss::BacklogCounters&());
+
     MOCK_METHOD1(Queue, bool(const std::vector<char>& data));
+    MOCK_METHOD1(QueueMessage, bool(const winss::PipeMessage& message));
 
     MOCK_CONST_METHOD0(HasMessages, bool());
     MOCK_CONST_METHOD0(IsWriting, bool());
@@ -159,6 +172,8 @@ class MockOutboundPipeInstance : public virtual winss::OutboundPipeInstance {
         handle = instance.handle;
         ON_CALL(*this, GetHandle()).WillByDefault(Return(
             winss::HandleWrapper(handle, false)));
+        ON_CALL(*this, GetBacklogCounters()).WillByDefault(ReturnRef(
+            mock_counters));
         return *this;
     }
 };
@@ -171,6 +186,8 @@ class NiceMockOutboundPipeInstance :
             winss::HandleWrapper(handle, false)));
         ON_CALL(*this, CreateNamedPipe(_)).WillByDefault(Return(true));
         ON_CALL(*this, CreateFile(_)).WillByDefault(Return(true));
+        ON_CALL(*this, GetBacklogCounters()).WillByDefault(ReturnRef(
+            mock_counters));
     }
 
     NiceMockOutboundPipeInstance(const NiceMockOutboundPipeInstance&) = delete;
@@ -180,6 +197,8 @@ class NiceMockOutboundPipeInstance :
         handle = other.handle;
         ON_CALL(*this, GetHandle()).WillByDefault(Return(
             winss::HandleWrapper(handle, false)));
+        ON_CALL(*this, GetBacklogCounters()).WillByDefault(ReturnRef(
+            mock_counters));
     }
 
     NiceMockOutboundPipeInstance& operator=(
@@ -191,6 +210,8 @@ class NiceMockOutboundPipeInstance :
         handle = instance.handle;
         ON_CALL(*this, GetHandle()).WillByDefault(Return(
             winss::HandleWrapper(handle, false)));
+        ON_CALL(*this, GetBacklogCounters()).WillByDefault(ReturnRef(
+            mock_counters));
         return *this;
     }
 };
@@ -227,6 +248,7 @@ class MockInboundPipeInstance : public virtual winss::InboundPipeInstance {
 
     MOCK_METHOD1(CreateNamedPipe, bool(const winss::PipeName& pipe_name));
     MOCK_METHOD1(CreateFile, bool(const winss::PipeName& pipe_name));
+    MOCK_METHOD0(ConnectNamedPipe, bool());
 
     MOCK_METHOD0(Closing, void());
     MOCK_METHOD0(DisconnectNamedPipe, void());
@@ -36,6 +36,7 @@ class MockOutboundPipeServer : public winss::OutboundPipeServer {
     MOCK_CONST_METHOD0(IsStopping, bool());
     MOCK_CONST_METHOD0(InstanceCount, size_t());
     MOCK_METHOD1(Send, bool(const std::vector<char>& data));
+    MOCK_CONST_METHOD0(GetBacklogCounters, winss::BacklogCounters());
 
     MockOutboundPipeServer& operator=(const MockOutboundPipeServer&) = delete;
     MockOutboundPipeServer& operator=(MockOutboundPipeServer&&) = delete;
@@ -51,6 +51,8 @@ class MockWaitMultiplexer : public winss::WaitMultiplexer {
         auto add_timeout = [this](DWORD timeout, winss::Callback callback,
             std::string group) {
             this->mock_timeout_callbacks.push_back(callback);
+            return static_cast<winss::TimeoutId>(
+                this->mock_timeout_callbacks.size());
         };
         ON_CALL(*this, AddTimeoutCallback(_, _, _))
             .WillByDefault(Invoke(add_timeout));
@@ -64,13 +66,14 @@ class MockWaitMultiplexer : public winss::WaitMultiplexer {
     MOCK_METHOD1(AddInitCallback, void(winss::Callback callback));
     MOCK_METHOD2(AddTriggeredCallback, void(const winss::HandleWrapper& handle,
         winss::TriggeredCallback callback));
-    MOCK_METHOD3(AddTimeoutCallback, void(DWORD timeout,
+    MOCK_METHOD3(AddTimeoutCallback, winss::TimeoutId(DWORD timeout,
         winss::Callback callback, std::string group));
     MOCK_METHOD1(AddStopCallback, void(winss::Callback callback));
 
     MOCK_METHOD1(RemoveTriggeredCallback, bool(
         const winss::HandleWrapper& handle));
     MOCK_METHOD1(RemoveTimeoutCallback, bool(std::string group));
+    MOCK_METHOD1(RemoveTimeoutCallbackById, bool(winss::TimeoutId id));
 
     MOCK_CONST_METHOD0(GetTimeout, DWORD());
 
@@ -104,6 +104,10 @@ class MockWindowsInterface : public winss::WindowsInterface {
             bytes, wait);
     }
 
+    bool CancelIoExConcrete(HANDLE handle, LPOVERLAPPED overlapped) const {
+        return winss::WindowsInterface::CancelIoEx(handle, overlapped);
+    }
+
     bool ReadFileConcrete(HANDLE handle, LPVOID buffer, DWORD to_read,
         LPDWORD read, LPOVERLAPPED overlapped) const {
         return winss::WindowsInterface::ReadFile(handle, buffer, to_read,
@@ -116,6 +120,40 @@ class MockWindowsInterface : public winss::WindowsInterface {
             written, overlapped);
     }
 
+    HANDLE CreateIoCompletionPortConcrete(HANDLE file_handle,
+        HANDLE existing_port, ULONG_PTR completion_key,
+        DWORD concurrent_threads) const {
+        return winss::WindowsInterface::CreateIoCompletionPort(file_handle,
+            existing_port, completion_key, concurrent_threads);
+    }
+
+    bool GetQueuedCompletionStatusExConcrete(HANDLE port,
+        LPOVERLAPPED_ENTRY entries, ULONG count, PULONG removed,
+        DWORD timeout, bool alertable) const {
+        return winss::WindowsInterface::GetQueuedCompletionStatusEx(port,
+            entries, count, removed, timeout, alertable);
+    }
+
+    bool PostQueuedCompletionStatusConcrete(HANDLE port, DWORD bytes,
+        ULONG_PTR completion_key, LPOVERLAPPED overlapped) const {
+        return winss::WindowsInterface::PostQueuedCompletionStatus(port,
+            bytes, completion_key, overlapped);
+    }
+
+    HANDLE FindFirstChangeNotificationConcrete(LPCTSTR path_name,
+        bool watch_subtree, DWORD notify_filter) const {
+        return winss::WindowsInterface::FindFirstChangeNotification(
+            path_name, watch_subtree, notify_filter);
+    }
+
+    bool FindNextChangeNotificationConcrete(HANDLE handle) const {
+        return winss::WindowsInterface::FindNextChangeNotification(handle);
+    }
+
+    bool FindCloseChangeNotificationConcrete(HANDLE handle) const {
+        return winss::WindowsInterface::FindCloseChangeNotification(handle);
+    }
+
     DWORD WaitForSingleObjectConcrete(HANDLE handle, DWORD timeout) const {
         return winss::WindowsInterface::WaitForSingleObject(handle, timeout);
     }
@@ -313,12 +351,33 @@ class MockWindowsInterface : public winss::WindowsInterface {
     MOCK_CONST_METHOD4(GetOverlappedResult, bool(HANDLE handle,
         LPOVERLAPPED overlapped, LPDWORD bytes, BOOL wait));
 
+    MOCK_CONST_METHOD2(CancelIoEx, bool(HANDLE handle,
+        LPOVERLAPPED overlapped));
+
     MOCK_CONST_METHOD5(ReadFile, bool(HANDLE handle, LPVOID buffer,
         DWORD to_read, LPDWORD read, LPOVERLAPPED overlapped));
 
     MOCK_CONST_METHOD5(WriteFile, bool(HANDLE handle, LPCVOID buffer,
         DWORD to_write, LPDWORD written, LPOVERLAPPED overlapped));
 
+    MOCK_CONST_METHOD4(CreateIoCompletionPort, HANDLE(HANDLE file_handle,
+        HANDLE existing_port, ULONG_PTR completion_key,
+        DWORD concurrent_threads));
+
+    MOCK_CONST_METHOD6(GetQueuedCompletionStatusEx, bool(HANDLE port,
+        LPOVERLAPPED_ENTRY entries, ULONG count, PULONG removed,
+        DWORD timeout, bool alertable));
+
+    MOCK_CONST_METHOD4(PostQueuedCompletionStatus, bool(HANDLE port,
+        DWORD bytes, ULONG_PTR completion_key, LPOVERLAPPED overlapped));
+
+    MOCK_CONST_METHOD3(FindFirstChangeNotification, HANDLE(
+        LPCTSTR path_name, bool watch_subtree, DWORD notify_filter));
+
+    MOCK_CONST_METHOD1(FindNextChangeNotification, bool(HANDLE handle));
+
+    MOCK_CONST_METHOD1(FindCloseChangeNotification, bool(HANDLE handle));
+
     MOCK_CONST_METHOD2(WaitForSingleObject, DWORD(HANDLE handle,
         DWORD timeout));
 
@@ -450,6 +509,10 @@ class MockWindowsInterface : public winss::WindowsInterface {
             .WillByDefault(Invoke(this,
                 &MockWindowsInterface::GetOverlappedResultConcrete));
 
+        ON_CALL(*this, CancelIoEx(_, _))
+            .WillByDefault(Invoke(this,
+                &MockWindowsInterface::CancelIoExConcrete));
+
         ON_CALL(*this, ReadFile(_, _, _, _, _))
             .WillByDefault(Invoke(this,
                 &MockWindowsInterface::ReadFileConcrete));
@@ -458,6 +521,30 @@ class MockWindowsInterface : public winss::WindowsInterface {
             .WillByDefault(Invoke(this,
                 &MockWindowsInterface::WriteFileConcrete));
 
+        ON_CALL(*this, CreateIoCompletionPort(_, _, _, _))
+            .WillByDefault(Invoke(this,
+                &MockWindowsInterface::CreateIoCompletionPortConcrete));
+
+        ON_CALL(*this, GetQueuedCompletionStatusEx(_, _, _, _, _, _))
+            .WillByDefault(Invoke(this,
+                &MockWindowsInterface::GetQueuedCompletionStatusExConcrete));
+
+        ON_CALL(*this, PostQueuedCompletionStatus(_, _, _, _))
+            .WillByDefault(Invoke(this,
+                &MockWindowsInterface::PostQueuedCompletionStatusConcrete));
+
+        ON_CALL(*this, FindFirstChangeNotification(_, _, _))
+            .WillByDefault(Invoke(this, &MockWindowsInterface
+                ::FindFirstChangeNotificationConcrete));
+
+        ON_CALL(*this, FindNextChangeNotification(_))
+            .WillByDefault(Invoke(this, &MockWindowsInterface
+                ::FindNextChangeNotificationConcrete));
+
+        ON_CALL(*this, FindCloseChangeNotification(_))
+            .WillByDefault(Invoke(this, &MockWindowsInterface
+                ::FindCloseChangeNotificationConcrete));
+
         ON_CALL(*this, WaitForSingleObject(_, _))
             .WillByDefault(Invoke(this,
                 &MockWindowsInterface::WaitForSingleObjectConcrete));
@@ -20,6 +20,7 @@
 #include "winss/winss.hpp"
 #include "winss/not_owning_ptr.hpp"
 #include "winss/pipe_client.hpp"
+#include "winss/completion_port.hpp"
 #include "mock_interface.hpp"
 #include "mock_windows_interface.hpp"
 #include "mock_wait_multiplexer.hpp"
@@ -77,6 +78,24 @@ TEST_F(PipeClientTest, OuboundConnect) {
     client.Connect();
 }
 
+TEST_F(PipeClientTest, OuboundConnectCompletionPort) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    NiceMock<winss::MockWaitMultiplexer> multiplexer;
+    winss::CompletionPort completion_port(winss::NotOwned(&multiplexer));
+
+    EXPECT_CALL(multiplexer, AddTriggeredCallback(_, _)).Times(1);
+
+    winss::MockPipeName pipe_name("test");
+    MockedOutboundPipeClient client({
+        pipe_name, winss::NotOwned(&multiplexer)
+    });
+
+    client.SetCompletionPort(winss::NotOwned(&completion_port));
+    client.Connect();
+
+    EXPECT_EQ(1, completion_port.CallbackCount());
+}
+
 TEST_F(PipeClientTest, OuboundConnectFailed) {
     MockInterface<winss::MockWindowsInterface> windows;
     NiceMock<winss::MockWaitMultiplexer> multiplexer;
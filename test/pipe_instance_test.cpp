@@ -14,17 +14,24 @@
 * limitations under the License.
 */
 
+#include <memory>
+#include <string>
 #include <vector>
 #include <utility>
 #include "gtest/gtest.h"
 #include "gmock/gmock.h"
 #include "winss/winss.hpp"
 #include "winss/pipe_instance.hpp"
+#include "winss/completion_port.hpp"
+#include "winss/not_owning_ptr.hpp"
 #include "mock_interface.hpp"
 #include "mock_windows_interface.hpp"
+#include "mock_wait_multiplexer.hpp"
 #include "mock_pipe_name.hpp"
 
 using ::testing::_;
+using ::testing::InSequence;
+using ::testing::Invoke;
 using ::testing::NiceMock;
 using ::testing::Return;
 using ::testing::SetArgumentPointee;
@@ -32,6 +39,28 @@ using ::testing::DoAll;
 
 namespace winss {
 class PipeInstanceTest : public testing::Test {
+ protected:
+    std::vector<std::string> writes;
+
+    /**
+     * Records the data of each write.
+     */
+    void RecordWrites(MockInterface<winss::MockWindowsInterface>* windows) {
+        EXPECT_CALL(**windows, WriteFile(_, _, _, _, _))
+            .WillRepeatedly(Invoke([this](HANDLE, LPCVOID buffer,
+                DWORD to_write, LPDWORD, LPOVERLAPPED) {
+            const char* data = static_cast<const char*>(buffer);
+            writes.emplace_back(data, data + to_write);
+            return true;
+        }));
+    }
+
+    /**
+     * Writes all the queued messages.
+     */
+    void WriteAll(winss::OutboundPipeInstance* outbound) {
+        while (outbound->Write() && outbound->FinishWrite()) {}
+    }
 };
 
 TEST_F(PipeInstanceTest, InitialState) {
@@ -62,6 +91,9 @@ TEST_F(PipeInstanceTest, CreateNamedPipe) {
     EXPECT_CALL(*windows, GetLastError())
         .WillOnce(Return(ERROR_IO_PENDING));
 
+    EXPECT_CALL(*windows, CancelIoEx(reinterpret_cast<HANDLE>(10000), _))
+        .WillOnce(Return(true));
+
     winss::PipeInstance instance;
     winss::MockPipeName pipe_name("test");
 
@@ -136,6 +168,50 @@ TEST_F(PipeInstanceTest, CreateNamedPipeSynchronous) {
     EXPECT_TRUE(instance.GetHandle().HasHandle());
 }
 
+TEST_F(PipeInstanceTest, CreateNamedPipeCompletionPort) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    NiceMock<winss::MockWaitMultiplexer> multiplexer;
+
+    HANDLE port = reinterpret_cast<HANDLE>(7000);
+    HANDLE event = reinterpret_cast<HANDLE>(9000);
+    HANDLE pipe = reinterpret_cast<HANDLE>(10000);
+
+    EXPECT_CALL(*windows, CreateEvent(_, _, _, _))
+        .WillRepeatedly(Return(event));
+
+    EXPECT_CALL(*windows, CreateNamedPipe(_, _, _, _, _, _, _, _))
+        .WillOnce(Return(pipe));
+
+    EXPECT_CALL(*windows, CreateIoCompletionPort(INVALID_HANDLE_VALUE,
+        nullptr, 0, 1)).WillOnce(Return(port));
+    EXPECT_CALL(*windows, CreateIoCompletionPort(pipe, port,
+        reinterpret_cast<ULONG_PTR>(event), 0)).WillOnce(Return(port));
+
+    EXPECT_CALL(*windows, ConnectNamedPipe(pipe, _))
+        .WillOnce(Return(false));
+
+    EXPECT_CALL(*windows, GetLastError())
+        .WillRepeatedly(Return(ERROR_PIPE_CONNECTED));
+
+    EXPECT_CALL(*windows, SetEvent(_)).Times(0);
+    EXPECT_CALL(*windows, PostQueuedCompletionStatus(port, 0,
+        reinterpret_cast<ULONG_PTR>(event), nullptr)).WillOnce(Return(true));
+    EXPECT_CALL(*windows, PostQueuedCompletionStatus(port,
+        winss::CompletionPort::kDrainMarker,
+        reinterpret_cast<ULONG_PTR>(event), nullptr)).WillOnce(Return(true));
+    EXPECT_CALL(*windows, PostQueuedCompletionStatus(port, 0, 0, nullptr))
+        .WillOnce(Return(true));
+
+    winss::CompletionPort completion_port(winss::NotOwned(&multiplexer));
+    winss::PipeInstance instance;
+    winss::MockPipeName pipe_name("test");
+
+    instance.SetCompletionPort(winss::NotOwned(&completion_port));
+    EXPECT_TRUE(instance.CreateNamedPipe(pipe_name));
+    EXPECT_FALSE(instance.IsPendingIO());
+    EXPECT_FALSE(instance.IsConnected());
+}
+
 TEST_F(PipeInstanceTest, CreateFile) {
     MockInterface<winss::MockWindowsInterface> windows;
 
@@ -354,6 +430,63 @@ TEST_F(PipeInstanceTest, DisconnectNamedPipe) {
     EXPECT_FALSE(instance.IsConnected());
 }
 
+TEST_F(PipeInstanceTest, ConnectNamedPipeReuse) {
+    MockInterface<winss::MockWindowsInterface> windows;
+
+    EXPECT_CALL(*windows, CreateEvent(_, _, _, _))
+        .WillOnce(Return(reinterpret_cast<HANDLE>(9000)));
+
+    EXPECT_CALL(*windows, CreateNamedPipe(_, _, _, _, _, _, _, _))
+        .WillOnce(Return(reinterpret_cast<HANDLE>(10000)));
+
+    EXPECT_CALL(*windows, ConnectNamedPipe(reinterpret_cast<HANDLE>(10000),
+        _)).Times(2).WillRepeatedly(Return(false));
+
+    EXPECT_CALL(*windows, GetLastError())
+        .WillRepeatedly(Return(ERROR_IO_PENDING));
+
+    EXPECT_CALL(*windows, DisconnectNamedPipe(_)).Times(1);
+
+    winss::PipeInstance instance;
+    winss::MockPipeName pipe_name("test");
+
+    EXPECT_TRUE(instance.CreateNamedPipe(pipe_name));
+    EXPECT_TRUE(instance.SetConnected());
+    EXPECT_FALSE(instance.ConnectNamedPipe());
+    instance.Closing();
+    instance.DisconnectNamedPipe();
+    EXPECT_TRUE(instance.ConnectNamedPipe());
+    EXPECT_TRUE(instance.IsPendingIO());
+    EXPECT_FALSE(instance.IsConnected());
+    EXPECT_FALSE(instance.IsClosing());
+}
+
+TEST_F(PipeInstanceTest, OutboundDisconnectNamedPipe) {
+    MockInterface<winss::MockWindowsInterface> windows;
+
+    EXPECT_CALL(*windows, CreateEvent(_, _, _, _))
+        .WillOnce(Return(reinterpret_cast<HANDLE>(9000)));
+
+    EXPECT_CALL(*windows, CreateFile(_, _, _, _, _, _, _))
+        .WillOnce(Return(reinterpret_cast<HANDLE>(10000)));
+
+    EXPECT_CALL(*windows, DisconnectNamedPipe(_)).Times(1);
+    EXPECT_CALL(*windows, WriteFile(_, _, _, _, _)).Times(0);
+
+    winss::OutboundPipeInstance outbound;
+    winss::MockPipeName pipe_name("test");
+
+    EXPECT_TRUE(outbound.CreateFile(pipe_name));
+    EXPECT_TRUE(outbound.SetConnected());
+    EXPECT_TRUE(outbound.Queue({ 's', 'u' }));
+    EXPECT_EQ(2, outbound.GetBacklog());
+
+    outbound.DisconnectNamedPipe();
+    EXPECT_FALSE(outbound.HasMessages());
+    EXPECT_EQ(0, outbound.GetBacklog());
+    EXPECT_FALSE(outbound.Write());
+}
+
 TEST_F(PipeInstanceTest, DisconnectNamedPipeNotCreated) {
     MockInterface<winss::MockWindowsInterface> windows;
 
@@ -536,6 +669,343 @@ TEST_F(PipeInstanceTest, OutboundQueueLargePayload) {
     EXPECT_FALSE(outbound.FinishWrite());
 }
 
+TEST_F(PipeInstanceTest, OutboundQueueMessageShared) {
+    MockInterface<winss::MockWindowsInterface> windows;
+
+    EXPECT_CALL(*windows, CreateEvent(_, _, _, _))
+        .WillRepeatedly(Return(reinterpret_cast<HANDLE>(9000)));
+
+    EXPECT_CALL(*windows, CreateFile(_, _, _, _, _, _, _))
+        .WillRepeatedly(Return(reinterpret_cast<HANDLE>(10000)));
+
+    std::vector<char> to_send(4096 + 10, 'a');
+    winss::PipeMessage message =
+        std::make_shared<const std::vector<char>>(to_send);
+
+    EXPECT_CALL(*windows, WriteFile(_, message->data(), 4096, _, _))
+        .Times(2)
+        .WillRepeatedly(Return(true));
+    EXPECT_CALL(*windows, WriteFile(_, message->data() + 4096, 10, _, _))
+        .Times(2)
+        .WillRepeatedly(Return(true));
+
+    winss::OutboundPipeInstance outbound1;
+    winss::OutboundPipeInstance outbound2;
+    winss::MockPipeName pipe_name("test");
+
+    EXPECT_TRUE(outbound1.CreateFile(pipe_name));
+    EXPECT_TRUE(outbound1.SetConnected());
+    EXPECT_TRUE(outbound2.CreateFile(pipe_name));
+    EXPECT_TRUE(outbound2.SetConnected());
+
+    EXPECT_FALSE(outbound1.QueueMessage(winss::PipeMessage()));
+    EXPECT_TRUE(outbound1.QueueMessage(message));
+    EXPECT_TRUE(outbound2.QueueMessage(message));
+    EXPECT_EQ(3, message.use_count());
+
+    for (auto outbound : { &outbound1, &outbound2 }) {
+        EXPECT_TRUE(outbound->Write());
+        EXPECT_TRUE(outbound->FinishWrite());
+        EXPECT_TRUE(outbound->Write());
+        EXPECT_FALSE(outbound->FinishWrite());
+        EXPECT_FALSE(outbound->HasMessages());
+    }
+
+    EXPECT_EQ(1, message.use_count());
+}
+
+TEST_F(PipeInstanceTest, OutboundQueueCoalesce) {
+    MockInterface<winss::MockWindowsInterface> windows;
+
+    EXPECT_CALL(*windows, CreateEvent(_, _, _, _))
+        .WillOnce(Return(reinterpret_cast<HANDLE>(9000)));
+
+    EXPECT_CALL(*windows, CreateFile(_, _, _, _, _, _, _))
+        .WillOnce(Return(reinterpret_cast<HANDLE>(10000)));
+
+    RecordWrites(&windows);
+
+    winss::OutboundPipeInstance outbound;
+    winss::MockPipeName pipe_name("test");
+
+    EXPECT_TRUE(outbound.CreateFile(pipe_name));
+    EXPECT_TRUE(outbound.SetConnected());
+    EXPECT_TRUE(outbound.Queue({ 's' }));
+    EXPECT_TRUE(outbound.Write());
+    EXPECT_TRUE(outbound.Queue({ 'u' }));
+    EXPECT_TRUE(outbound.QueueMessage(
+        std::make_shared<const std::vector<char>>(1, 'd')));
+    EXPECT_TRUE(outbound.Queue({ 'D' }));
+    EXPECT_TRUE(outbound.FinishWrite());
+    WriteAll(&outbound);
+
+    ASSERT_EQ(2, writes.size());
+    EXPECT_EQ("s", writes[0]);
+    EXPECT_EQ("udD", writes[1]);
+    EXPECT_FALSE(outbound.HasMessages());
+}
+
+TEST_F(PipeInstanceTest, OutboundQueueCoalesceOrder) {
+    MockInterface<winss::MockWindowsInterface> windows;
+
+    EXPECT_CALL(*windows, CreateEvent(_, _, _, _))
+        .WillOnce(Return(reinterpret_cast<HANDLE>(9000)));
+
+    EXPECT_CALL(*windows, CreateFile(_, _, _, _, _, _, _))
+        .WillOnce(Return(reinterpret_cast<HANDLE>(10000)));
+
+    RecordWrites(&windows);
+
+    std::string large(winss::PipeInstance::kCoalesceSize + 1, 'a');
+
+    winss::OutboundPipeInstance outbound;
+    winss::MockPipeName pipe_name("test");
+
+    EXPECT_TRUE(outbound.CreateFile(pipe_name));
+    EXPECT_TRUE(outbound.SetConnected());
+    EXPECT_TRUE(outbound.Queue({ 's' }));
+    EXPECT_TRUE(outbound.Queue({ 'u' }));
+    EXPECT_TRUE(outbound.Queue(std::vector<char>(large.begin(),
+        large.end())));
+    EXPECT_TRUE(outbound.Queue({ 'd' }));
+    WriteAll(&outbound);
+
+    ASSERT_EQ(3, writes.size());
+    EXPECT_EQ("su", writes[0]);
+    EXPECT_EQ(large, writes[1]);
+    EXPECT_EQ("d", writes[2]);
+}
+
+TEST_F(PipeInstanceTest, OutboundQueueCoalesceWrap) {
+    MockInterface<winss::MockWindowsInterface> windows;
+
+    EXPECT_CALL(*windows, CreateEvent(_, _, _, _))
+        .WillOnce(Return(reinterpret_cast<HANDLE>(9000)));
+
+    EXPECT_CALL(*windows, CreateFile(_, _, _, _, _, _, _))
+        .WillOnce(Return(reinterpret_cast<HANDLE>(10000)));
+
+    RecordWrites(&windows);
+
+    std::vector<char> chunk(winss::PipeInstance::kCoalesceSize, 'a');
+    size_t count = winss::PipeInstance::kBufferSize / chunk.size();
+
+    winss::OutboundPipeInstance outbound;
+    winss::MockPipeName pipe_name("test");
+
+    EXPECT_TRUE(outbound.CreateFile(pipe_name));
+    EXPECT_TRUE(outbound.SetConnected());
+    EXPECT_TRUE(outbound.Queue(chunk));
+    EXPECT_TRUE(outbound.Queue(chunk));
+    EXPECT_TRUE(outbound.Write());
+
+    for (size_t i = 2; i < count; ++i) {
+        EXPECT_TRUE(outbound.Queue(chunk));
+    }
+
+    EXPECT_TRUE(outbound.FinishWrite());
+
+    std::vector<char> wrapped(chunk.size(), 'b');
+    EXPECT_TRUE(outbound.Queue(wrapped));
+    EXPECT_TRUE(outbound.Queue(wrapped));
+    EXPECT_TRUE(outbound.Queue(wrapped));
+    WriteAll(&outbound);
+
+    ASSERT_EQ(4, writes.size());
+    EXPECT_EQ(std::string(chunk.size() * 2, 'a'), writes[0]);
+    EXPECT_EQ(std::string(chunk.size() * (count - 2), 'a'), writes[1]);
+    EXPECT_EQ(std::string(chunk.size() * 2, 'b'), writes[2]);
+    EXPECT_EQ(std::string(chunk.size(), 'b'), writes[3]);
+}
+
+TEST_F(PipeInstanceTest, OutboundBacklogDropOldest) {
+    MockInterface<winss::MockWindowsInterface> windows;
+
+    EXPECT_CALL(*windows, CreateEvent(_, _, _, _))
+        .WillOnce(Return(reinterpret_cast<HANDLE>(9000)));
+
+    EXPECT_CALL(*windows, CreateFile(_, _, _, _, _, _, _))
+        .WillOnce(Return(reinterpret_cast<HANDLE>(10000)));
+
+    RecordWrites(&windows);
+
+    std::string large(winss::PipeInstance::kCoalesceSize + 1, 'a');
+
+    winss::OutboundPipeInstance outbound;
+    winss::MockPipeName pipe_name("test");
+
+    EXPECT_TRUE(outbound.CreateFile(pipe_name));
+    EXPECT_TRUE(outbound.SetConnected());
+    outbound.SetBacklog(large.size() + 2, winss::BACKLOG_DROP_OLDEST);
+
+    EXPECT_TRUE(outbound.Queue({ 's' }));
+    EXPECT_TRUE(outbound.Write());
+    EXPECT_TRUE(outbound.Queue({ 'u' }));
+    EXPECT_TRUE(outbound.Queue(std::vector<char>(large.begin(),
+        large.end())));
+    EXPECT_EQ(large.size() + 2, outbound.GetBacklog());
+    EXPECT_TRUE(outbound.Queue({ 'd' }));
+    EXPECT_EQ(large.size() + 2, outbound.GetBacklog());
+    EXPECT_EQ(1, outbound.GetBacklogCounters().dropped);
+    EXPECT_EQ(0, outbound.GetBacklogCounters().coalesced);
+    EXPECT_TRUE(outbound.FinishWrite());
+    WriteAll(&outbound);
+
+    ASSERT_EQ(3, writes.size());
+    EXPECT_EQ("s", writes[0]);
+    EXPECT_EQ(large, writes[1]);
+    EXPECT_EQ("d", writes[2]);
+    EXPECT_EQ(0, outbound.GetBacklog());
+}
+
+TEST_F(PipeInstanceTest, OutboundBacklogDropOldestRing) {
+    MockInterface<winss::MockWindowsInterface> windows;
+
+    EXPECT_CALL(*windows, CreateEvent(_, _, _, _))
+        .WillOnce(Return(reinterpret_cast<HANDLE>(9000)));
+
+    EXPECT_CALL(*windows, CreateFile(_, _, _, _, _, _, _))
+        .WillOnce(Return(reinterpret_cast<HANDLE>(10000)));
+
+    RecordWrites(&windows);
+
+    std::string large(winss::PipeInstance::kCoalesceSize + 1, 'a');
+
+    winss::OutboundPipeInstance outbound;
+    winss::MockPipeName pipe_name("test");
+
+    EXPECT_TRUE(outbound.CreateFile(pipe_name));
+    EXPECT_TRUE(outbound.SetConnected());
+    outbound.SetBacklog(large.size() + 4, winss::BACKLOG_DROP_OLDEST);
+
+    EXPECT_TRUE(outbound.Queue({ 's', 'u' }));
+    EXPECT_TRUE(outbound.Queue(std::vector<char>(large.begin(),
+        large.end())));
+    EXPECT_TRUE(outbound.Queue({ 'd', 'D' }));
+    EXPECT_TRUE(outbound.Queue({ 'x' }));
+    EXPECT_EQ(1, outbound.GetBacklogCounters().dropped);
+    WriteAll(&outbound);
+
+    ASSERT_EQ(2, writes.size());
+    EXPECT_EQ(large, writes[0]);
+    EXPECT_EQ("dDx", writes[1]);
+}
+
+TEST_F(PipeInstanceTest, OutboundBacklogCoalesce) {
+    MockInterface<winss::MockWindowsInterface> windows;
+
+    EXPECT_CALL(*windows, CreateEvent(_, _, _, _))
+        .WillOnce(Return(reinterpret_cast<HANDLE>(9000)));
+
+    EXPECT_CALL(*windows, CreateFile(_, _, _, _, _, _, _))
+        .WillOnce(Return(reinterpret_cast<HANDLE>(10000)));
+
+    RecordWrites(&windows);
+
+    std::string large(winss::PipeInstance::kCoalesceSize + 1, 'a');
+
+    winss::OutboundPipeInstance outbound;
+    winss::MockPipeName pipe_name("test");
+
+    EXPECT_TRUE(outbound.CreateFile(pipe_name));
+    EXPECT_TRUE(outbound.SetConnected());
+    outbound.SetBacklog(large.size() + 3, winss::BACKLOG_COALESCE);
+
+    EXPECT_TRUE(outbound.Queue({ 's' }));
+    EXPECT_TRUE(outbound.Write());
+    EXPECT_TRUE(outbound.Queue({ 'u' }));
+    EXPECT_TRUE(outbound.Queue({ 'd' }));
+    EXPECT_TRUE(outbound.Queue(std::vector<char>(large.begin(),
+        large.end())));
+    EXPECT_TRUE(outbound.Queue({ 'D' }));
+    EXPECT_EQ(2, outbound.GetBacklog());
+    EXPECT_EQ(0, outbound.GetBacklogCounters().dropped);
+    EXPECT_EQ(3, outbound.GetBacklogCounters().coalesced);
+    EXPECT_TRUE(outbound.FinishWrite());
+    WriteAll(&outbound);
+
+    ASSERT_EQ(2, writes.size());
+    EXPECT_EQ("s", writes[0]);
+    EXPECT_EQ("D", writes[1]);
+}
+
+TEST_F(PipeInstanceTest, OutboundBacklogDisconnect) {
+    MockInterface<winss::MockWindowsInterface> windows;
+
+    EXPECT_CALL(*windows, CreateEvent(_, _, _, _))
+        .WillOnce(Return(reinterpret_cast<HANDLE>(9000)));
+
+    EXPECT_CALL(*windows, CreateFile(_, _, _, _, _, _, _))
+        .WillOnce(Return(reinterpret_cast<HANDLE>(10000)));
+
+    EXPECT_CALL(*windows, WriteFile(_, _, 1, _, _))
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*windows, SetEvent(reinterpret_cast<HANDLE>(9000)))
+        .WillRepeatedly(Return(true));
+
+    winss::OutboundPipeInstance outbound;
+    winss::MockPipeName pipe_name("test");
+
+    EXPECT_TRUE(outbound.CreateFile(pipe_name));
+    EXPECT_TRUE(outbound.SetConnected());
+    outbound.SetBacklog(1, winss::BACKLOG_DISCONNECT);
+
+    EXPECT_TRUE(outbound.Queue({ 's' }));
+    EXPECT_TRUE(outbound.Write());
+    EXPECT_FALSE(outbound.Queue({ 'u' }));
+    EXPECT_FALSE(outbound.Queue({ 'd' }));
+    EXPECT_TRUE(outbound.IsClosing());
+    EXPECT_EQ(1, outbound.GetBacklogCounters().disconnected);
+    EXPECT_EQ(1, outbound.GetBacklog());
+}
+
+TEST_F(PipeInstanceTest, OutboundBacklogDisconnectPending) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    HANDLE handle = reinterpret_cast<HANDLE>(10000);
+
+    EXPECT_CALL(*windows, CreateEvent(_, _, _, _))
+        .WillOnce(Return(reinterpret_cast<HANDLE>(9000)));
+
+    EXPECT_CALL(*windows, CreateFile(_, _, _, _, _, _, _))
+        .WillOnce(Return(handle));
+
+    EXPECT_CALL(*windows, WriteFile(_, _, 1, _, _))
+        .WillOnce(Return(false));
+
+    EXPECT_CALL(*windows, GetLastError())
+        .WillRepeatedly(Return(ERROR_IO_PENDING));
+
+    winss::OutboundPipeInstance outbound;
+    winss::MockPipeName pipe_name("test");
+
+    EXPECT_TRUE(outbound.CreateFile(pipe_name));
+    EXPECT_TRUE(outbound.SetConnected());
+    outbound.SetBacklog(1, winss::BACKLOG_DISCONNECT);
+
+    EXPECT_TRUE(outbound.Queue({ 's' }));
+    EXPECT_TRUE(outbound.Write());
+    EXPECT_FALSE(outbound.Queue({ 'u' }));
+    EXPECT_TRUE(outbound.IsClosing());
+    EXPECT_EQ(REMOVE, outbound.GetOverlappedResult());
+
+    {
+        InSequence sequence;
+
+        EXPECT_CALL(*windows, CancelIoEx(handle, _))
+            .WillOnce(Return(true));
+        EXPECT_CALL(*windows, GetOverlappedResult(handle, _, _, TRUE))
+            .WillOnce(Return(false));
+        EXPECT_CALL(*windows, DisconnectNamedPipe(handle))
+            .WillOnce(Return(true));
+    }
+
+    outbound.DisconnectNamedPipe();
+    EXPECT_FALSE(outbound.IsPendingIO());
+    EXPECT_FALSE(outbound.HasMessages());
+    EXPECT_EQ(0, outbound.GetBacklog());
+}
+
 TEST_F(PipeInstanceTest, OutboundQueuePending) {
     MockInterface<winss::MockWindowsInterface> windows;
 
@@ -551,6 +1021,9 @@ TEST_F(PipeInstanceTest, OutboundQueuePending) {
     EXPECT_CALL(*windows, GetLastError())
         .WillOnce(Return(ERROR_IO_PENDING));
 
+    EXPECT_CALL(*windows, CancelIoEx(reinterpret_cast<HANDLE>(10000), _))
+        .WillOnce(Return(true));
+
     winss::OutboundPipeInstance outbound;
     winss::MockPipeName pipe_name("test");
 
@@ -628,6 +1101,9 @@ TEST_F(PipeInstanceTest, OutboundRead) {
     EXPECT_CALL(*windows, GetLastError())
         .WillOnce(Return(ERROR_IO_PENDING));
 
+    EXPECT_CALL(*windows, CancelIoEx(reinterpret_cast<HANDLE>(10000), _))
+        .WillOnce(Return(true));
+
     EXPECT_CALL(*windows, SetEvent(_)).Times(1);
 
     winss::OutboundPipeInstance outbound;
@@ -639,6 +1115,36 @@ TEST_F(PipeInstanceTest, OutboundRead) {
     outbound.Read();
 }
 
+TEST_F(PipeInstanceTest, OutboundReadCompletionPort) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    NiceMock<winss::MockWaitMultiplexer> multiplexer;
+
+    HANDLE port = reinterpret_cast<HANDLE>(7000);
+
+    EXPECT_CALL(*windows, CreateEvent(_, _, _, _))
+        .WillRepeatedly(Return(reinterpret_cast<HANDLE>(9000)));
+
+    EXPECT_CALL(*windows, CreateFile(_, _, _, _, _, _, _))
+        .WillOnce(Return(reinterpret_cast<HANDLE>(10000)));
+
+    EXPECT_CALL(*windows, CreateIoCompletionPort(_, _, _, _))
+        .WillRepeatedly(Return(port));
+
+    EXPECT_CALL(*windows, ReadFile(_, _, 0, _, _))
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(*windows, SetEvent(_)).Times(0);
+
+    winss::CompletionPort completion_port(winss::NotOwned(&multiplexer));
+    winss::OutboundPipeInstance outbound;
+    winss::MockPipeName pipe_name("test");
+
+    outbound.SetCompletionPort(winss::NotOwned(&completion_port));
+    EXPECT_TRUE(outbound.CreateFile(pipe_name));
+    EXPECT_TRUE(outbound.SetConnected());
+    outbound.Read();
+}
+
 TEST_F(PipeInstanceTest, OutboundReadClosing) {
     MockInterface<winss::MockWindowsInterface> windows;
 
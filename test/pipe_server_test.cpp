@@ -16,12 +16,14 @@
 
 #include <vector>
 #include <map>
+#include <memory>
 #include "gtest/gtest.h"
 #include "gmock/gmock.h"
 #include "winss/winss.hpp"
 #include "winss/not_owning_ptr.hpp"
 #include "winss/pipe_server.hpp"
 #include "winss/handle_wrapper.hpp"
+#include "winss/completion_port.hpp"
 #include "mock_interface.hpp"
 #include "mock_windows_interface.hpp"
 #include "mock_wait_multiplexer.hpp"
@@ -32,7 +34,10 @@
 using ::testing::_;
 using ::testing::NiceMock;
 using ::testing::Return;
+using ::testing::ReturnRef;
 using ::testing::An;
+using ::testing::DoAll;
+using ::testing::SaveArg;
 
 namespace winss {
 class PipeServerTest : public testing::Test {
@@ -107,6 +112,26 @@ TEST_F(PipeServerTest, Init) {
     EXPECT_TRUE(server.IsAccepting());
 }
 
+TEST_F(PipeServerTest, CompletionPort) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    NiceMock<winss::MockWaitMultiplexer> multiplexer;
+    winss::CompletionPort completion_port(winss::NotOwned(&multiplexer));
+
+    EXPECT_CALL(multiplexer, AddTriggeredCallback(_, _)).Times(1);
+
+    winss::MockPipeName pipe_name("test");
+    MockedPipeServer server({
+        pipe_name, winss::NotOwned(&multiplexer)
+    });
+    server.SetCompletionPort(winss::NotOwned(&completion_port));
+
+    multiplexer.mock_init_callbacks.at(0)(multiplexer);
+
+    EXPECT_TRUE(server.IsAccepting());
+    EXPECT_EQ(1, server.InstanceCount());
+    EXPECT_EQ(1, completion_port.CallbackCount());
+}
+
 TEST_F(PipeServerTest, Triggered) {
     MockInterface<winss::MockWindowsInterface> windows;
     NiceMock<winss::MockWaitMultiplexer> multiplexer;
@@ -182,6 +207,70 @@ TEST_F(PipeServerTest, TriggeredDisconnectedNotOpen) {
     EXPECT_EQ(1, server.InstanceCount());
 }
 
+TEST_F(PipeServerTest, TriggeredDisconnectedReuse) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    NiceMock<winss::MockWaitMultiplexer> multiplexer;
+
+    winss::MockPipeName pipe_name("test");
+    MockedPipeServer server({
+        pipe_name, winss::NotOwned(&multiplexer)
+    });
+
+    multiplexer.mock_init_callbacks.at(0)(multiplexer);
+
+    winss::MockPipeInstance* instance =
+        &server.GetInstances()->begin()->second;
+    auto handle = instance->GetHandle();
+
+    EXPECT_CALL(*instance, GetOverlappedResult())
+        .WillOnce(Return(CONTINUE))
+        .WillOnce(Return(REMOVE));
+    EXPECT_CALL(*instance, SetConnected()).WillOnce(Return(true));
+    EXPECT_CALL(*instance, IsConnected()).WillOnce(Return(true));
+    EXPECT_CALL(*instance, ConnectNamedPipe()).WillOnce(Return(true));
+    EXPECT_CALL(*instance, Close()).Times(0);
+
+    multiplexer.mock_triggered_callbacks.at(0)(multiplexer, handle);
+    EXPECT_EQ(2, server.InstanceCount());
+
+    multiplexer.mock_triggered_callbacks.at(0)(multiplexer, handle);
+
+    EXPECT_TRUE(server.IsAccepting());
+    EXPECT_EQ(2, server.InstanceCount());
+    EXPECT_EQ(1, server.GetInstances()->count(handle));
+    EXPECT_EQ(4, multiplexer.mock_triggered_callbacks.size());
+
+    EXPECT_CALL(*instance, Close()).Times(1);
+}
+
+TEST_F(PipeServerTest, ListenCount) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    NiceMock<winss::MockWaitMultiplexer> multiplexer;
+
+    winss::MockPipeName pipe_name("test");
+    MockedPipeServer server({
+        pipe_name, winss::NotOwned(&multiplexer), 0,
+        winss::BACKLOG_DROP_OLDEST, 4
+    });
+
+    multiplexer.mock_init_callbacks.at(0)(multiplexer);
+
+    EXPECT_TRUE(server.IsAccepting());
+    EXPECT_EQ(4, server.InstanceCount());
+    EXPECT_EQ(4, multiplexer.mock_triggered_callbacks.size());
+
+    winss::MockPipeInstance* instance =
+        &server.GetInstances()->begin()->second;
+    auto handle = instance->GetHandle();
+
+    EXPECT_CALL(*instance, GetOverlappedResult()).WillOnce(Return(CONTINUE));
+    EXPECT_CALL(*instance, SetConnected()).WillOnce(Return(true));
+
+    multiplexer.mock_triggered_callbacks.at(0)(multiplexer, handle);
+
+    EXPECT_EQ(5, server.InstanceCount());
+}
+
 TEST_F(PipeServerTest, TriggeredDisconnectedSkip) {
     MockInterface<winss::MockWindowsInterface> windows;
     NiceMock<winss::MockWaitMultiplexer> multiplexer;
@@ -273,7 +362,7 @@ TEST_F(PipeServerTest, OutboundConnected) {
 
     EXPECT_CALL(*instance, GetOverlappedResult()).WillOnce(Return(CONTINUE));
     EXPECT_CALL(*instance, SetConnected()).WillOnce(Return(true));
-    EXPECT_CALL(*instance, Queue(_)).WillOnce(Return(true));
+    EXPECT_CALL(*instance, QueueMessage(_)).WillOnce(Return(true));
     EXPECT_CALL(*instance, Write()).WillOnce(Return(true));
 
     multiplexer.mock_triggered_callbacks.at(0)(multiplexer, handle);
@@ -317,14 +406,18 @@ TEST_F(PipeServerTest, OutboundWrittenAll) {
     auto handle2 = other->GetHandle();
     multiplexer.mock_triggered_callbacks.at(0)(multiplexer, handle2);
 
-    EXPECT_CALL(*instance, Queue(_)).Times(1).WillRepeatedly(Return(true));
+    EXPECT_CALL(*instance, QueueMessage(_))
+        .Times(1)
+        .WillRepeatedly(Return(true));
     EXPECT_CALL(*instance, Write()).Times(2).WillRepeatedly(Return(true));
 
     EXPECT_CALL(*instance, FinishWrite())
         .WillOnce(Return(true))
         .WillOnce(Return(false));
 
-    EXPECT_CALL(*other, Queue(_)).Times(1).WillRepeatedly(Return(true));
+    EXPECT_CALL(*other, QueueMessage(_))
+        .Times(1)
+        .WillRepeatedly(Return(true));
     EXPECT_CALL(*other, Write()).Times(2).WillRepeatedly(Return(true));
 
     EXPECT_CALL(*other, FinishWrite())
@@ -340,6 +433,93 @@ TEST_F(PipeServerTest, OutboundWrittenAll) {
     multiplexer.mock_triggered_callbacks.at(0)(multiplexer, handle2);
 }
 
+TEST_F(PipeServerTest, OutboundSendShared) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    NiceMock<winss::MockWaitMultiplexer> multiplexer;
+
+    winss::MockPipeName pipe_name("test");
+    MockedOutboundPipeServer server({
+        pipe_name, winss::NotOwned(&multiplexer)
+    });
+
+    multiplexer.mock_init_callbacks.at(0)(multiplexer);
+
+    winss::MockOutboundPipeInstance* instance =
+        &server.GetInstances()->begin()->second;
+    auto handle = instance->GetHandle();
+
+    EXPECT_CALL(*instance, GetOverlappedResult()).WillOnce(Return(CONTINUE));
+    EXPECT_CALL(*instance, SetConnected()).WillOnce(Return(true));
+
+    multiplexer.mock_triggered_callbacks.at(0)(multiplexer, handle);
+
+    winss::MockOutboundPipeInstance* other =
+        GetOther(server.GetInstances(), handle);
+    ASSERT_NE(nullptr, other);
+
+    winss::PipeMessage message1;
+    winss::PipeMessage message2;
+
+    EXPECT_CALL(*instance, QueueMessage(_))
+        .WillOnce(DoAll(SaveArg<0>(&message1), Return(true)));
+    EXPECT_CALL(*instance, IsWriting()).WillOnce(Return(true));
+    EXPECT_CALL(*instance, Write()).Times(0);
+
+    EXPECT_CALL(*other, QueueMessage(_))
+        .WillOnce(DoAll(SaveArg<0>(&message2), Return(true)));
+    EXPECT_CALL(*other, IsWriting()).WillOnce(Return(false));
+    EXPECT_CALL(*other, Write()).WillOnce(Return(true));
+
+    EXPECT_TRUE(server.Send({ '1', '2' }));
+
+    ASSERT_TRUE(message1 != nullptr);
+    EXPECT_EQ(message1, message2);
+    EXPECT_EQ(std::vector<char>({ '1', '2' }), *message1);
+}
+
+TEST_F(PipeServerTest, OutboundBacklog) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    NiceMock<winss::MockWaitMultiplexer> multiplexer;
+
+    winss::MockPipeName pipe_name("test");
+    MockedOutboundPipeServer server({
+        pipe_name, winss::NotOwned(&multiplexer), 100,
+        winss::BACKLOG_COALESCE
+    });
+
+    multiplexer.mock_init_callbacks.at(0)(multiplexer);
+
+    winss::MockOutboundPipeInstance* instance =
+        &server.GetInstances()->begin()->second;
+    auto handle = instance->GetHandle();
+
+    EXPECT_CALL(*instance, GetOverlappedResult()).WillOnce(Return(CONTINUE));
+    EXPECT_CALL(*instance, SetConnected()).WillOnce(Return(true));
+    EXPECT_CALL(*instance, SetBacklog(100, winss::BACKLOG_COALESCE))
+        .Times(1);
+
+    multiplexer.mock_triggered_callbacks.at(0)(multiplexer, handle);
+
+    winss::BacklogCounters counters{ 3, 2, 1 };
+    EXPECT_CALL(*instance, GetBacklogCounters())
+        .WillRepeatedly(ReturnRef(counters));
+
+    winss::BacklogCounters total = server.GetBacklogCounters();
+    EXPECT_EQ(3, total.dropped);
+    EXPECT_EQ(2, total.coalesced);
+    EXPECT_EQ(1, total.disconnected);
+
+    EXPECT_CALL(*instance, IsConnected()).WillRepeatedly(Return(true));
+    EXPECT_CALL(*instance, GetOverlappedResult()).WillOnce(Return(REMOVE));
+    multiplexer.mock_triggered_callbacks.at(1)(multiplexer, handle);
+    EXPECT_EQ(1, server.InstanceCount());
+
+    total = server.GetBacklogCounters();
+    EXPECT_EQ(3, total.dropped);
+    EXPECT_EQ(2, total.coalesced);
+    EXPECT_EQ(1, total.disconnected);
+}
+
 TEST_F(PipeServerTest, InboundRead) {
     MockInterface<winss::MockWindowsInterface> windows;
     NiceMock<winss::MockWaitMultiplexer> multiplexer;
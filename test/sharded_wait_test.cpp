@@ -0,0 +1,202 @@
+/*
+* Copyright 2016-2017 Morgan Stanley
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <atomic>
+#include <vector>
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include "winss/winss.hpp"
+#include "winss/handle_wrapper.hpp"
+#include "winss/sharded_wait.hpp"
+#include "mock_interface.hpp"
+#include "mock_windows_interface.hpp"
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::NiceMock;
+using ::testing::Return;
+
+namespace winss {
+class ShardedWaitTest : public testing::Test {
+ protected:
+    std::vector<HANDLE> CreateHandles(size_t count) {
+        std::vector<HANDLE> handles;
+
+        for (size_t i = 0; i < count; ++i) {
+            handles.push_back(reinterpret_cast<HANDLE>(10000 + i));
+        }
+
+        return handles;
+    }
+};
+
+TEST_F(ShardedWaitTest, WaitDirect) {
+    MockInterface<winss::MockWindowsInterface> windows;
+
+    EXPECT_CALL(*windows, CreateEvent(_, _, _, _)).Times(0);
+    EXPECT_CALL(*windows, WaitForMultipleObjects(MAXIMUM_WAIT_OBJECTS, _, _,
+        1000)).WillOnce(Return(WAIT_OBJECT_0 + 5));
+
+    auto handles = CreateHandles(MAXIMUM_WAIT_OBJECTS);
+
+    winss::ShardedWait waiter;
+    size_t index = 0;
+    auto state = waiter.Wait(1000, handles.data(), handles.size(),
+        &index);
+
+    EXPECT_EQ(SUCCESS, state);
+    EXPECT_EQ(5, index);
+}
+
+TEST_F(ShardedWaitTest, WaitShards) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    windows->SetupDefaults();
+
+    auto handles = CreateHandles(200);
+    HANDLE target = reinterpret_cast<HANDLE>(10150);
+    std::atomic<DWORD> max_count(0);
+    std::atomic<int> calls(0);
+
+    EXPECT_CALL(*windows, WaitForMultipleObjects(_, _, _, 1000))
+        .WillRepeatedly(Invoke([&](DWORD handles_count, const HANDLE* h,
+            bool, DWORD) {
+        calls++;
+        if (handles_count > max_count) {
+            max_count = handles_count;
+        }
+
+        for (DWORD i = 0; i < handles_count; ++i) {
+            if (h[i] == target) {
+                return WAIT_OBJECT_0 + i;
+            }
+        }
+
+        return WAIT_OBJECT_0 + handles_count - 1;
+    }));
+
+    winss::ShardedWait waiter;
+    size_t index = 0;
+    auto state = waiter.Wait(1000, handles.data(), handles.size(),
+        &index);
+
+    EXPECT_EQ(SUCCESS, state);
+    EXPECT_EQ(150, index);
+    EXPECT_EQ(4, calls);
+    EXPECT_EQ(MAXIMUM_WAIT_OBJECTS, max_count);
+}
+
+TEST_F(ShardedWaitTest, WaitShardsLowestWins) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    windows->SetupDefaults();
+
+    auto handles = CreateHandles(300);
+
+    EXPECT_CALL(*windows, WaitForMultipleObjects(_, _, _, _))
+        .WillRepeatedly(Invoke([](DWORD handles_count, const HANDLE* h,
+            bool, DWORD) {
+        for (DWORD i = 0; i < handles_count; ++i) {
+            if (h[i] == reinterpret_cast<HANDLE>(10070) ||
+                h[i] == reinterpret_cast<HANDLE>(10250)) {
+                return WAIT_OBJECT_0 + i;
+            }
+        }
+
+        return WAIT_OBJECT_0 + handles_count - 1;
+    }));
+
+    winss::ShardedWait waiter;
+    size_t index = 0;
+    auto state = waiter.Wait(1000, handles.data(), handles.size(),
+        &index);
+
+    EXPECT_EQ(SUCCESS, state);
+    EXPECT_EQ(70, index);
+}
+
+TEST_F(ShardedWaitTest, WaitShardsTimeout) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    windows->SetupDefaults();
+
+    auto handles = CreateHandles(100);
+
+    EXPECT_CALL(*windows, WaitForMultipleObjects(_, _, _, 100))
+        .Times(2)
+        .WillRepeatedly(Return(WAIT_TIMEOUT));
+
+    winss::ShardedWait waiter;
+    size_t index = 0;
+    auto state = waiter.Wait(100, handles.data(), handles.size(),
+        &index);
+
+    EXPECT_EQ(TIMEOUT, state);
+}
+
+TEST_F(ShardedWaitTest, WaitShardsFailed) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    windows->SetupDefaults();
+
+    auto handles = CreateHandles(100);
+
+    EXPECT_CALL(*windows, WaitForMultipleObjects(_, _, _, _))
+        .WillOnce(Return(WAIT_FAILED))
+        .WillRepeatedly(Return(WAIT_TIMEOUT));
+
+    winss::ShardedWait waiter;
+    size_t index = 0;
+    auto state = waiter.Wait(100, handles.data(), handles.size(),
+        &index);
+
+    EXPECT_EQ(FAILED, state);
+}
+
+TEST_F(ShardedWaitTest, WaitShardsReused) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    windows->SetupDefaults();
+
+    auto handles = CreateHandles(200);
+    HANDLE target = reinterpret_cast<HANDLE>(10010);
+    std::atomic<int> calls(0);
+
+    EXPECT_CALL(*windows, WaitForMultipleObjects(_, _, _, _))
+        .WillRepeatedly(Invoke([&](DWORD handles_count, const HANDLE* h,
+            bool, DWORD) {
+        calls++;
+        for (DWORD i = 0; i < handles_count; ++i) {
+            if (h[i] == target) {
+                return WAIT_OBJECT_0 + i;
+            }
+        }
+
+        return WAIT_OBJECT_0 + handles_count - 1;
+    }));
+
+    winss::ShardedWait waiter;
+    size_t index = 0;
+    auto state = waiter.Wait(1000, handles.data(), handles.size(),
+        &index);
+    EXPECT_EQ(SUCCESS, state);
+    EXPECT_EQ(10, index);
+    EXPECT_EQ(4, calls);
+
+    target = reinterpret_cast<HANDLE>(10120);
+    handles.resize(130);
+    state = waiter.Wait(1000, handles.data(), handles.size(),
+        &index);
+    EXPECT_EQ(SUCCESS, state);
+    EXPECT_EQ(120, index);
+    EXPECT_EQ(7, calls);
+}
+}  // namespace winss
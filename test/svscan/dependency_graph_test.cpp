@@ -0,0 +1,75 @@
+/*
+* Copyright 2016-2017 Morgan Stanley
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include "winss/svscan/dependency_graph.hpp"
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+namespace winss {
+class DependencyGraphTest : public testing::Test {
+};
+
+TEST_F(DependencyGraphTest, Waiting) {
+    winss::DependencyGraph graph;
+
+    graph.Set("app", { "db", "cache" });
+
+    EXPECT_THAT(graph.Waiting("app"), ElementsAre("db", "cache"));
+    EXPECT_THAT(graph.Waiting("db"), IsEmpty());
+    EXPECT_THAT(graph.Waiting("unknown"), IsEmpty());
+
+    graph.Ready("db");
+    EXPECT_TRUE(graph.IsReady("db"));
+    EXPECT_THAT(graph.Waiting("app"), ElementsAre("cache"));
+
+    graph.Ready("cache");
+    EXPECT_THAT(graph.Waiting("app"), IsEmpty());
+
+    graph.Remove("cache");
+    EXPECT_FALSE(graph.IsReady("cache"));
+    EXPECT_THAT(graph.Waiting("app"), ElementsAre("cache"));
+
+    graph.Set("app", {});
+    EXPECT_THAT(graph.Waiting("app"), IsEmpty());
+}
+
+TEST_F(DependencyGraphTest, FindCycle) {
+    winss::DependencyGraph graph;
+
+    graph.Set("app", { "db", "cache" });
+    graph.Set("cache", { "db" });
+    graph.Set("db", {});
+
+    EXPECT_THAT(graph.FindCycle("app"), IsEmpty());
+    EXPECT_THAT(graph.FindCycle("cache"), IsEmpty());
+
+    graph.Set("db", { "disk" });
+    graph.Set("disk", { "cache" });
+
+    EXPECT_THAT(graph.FindCycle("cache"),
+        ElementsAre("cache", "db", "disk", "cache"));
+    EXPECT_THAT(graph.FindCycle("app"), IsEmpty());
+
+    graph.Set("self", { "self" });
+    EXPECT_THAT(graph.FindCycle("self"), ElementsAre("self", "self"));
+}
+}  // namespace winss
@@ -35,8 +35,10 @@ class MockService : public virtual winss::Service {
         ON_CALL(*this, GetName()).WillByDefault(ReturnRef(name));
     }
 
-    explicit MockService(std::string name) :
-        winss::Service::ServiceTmpl(name) {}
+    explicit MockService(std::string name,
+        winss::LogAggregatorInterface* log_aggregator = nullptr,
+        winss::StartupSchedulerInterface* scheduler = nullptr) :
+        winss::Service::ServiceTmpl(name, log_aggregator, scheduler) {}
 
     MockService(const MockService&) = delete;
 
@@ -61,8 +63,10 @@ class NiceMockService : public NiceMock<MockService> {
  public:
     NiceMockService() {}
 
-    explicit NiceMockService(std::string name) :
-        winss::Service::ServiceTmpl(name) {}
+    explicit NiceMockService(std::string name,
+        winss::LogAggregatorInterface* log_aggregator = nullptr,
+        winss::StartupSchedulerInterface* scheduler = nullptr) :
+        winss::Service::ServiceTmpl(name, log_aggregator, scheduler) {}
 
     NiceMockService(const NiceMockService&) = delete;
 
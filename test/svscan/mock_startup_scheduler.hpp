@@ -0,0 +1,55 @@
+/*
+* Copyright 2016-2017 Morgan Stanley
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+
+#ifndef TEST_SVSCAN_MOCK_STARTUP_SCHEDULER_HPP_
+#define TEST_SVSCAN_MOCK_STARTUP_SCHEDULER_HPP_
+
+#include <functional>
+#include <vector>
+#include "gmock/gmock.h"
+#include "winss/svscan/startup_scheduler.hpp"
+
+using ::testing::_;
+using ::testing::Invoke;
+
+namespace winss {
+class MockStartupScheduler : public winss::StartupSchedulerInterface {
+ public:
+    std::vector<std::function<void()>> mock_work;
+    std::vector<std::function<void()>> mock_done;
+
+    MockStartupScheduler() {
+        auto submit = [this](std::function<void()> work,
+            std::function<void()> done) {
+            this->mock_work.push_back(work);
+            this->mock_done.push_back(done);
+        };
+        ON_CALL(*this, Submit(_, _)).WillByDefault(Invoke(submit));
+    }
+
+    MockStartupScheduler(const MockStartupScheduler&) = delete;
+    MockStartupScheduler(MockStartupScheduler&&) = delete;
+
+    MOCK_METHOD2(Submit, void(std::function<void()> work,
+        std::function<void()> done));
+
+    MockStartupScheduler& operator=(const MockStartupScheduler&) = delete;
+    MockStartupScheduler& operator=(MockStartupScheduler&&) = delete;
+};
+}  // namespace winss
+
+#endif  // TEST_SVSCAN_MOCK_STARTUP_SCHEDULER_HPP_
@@ -22,13 +22,16 @@
 #include "../mock_interface.hpp"
 #include "../mock_windows_interface.hpp"
 #include "../mock_filesystem_interface.hpp"
+#include "../log/mock_log_aggregator.hpp"
 #include "mock_service_process.hpp"
+#include "mock_startup_scheduler.hpp"
 
 namespace fs = std::experimental::filesystem;
 
 using ::testing::_;
 using ::testing::NiceMock;
 using ::testing::DoAll;
+using ::testing::SaveArg;
 using ::testing::SetArgPointee;
 using ::testing::Return;
 using ::testing::ReturnRef;
@@ -39,8 +42,11 @@ class ServiceTest : public testing::Test {
 class MockedService :
     public winss::ServiceTmpl<winss::NiceMockServiceProcess> {
  public:
-    explicit MockedService(std::string name) :
-        winss::ServiceTmpl<winss::NiceMockServiceProcess>::ServiceTmpl(name) {}
+    explicit MockedService(std::string name,
+        winss::LogAggregatorInterface* log_aggregator = nullptr,
+        winss::StartupSchedulerInterface* scheduler = nullptr) :
+        winss::ServiceTmpl<winss::NiceMockServiceProcess>::ServiceTmpl(name,
+            log_aggregator, scheduler) {}
 
     MockedService(const MockedService&) = delete;
 
@@ -124,6 +130,96 @@ TEST_F(ServiceTest, CheckLog) {
     EXPECT_TRUE(service.IsFlagged());
 }
 
+TEST_F(ServiceTest, CheckLogAggregated) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    MockInterface<winss::MockFilesystemInterface> file;
+    winss::MockLogAggregator log_aggregator;
+
+    EXPECT_CALL(*windows, CreatePipe(_, _, _, _)).Times(0);
+
+    EXPECT_CALL(*file, DirectoryExists(_))
+        .WillOnce(Return(true));
+    EXPECT_CALL(*file, FileExists(fs::path(".\\log") / fs::path("script")))
+        .WillOnce(Return(true));
+
+    EXPECT_CALL(log_aggregator, Add("test", fs::path(".\\log")))
+        .WillOnce(Return(winss::HandleWrapper(
+            reinterpret_cast<HANDLE>(20000), false)));
+    EXPECT_CALL(log_aggregator, Remove("test")).Times(1);
+
+    MockedService service("test", &log_aggregator);
+
+    winss::ServicePipes started;
+    EXPECT_CALL(*service.GetMain(), IsCreated()).WillOnce(Return(false));
+    EXPECT_CALL(*service.GetMain(), Start(_, false))
+        .WillOnce(SaveArg<0>(&started));
+    EXPECT_CALL(*service.GetLog(), Start(_, _)).Times(0);
+    fs::path log(".\\log");
+    EXPECT_CALL(*service.GetLog(), GetServiceDir())
+        .WillRepeatedly(ReturnRef(log));
+
+    service.Check();
+
+    EXPECT_TRUE(started.stdout_pipe == reinterpret_cast<HANDLE>(20000));
+    EXPECT_FALSE(started.stdin_pipe.HasHandle());
+    EXPECT_FALSE(service.Close(true));
+}
+
+TEST_F(ServiceTest, CheckScheduled) {
+    MockInterface<winss::MockFilesystemInterface> file;
+    NiceMock<winss::MockStartupScheduler> scheduler;
+
+    EXPECT_CALL(*file, DirectoryExists(_))
+        .WillOnce(Return(false));
+
+    MockedService service("test", nullptr, &scheduler);
+
+    EXPECT_CALL(scheduler, Submit(_, _)).Times(1);
+    EXPECT_CALL(*service.GetMain(), IsCreated())
+        .WillOnce(Return(false))
+        .WillOnce(Return(true));
+    EXPECT_CALL(*service.GetMain(), Start(_, _)).Times(0);
+
+    service.Check();
+    service.Check();
+    EXPECT_TRUE(service.IsFlagged());
+
+    ASSERT_EQ(1, scheduler.mock_work.size());
+    scheduler.mock_work.at(0)();
+    scheduler.mock_done.at(0)();
+
+    service.Check();
+
+    EXPECT_CALL(*service.GetMain(), Close()).Times(1);
+    EXPECT_FALSE(service.Close(true));
+}
+
+TEST_F(ServiceTest, CloseScheduled) {
+    MockInterface<winss::MockFilesystemInterface> file;
+    NiceMock<winss::MockStartupScheduler> scheduler;
+
+    EXPECT_CALL(*file, DirectoryExists(_))
+        .WillRepeatedly(Return(false));
+
+    MockedService service("test", nullptr, &scheduler);
+
+    EXPECT_CALL(scheduler, Submit(_, _)).Times(2);
+    EXPECT_CALL(*service.GetMain(), IsCreated())
+        .WillRepeatedly(Return(false));
+
+    service.Check();
+
+    EXPECT_CALL(*service.GetMain(), Close()).Times(1);
+    EXPECT_FALSE(service.Close(true));
+
+    ASSERT_EQ(1, scheduler.mock_work.size());
+    scheduler.mock_work.at(0)();
+    scheduler.mock_done.at(0)();
+
+    service.Check();
+    EXPECT_EQ(2, scheduler.mock_work.size());
+}
+
 TEST_F(ServiceTest, Reset) {
     MockedService service("test");
 
@@ -0,0 +1,147 @@
+/*
+* Copyright 2016-2017 Morgan Stanley
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include "winss/winss.hpp"
+#include "winss/handle_wrapper.hpp"
+#include "winss/not_owning_ptr.hpp"
+#include "winss/svscan/startup_scheduler.hpp"
+#include "../mock_wait_multiplexer.hpp"
+
+using ::testing::_;
+using ::testing::NiceMock;
+
+namespace winss {
+class StartupSchedulerTest : public testing::Test {
+ protected:
+    /**
+     * Waits for a counter to reach a value.
+     */
+    static bool WaitFor(const std::atomic<int>& counter, int value) {
+        for (int i = 0; i < 5000 && counter < value; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        return counter == value;
+    }
+};
+
+TEST_F(StartupSchedulerTest, Stop) {
+    NiceMock<winss::MockWaitMultiplexer> multiplexer;
+    winss::StartupScheduler scheduler(winss::NotOwned(&multiplexer), 2, 0);
+
+    ASSERT_EQ(1, multiplexer.mock_stop_callbacks.size());
+
+    std::atomic<int> worked(0);
+    int done = 0;
+    for (int i = 0; i < 3; ++i) {
+        scheduler.Submit([&worked]() { ++worked; }, [&done]() { ++done; });
+    }
+
+    EXPECT_EQ(1, multiplexer.mock_triggered_callbacks.size());
+    EXPECT_EQ(3, scheduler.Outstanding());
+    ASSERT_TRUE(WaitFor(worked, 3));
+
+    EXPECT_CALL(multiplexer, RemoveTriggeredCallback(_)).Times(1);
+
+    multiplexer.mock_stop_callbacks.at(0)(multiplexer);
+
+    EXPECT_EQ(3, done);
+    EXPECT_EQ(0, scheduler.Outstanding());
+
+    scheduler.Submit([&worked]() { ++worked; }, [&done]() { ++done; });
+
+    EXPECT_EQ(4, worked);
+    EXPECT_EQ(4, done);
+}
+
+TEST_F(StartupSchedulerTest, Complete) {
+    NiceMock<winss::MockWaitMultiplexer> multiplexer;
+    winss::StartupScheduler scheduler(winss::NotOwned(&multiplexer), 1, 0);
+
+    std::thread::id main_thread = std::this_thread::get_id();
+    std::thread::id work_thread = main_thread;
+    std::thread::id done_thread;
+
+    scheduler.Submit([&work_thread]() {
+        work_thread = std::this_thread::get_id();
+    }, [&done_thread]() {
+        done_thread = std::this_thread::get_id();
+    });
+
+    for (int i = 0; i < 5000 && scheduler.Outstanding() > 0; ++i) {
+        multiplexer.mock_triggered_callbacks.back()(multiplexer,
+            winss::HandleWrapper());
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    EXPECT_EQ(0, scheduler.Outstanding());
+    EXPECT_NE(main_thread, work_thread);
+    EXPECT_EQ(main_thread, done_thread);
+}
+
+TEST_F(StartupSchedulerTest, Concurrency) {
+    NiceMock<winss::MockWaitMultiplexer> multiplexer;
+    winss::StartupScheduler scheduler(winss::NotOwned(&multiplexer), 2, 0);
+
+    std::atomic<int> running(0);
+    std::atomic<int> most(0);
+    std::atomic<int> worked(0);
+    for (int i = 0; i < 6; ++i) {
+        scheduler.Submit([&running, &most, &worked]() {
+            int now = ++running;
+            int seen = most;
+            while (now > seen && !most.compare_exchange_weak(seen, now)) {}
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            --running;
+            ++worked;
+        }, []() {});
+    }
+
+    ASSERT_TRUE(WaitFor(worked, 6));
+    scheduler.Stop();
+
+    EXPECT_LE(most, 2);
+    EXPECT_EQ(0, scheduler.Outstanding());
+}
+
+TEST_F(StartupSchedulerTest, Rate) {
+    NiceMock<winss::MockWaitMultiplexer> multiplexer;
+    winss::StartupScheduler scheduler(winss::NotOwned(&multiplexer), 4, 20);
+
+    std::vector<std::chrono::steady_clock::time_point> started(3);
+    std::atomic<int> worked(0);
+    for (int i = 0; i < 3; ++i) {
+        scheduler.Submit([&started, &worked, i]() {
+            started[i] = std::chrono::steady_clock::now();
+            ++worked;
+        }, []() {});
+    }
+
+    ASSERT_TRUE(WaitFor(worked, 3));
+    scheduler.Stop();
+
+    std::sort(started.begin(), started.end());
+    EXPECT_GE(started[2] - started[0], std::chrono::milliseconds(90));
+}
+}  // namespace winss
@@ -15,6 +15,8 @@
 */
 
 #include <filesystem>
+#include <string>
+#include <unordered_map>
 #include <vector>
 #include "gtest/gtest.h"
 #include "gmock/gmock.h"
@@ -58,34 +60,57 @@ class HookedMockProcess : virtual public winss::NiceMockProcess {
         return *this;
     }
 };
-class MockedSvScan : public winss::SvScanTmpl<winss::NiceMockService,
-    winss::MockPathMutex, HookedMockProcess> {
+/**
+ * A mutex of a service whose supervisor is running.
+ */
+class SupervisedPathMutex : public NiceMock<winss::MockPathMutex> {
  public:
-    MockedSvScan(winss::NotOwningPtr<winss::WaitMultiplexer> multiplexer,
+    SupervisedPathMutex(fs::path path, std::string name) :
+        NiceMock<winss::MockPathMutex>(path, name) {
+        ON_CALL(*this, CanLock()).WillByDefault(Return(false));
+    }
+};
+/**
+ * A mutex of a service whose supervisor is not running.
+ */
+class UnsupervisedPathMutex : public NiceMock<winss::MockPathMutex> {
+ public:
+    UnsupervisedPathMutex(fs::path path, std::string name) :
+        NiceMock<winss::MockPathMutex>(path, name) {
+        ON_CALL(*this, CanLock()).WillByDefault(Return(true));
+    }
+};
+template<typename TMutex>
+class MockedSvScanTmpl : public winss::SvScanTmpl<winss::NiceMockService,
+    TMutex, HookedMockProcess> {
+ public:
+    MockedSvScanTmpl(winss::NotOwningPtr<winss::WaitMultiplexer> multiplexer,
         const fs::path& scan_dir, DWORD rescan, bool signals,
-        winss::EventWrapper close_event) : winss::SvScanTmpl<
-        winss::NiceMockService, winss::MockPathMutex, HookedMockProcess>
-        ::SvScanTmpl(multiplexer, scan_dir, rescan, signals, close_event) {}
+        winss::EventWrapper close_event, bool watch = false) :
+        winss::SvScanTmpl<winss::NiceMockService, TMutex,
+        HookedMockProcess>::SvScanTmpl(multiplexer, scan_dir, rescan,
+        signals, close_event, nullptr, watch) {}
 
-    MockedSvScan(const MockedSvScan&) = delete;
-    MockedSvScan(MockedSvScan&&) = delete;
+    MockedSvScanTmpl(const MockedSvScanTmpl&) = delete;
+    MockedSvScanTmpl(MockedSvScanTmpl&&) = delete;
 
     static void ReadEnv() {
         return winss::SvScanTmpl<winss::NiceMockService,
-            winss::MockPathMutex, HookedMockProcess>::ReadEnv();
+            TMutex, HookedMockProcess>::ReadEnv();
     }
 
-    std::vector<winss::NiceMockService>* GetServices() {
-        return &services;
+    std::unordered_map<std::string, winss::NiceMockService>* GetServices() {
+        return &this->services;
     }
 
-    winss::MockPathMutex* GetMutex() {
-        return &mutex;
+    TMutex* GetMutex() {
+        return &this->mutex;
     }
 
-    MockedSvScan& operator=(const MockedSvScan&) = delete;
-    MockedSvScan& operator=(MockedSvScan&&) = delete;
+    MockedSvScanTmpl& operator=(const MockedSvScanTmpl&) = delete;
+    MockedSvScanTmpl& operator=(MockedSvScanTmpl&&) = delete;
 };
+typedef MockedSvScanTmpl<winss::MockPathMutex> MockedSvScan;
 
 TEST_F(SvScanTest, Init) {
     MockInterface<winss::MockFilesystemInterface> file;
@@ -216,12 +241,244 @@ TEST_F(SvScanTest, ReScan) {
 
     ASSERT_EQ(2, svscan.GetServices()->size());
 
-    EXPECT_CALL(svscan.GetServices()->at(0), Check()).Times(1);
-    EXPECT_CALL(svscan.GetServices()->at(1), Check()).Times(1);
+    EXPECT_CALL(svscan.GetServices()->at("test1"), Check()).Times(1);
+    EXPECT_CALL(svscan.GetServices()->at("test2"), Check()).Times(1);
+
+    multiplexer.mock_timeout_callbacks.at(0)(multiplexer);
+
+    EXPECT_EQ(3, svscan.GetServices()->size());
+}
+
+TEST_F(SvScanTest, IncrementalScan) {
+    MockInterface<winss::MockFilesystemInterface> file;
+    NiceMock<winss::MockWaitMultiplexer> multiplexer;
+    winss::EventWrapper close_event;
+    MockedSvScan svscan(winss::NotOwned(&multiplexer), ".", 0, false,
+        close_event);
+
+    EXPECT_CALL(*file, GetDirectories(_))
+        .WillOnce(Return(std::vector<fs::path>({ "test1", "test2" })))
+        .WillOnce(Return(std::vector<fs::path>({ "test1", "test2",
+            "test3" })))
+        .WillOnce(Return(std::vector<fs::path>({ "test2", "test3" })))
+        .WillOnce(Return(std::vector<fs::path>({ "test2", "test3" })));
+
+    EXPECT_CALL(*file, LastWriteTime(fs::path("test1")))
+        .WillRepeatedly(Return(1));
+    EXPECT_CALL(*file, LastWriteTime(fs::path("test2")))
+        .WillOnce(Return(1))
+        .WillRepeatedly(Return(2));
+    EXPECT_CALL(*file, LastWriteTime(fs::path("test3")))
+        .WillRepeatedly(Return(1));
+
+    EXPECT_CALL(*svscan.GetMutex(), HasLock())
+        .WillRepeatedly(Return(true));
+
+    svscan.Scan(false);
+
+    ASSERT_EQ(2, svscan.GetServices()->size());
+
+    // The supervisor of an unchanged service is still checked.
+    EXPECT_CALL(svscan.GetServices()->at("test1"), Check()).Times(1);
+    EXPECT_CALL(svscan.GetServices()->at("test2"), Check()).Times(1);
+
+    svscan.Scan(false);
+
+    ASSERT_EQ(3, svscan.GetServices()->size());
+
+    EXPECT_CALL(svscan.GetServices()->at("test1"), Reset()).Times(1);
+    EXPECT_CALL(svscan.GetServices()->at("test1"), Check()).Times(0);
+    EXPECT_CALL(svscan.GetServices()->at("test2"), Reset()).Times(0);
+    EXPECT_CALL(svscan.GetServices()->at("test2"), Check()).Times(1);
+    EXPECT_CALL(svscan.GetServices()->at("test3"), Reset()).Times(0);
+    EXPECT_CALL(svscan.GetServices()->at("test3"), Check()).Times(1);
+
+    svscan.Scan(false);
+
+    EXPECT_CALL(svscan.GetServices()->at("test2"), Check()).Times(1);
+    EXPECT_CALL(svscan.GetServices()->at("test3"), Check()).Times(1);
+
+    svscan.Scan(true);
+
+    EXPECT_CALL(svscan.GetServices()->at("test1"), Close(false))
+        .WillOnce(Return(false));
+
+    svscan.CloseAllServices(false);
+
+    EXPECT_EQ(2, svscan.GetServices()->size());
+}
+
+TEST_F(SvScanTest, Dependencies) {
+    MockInterface<winss::MockFilesystemInterface> file;
+    NiceMock<winss::MockWaitMultiplexer> multiplexer;
+    winss::EventWrapper close_event;
+    MockedSvScanTmpl<SupervisedPathMutex> svscan(winss::NotOwned(&multiplexer),
+        ".", 0, false, close_event);
+
+    EXPECT_CALL(*file, GetDirectories(_))
+        .WillOnce(Return(std::vector<fs::path>({ "test1", "test2" })));
+
+    EXPECT_CALL(*file, Read(_)).WillRepeatedly(Return(""));
+    EXPECT_CALL(*file, Read(fs::path("test2") / fs::path("dependencies")))
+        .WillRepeatedly(Return(" test1 \r\n\n"));
+    EXPECT_CALL(*file, Read(fs::path("test1") / fs::path("supervise") /
+        fs::path("state")))
+        .WillOnce(Return("{\"proc\":\"run\",\"state\":\"down\"}"))
+        .WillOnce(Return("{\"proc\":\"run\",\"state\":\"up\"}"));
+
+    EXPECT_CALL(*svscan.GetMutex(), HasLock())
+        .WillRepeatedly(Return(true));
+
+    svscan.Scan(false);
+
+    EXPECT_EQ(1, svscan.GetServices()->size());
+    EXPECT_EQ(1, svscan.GetServices()->count("test1"));
+    ASSERT_EQ(1, multiplexer.mock_timeout_callbacks.size());
+
+    multiplexer.mock_timeout_callbacks.at(0)(multiplexer);
+
+    EXPECT_EQ(1, svscan.GetServices()->size());
+    ASSERT_EQ(2, multiplexer.mock_timeout_callbacks.size());
+
+    multiplexer.mock_timeout_callbacks.at(1)(multiplexer);
+
+    EXPECT_EQ(2, svscan.GetServices()->size());
+    EXPECT_EQ(1, svscan.GetServices()->count("test2"));
+    EXPECT_EQ(2, multiplexer.mock_timeout_callbacks.size());
+}
+
+TEST_F(SvScanTest, DependenciesEdited) {
+    MockInterface<winss::MockFilesystemInterface> file;
+    NiceMock<winss::MockWaitMultiplexer> multiplexer;
+    winss::EventWrapper close_event;
+    MockedSvScanTmpl<UnsupervisedPathMutex> svscan(
+        winss::NotOwned(&multiplexer), ".", 0, false, close_event);
+
+    fs::path dependencies = fs::path("test2") / fs::path("dependencies");
+
+    EXPECT_CALL(*file, GetDirectories(_))
+        .WillRepeatedly(Return(std::vector<fs::path>({ "test1", "test2" })));
+
+    // Editing the file leaves the write time of the directory alone.
+    EXPECT_CALL(*file, LastWriteTime(_)).WillRepeatedly(Return(1));
+    EXPECT_CALL(*file, FileExists(_)).WillRepeatedly(Return(false));
+    EXPECT_CALL(*file, FileExists(dependencies)).WillRepeatedly(Return(true));
+    EXPECT_CALL(*file, LastWriteTime(dependencies))
+        .WillOnce(Return(1))
+        .WillRepeatedly(Return(2));
+
+    EXPECT_CALL(*file, Read(_)).WillRepeatedly(Return(""));
+    EXPECT_CALL(*file, Read(dependencies))
+        .WillOnce(Return("test1"))
+        .WillRepeatedly(Return(""));
+
+    EXPECT_CALL(*svscan.GetMutex(), HasLock())
+        .WillRepeatedly(Return(true));
+
+    svscan.Scan(false);
+
+    EXPECT_EQ(1, svscan.GetServices()->size());
+    EXPECT_EQ(1, svscan.GetServices()->count("test1"));
+
+    svscan.Scan(false);
+
+    EXPECT_EQ(2, svscan.GetServices()->size());
+    EXPECT_EQ(1, svscan.GetServices()->count("test2"));
+}
+
+TEST_F(SvScanTest, DependencyUnknown) {
+    MockInterface<winss::MockFilesystemInterface> file;
+    NiceMock<winss::MockWaitMultiplexer> multiplexer;
+    winss::EventWrapper close_event;
+    MockedSvScanTmpl<SupervisedPathMutex> svscan(winss::NotOwned(&multiplexer),
+        ".", 0, false, close_event);
+
+    EXPECT_CALL(*file, GetDirectories(_))
+        .WillOnce(Return(std::vector<fs::path>({ "test1", "test2",
+            "test3" })))
+        .WillOnce(Return(std::vector<fs::path>({ "test2", "test3" })));
+
+    EXPECT_CALL(*file, Read(_)).WillRepeatedly(Return(""));
+    EXPECT_CALL(*file, Read(fs::path("test2") / fs::path("dependencies")))
+        .WillRepeatedly(Return("test1"));
+    EXPECT_CALL(*file, Read(fs::path("test3") / fs::path("dependencies")))
+        .WillRepeatedly(Return("missing"));
 
+    EXPECT_CALL(*svscan.GetMutex(), HasLock())
+        .WillRepeatedly(Return(true));
+
+    svscan.Scan(false);
+
+    EXPECT_EQ(2, svscan.GetServices()->size());
+    EXPECT_EQ(1, svscan.GetServices()->count("test1"));
+    EXPECT_EQ(1, svscan.GetServices()->count("test3"));
+    ASSERT_EQ(1, multiplexer.mock_timeout_callbacks.size());
+
+    svscan.Scan(false);
     multiplexer.mock_timeout_callbacks.at(0)(multiplexer);
 
     EXPECT_EQ(3, svscan.GetServices()->size());
+    EXPECT_EQ(1, svscan.GetServices()->count("test2"));
+    EXPECT_EQ(1, multiplexer.mock_timeout_callbacks.size());
+}
+
+TEST_F(SvScanTest, DependencyStaleState) {
+    MockInterface<winss::MockFilesystemInterface> file;
+    NiceMock<winss::MockWaitMultiplexer> multiplexer;
+    winss::EventWrapper close_event;
+    MockedSvScanTmpl<UnsupervisedPathMutex> svscan(
+        winss::NotOwned(&multiplexer), ".", 0, false, close_event);
+
+    EXPECT_CALL(*file, GetDirectories(_))
+        .WillOnce(Return(std::vector<fs::path>({ "test1", "test2" })));
+
+    EXPECT_CALL(*file, Read(_)).WillRepeatedly(Return(""));
+    EXPECT_CALL(*file, Read(fs::path("test2") / fs::path("dependencies")))
+        .WillRepeatedly(Return("test1"));
+
+    // The state was left behind by a supervisor which is not running.
+    EXPECT_CALL(*file, Read(fs::path("test1") / fs::path("supervise") /
+        fs::path("state")))
+        .WillRepeatedly(Return("{\"proc\":\"run\",\"state\":\"up\"}"));
+
+    EXPECT_CALL(*svscan.GetMutex(), HasLock())
+        .WillRepeatedly(Return(true));
+
+    svscan.Scan(false);
+
+    EXPECT_EQ(1, svscan.GetServices()->size());
+    EXPECT_EQ(1, svscan.GetServices()->count("test1"));
+    ASSERT_EQ(1, multiplexer.mock_timeout_callbacks.size());
+
+    multiplexer.mock_timeout_callbacks.at(0)(multiplexer);
+
+    EXPECT_EQ(1, svscan.GetServices()->size());
+    EXPECT_EQ(0, svscan.GetServices()->count("test2"));
+}
+
+TEST_F(SvScanTest, DependencyCycle) {
+    MockInterface<winss::MockFilesystemInterface> file;
+    NiceMock<winss::MockWaitMultiplexer> multiplexer;
+    winss::EventWrapper close_event;
+    MockedSvScan svscan(winss::NotOwned(&multiplexer), ".", 0, false,
+        close_event);
+
+    EXPECT_CALL(*file, GetDirectories(_))
+        .WillOnce(Return(std::vector<fs::path>({ "test1", "test2" })));
+
+    EXPECT_CALL(*file, Read(_)).WillRepeatedly(Return(""));
+    EXPECT_CALL(*file, Read(fs::path("test1") / fs::path("dependencies")))
+        .WillRepeatedly(Return("test2"));
+    EXPECT_CALL(*file, Read(fs::path("test2") / fs::path("dependencies")))
+        .WillRepeatedly(Return("test1"));
+
+    EXPECT_CALL(*svscan.GetMutex(), HasLock())
+        .WillRepeatedly(Return(true));
+
+    svscan.Scan(false);
+
+    EXPECT_EQ(1, svscan.GetServices()->size());
+    EXPECT_EQ(1, svscan.GetServices()->count("test2"));
 }
 
 TEST_F(SvScanTest, CloseAllServices) {
@@ -233,7 +490,9 @@ TEST_F(SvScanTest, CloseAllServices) {
 
     EXPECT_CALL(*file, GetDirectories(_))
         .WillOnce(Return(std::vector<fs::path>({ ".", "..", ".hidden",
-            "test1", "test2" })));
+            "test1", "test2" })))
+        .WillOnce(Return(std::vector<fs::path>({ ".", "..", ".hidden",
+            "test1" })));
 
     EXPECT_CALL(*svscan.GetMutex(), HasLock())
         .WillRepeatedly(Return(true));
@@ -242,16 +501,21 @@ TEST_F(SvScanTest, CloseAllServices) {
 
     ASSERT_EQ(2, svscan.GetServices()->size());
 
-    EXPECT_CALL(svscan.GetServices()->at(0), Close(false))
-        .WillOnce(Return(true));
-    EXPECT_CALL(svscan.GetServices()->at(1), Close(false))
+    EXPECT_CALL(svscan.GetServices()->at("test2"), Reset()).Times(1);
+
+    svscan.Scan(false);
+
+    ASSERT_EQ(2, svscan.GetServices()->size());
+
+    EXPECT_CALL(svscan.GetServices()->at("test1"), Close(false)).Times(0);
+    EXPECT_CALL(svscan.GetServices()->at("test2"), Close(false))
         .WillOnce(Return(false));
 
     svscan.CloseAllServices(false);
 
     EXPECT_EQ(1, svscan.GetServices()->size());
 
-    EXPECT_CALL(svscan.GetServices()->at(0), Close(true))
+    EXPECT_CALL(svscan.GetServices()->at("test1"), Close(true))
         .WillOnce(Return(false));
 
     multiplexer.mock_stop_callbacks.at(0)(multiplexer);
@@ -307,4 +571,78 @@ TEST_F(SvScanTest, SignalsNotDiverted) {
     multiplexer.mock_triggered_callbacks.at(0)(multiplexer,
         close_event.GetHandle());
 }
+
+TEST_F(SvScanTest, Watch) {
+    MockInterface<winss::MockFilesystemInterface> file;
+    MockInterface<winss::MockWindowsInterface> windows;
+    NiceMock<winss::MockWaitMultiplexer> multiplexer;
+    winss::EventWrapper close_event;
+    MockedSvScan svscan(winss::NotOwned(&multiplexer), ".", 60000, false,
+        close_event, true);
+
+    HANDLE change = reinterpret_cast<HANDLE>(5000);
+
+    EXPECT_CALL(*file, ChangeDirectory(_)).WillOnce(Return(true));
+    EXPECT_CALL(*file, GetDirectories(_))
+        .WillOnce(Return(std::vector<fs::path>({ "test1" })))
+        .WillOnce(Return(std::vector<fs::path>({ "test1", "test2" })));
+    EXPECT_CALL(*svscan.GetMutex(), HasLock())
+        .WillOnce(Return(false))
+        .WillRepeatedly(Return(true));
+    EXPECT_CALL(*svscan.GetMutex(), Lock()).WillOnce(Return(true));
+
+    EXPECT_CALL(*windows, FindFirstChangeNotification(_, false,
+        FILE_NOTIFY_CHANGE_DIR_NAME)).WillOnce(Return(change));
+    EXPECT_CALL(*windows, FindNextChangeNotification(change))
+        .Times(2)
+        .WillRepeatedly(Return(true));
+
+    multiplexer.mock_init_callbacks.at(0)(multiplexer);
+
+    ASSERT_EQ(1, svscan.GetServices()->size());
+    ASSERT_EQ(2, multiplexer.mock_triggered_callbacks.size());
+    ASSERT_EQ(1, multiplexer.mock_timeout_callbacks.size());
+
+    multiplexer.mock_triggered_callbacks.at(1)(multiplexer,
+        winss::HandleWrapper(change, false));
+    multiplexer.mock_triggered_callbacks.at(2)(multiplexer,
+        winss::HandleWrapper(change, false));
+
+    EXPECT_EQ(4, multiplexer.mock_triggered_callbacks.size());
+    ASSERT_EQ(2, multiplexer.mock_timeout_callbacks.size());
+
+    multiplexer.mock_timeout_callbacks.at(1)(multiplexer);
+
+    EXPECT_EQ(2, svscan.GetServices()->size());
+
+    EXPECT_CALL(multiplexer, RemoveTriggeredCallback(_)).Times(2);
+    EXPECT_CALL(*windows, FindCloseChangeNotification(change))
+        .WillOnce(Return(true));
+
+    multiplexer.mock_stop_callbacks.at(0)(multiplexer);
+}
+
+TEST_F(SvScanTest, WatchFailed) {
+    MockInterface<winss::MockFilesystemInterface> file;
+    MockInterface<winss::MockWindowsInterface> windows;
+    NiceMock<winss::MockWaitMultiplexer> multiplexer;
+    winss::EventWrapper close_event;
+    MockedSvScan svscan(winss::NotOwned(&multiplexer), ".", 60000, false,
+        close_event, true);
+
+    EXPECT_CALL(*file, ChangeDirectory(_)).WillOnce(Return(true));
+    EXPECT_CALL(*svscan.GetMutex(), HasLock())
+        .WillOnce(Return(false))
+        .WillRepeatedly(Return(true));
+    EXPECT_CALL(*svscan.GetMutex(), Lock()).WillOnce(Return(true));
+
+    EXPECT_CALL(*windows, FindFirstChangeNotification(_, _, _))
+        .WillOnce(Return(INVALID_HANDLE_VALUE));
+    EXPECT_CALL(*windows, FindCloseChangeNotification(_)).Times(0);
+
+    multiplexer.mock_init_callbacks.at(0)(multiplexer);
+
+    EXPECT_EQ(1, multiplexer.mock_triggered_callbacks.size());
+    EXPECT_EQ(1, multiplexer.mock_timeout_callbacks.size());
+}
 }  // namespace winss
@@ -17,6 +17,9 @@
 #include <chrono>
 #include <thread>
 #include <functional>
+#include <set>
+#include <utility>
+#include <vector>
 #include "gtest/gtest.h"
 #include "gmock/gmock.h"
 #include "winss/winss.hpp"
@@ -29,6 +32,7 @@
 using ::testing::_;
 using ::testing::NiceMock;
 using ::testing::Return;
+using ::testing::Invoke;
 using ::testing::InvokeWithoutArgs;
 
 namespace winss {
@@ -36,16 +40,77 @@ class WaitMultiplexerTest : public testing::Test {
 };
 
 TEST_F(WaitMultiplexerTest, WaitTimeoutItemOrdering) {
-    auto now = std::chrono::system_clock::now();
+    auto now = std::chrono::steady_clock::now();
     auto later = now + std::chrono::milliseconds(5000);
 
     auto callback1 = [](winss::WaitMultiplexer&) {};
     auto callback2 = [](winss::WaitMultiplexer&) {};
 
-    winss::WaitTimeoutItem item1({ "", now, callback1 });
-    winss::WaitTimeoutItem item2({ "", later, callback2 });
+    winss::WaitTimeoutItem item1({ "", now, callback1, 2 });
+    winss::WaitTimeoutItem item2({ "", later, callback2, 1 });
+    winss::WaitTimeoutItem item3({ "", now, callback2, 3 });
 
     EXPECT_LT(item1, item2);
+    EXPECT_LT(item1, item3);
+    EXPECT_FALSE(item3 < item1);
+}
+
+TEST_F(WaitMultiplexerTest, WaitTimeoutHeapOrdering) {
+    winss::WaitTimeoutHeap heap;
+    auto now = std::chrono::steady_clock::now();
+    std::vector<int> order;
+
+    auto make_callback = [&order](int value) {
+        return [&order, value](winss::WaitMultiplexer&) {
+            order.push_back(value);
+        };
+    };
+
+    heap.Add("", now + std::chrono::milliseconds(30), make_callback(3));
+    heap.Add("", now + std::chrono::milliseconds(10), make_callback(1));
+    heap.Add("", now + std::chrono::milliseconds(10), make_callback(2));
+    heap.Add("", now + std::chrono::milliseconds(50), make_callback(5));
+    heap.Add("", now + std::chrono::milliseconds(40), make_callback(4));
+    EXPECT_EQ(5, heap.Size());
+
+    winss::WaitMultiplexer multiplexer;
+    while (!heap.Empty()) {
+        heap.Pop()(multiplexer);
+    }
+
+    EXPECT_EQ(std::vector<int>({ 1, 2, 3, 4, 5 }), order);
+    EXPECT_FALSE(heap.Pop());
+}
+
+TEST_F(WaitMultiplexerTest, WaitTimeoutHeapRemove) {
+    winss::WaitTimeoutHeap heap;
+    auto now = std::chrono::steady_clock::now();
+    auto callback = [](winss::WaitMultiplexer&) {};
+
+    std::vector<winss::TimeoutId> ids;
+    for (int i = 0; i < 20; ++i) {
+        ids.push_back(heap.Add(i % 2 ? "odd" : "even",
+            now + std::chrono::milliseconds((i * 7) % 20), callback));
+    }
+
+    EXPECT_TRUE(heap.Remove(ids[4]));
+    EXPECT_FALSE(heap.Remove(ids[4]));
+    EXPECT_EQ(19, heap.Size());
+
+    EXPECT_TRUE(heap.RemoveGroup("odd"));
+    EXPECT_FALSE(heap.RemoveGroup("odd"));
+    EXPECT_FALSE(heap.Remove(ids[5]));
+    EXPECT_EQ(9, heap.Size());
+
+    auto last = heap.Top().timeout;
+    while (!heap.Empty()) {
+        EXPECT_LE(last, heap.Top().timeout);
+        EXPECT_EQ("even", heap.Top().group);
+        last = heap.Top().timeout;
+        heap.Pop();
+    }
+
+    EXPECT_FALSE(heap.RemoveGroup("even"));
 }
 
 TEST_F(WaitMultiplexerTest, RemoveTriggered) {
@@ -65,6 +130,75 @@ TEST_F(WaitMultiplexerTest, RemoveTriggered) {
     EXPECT_FALSE(multiplexer.RemoveTriggeredCallback(handle1));
 }
 
+TEST_F(WaitMultiplexerTest, AddTriggeredTwice) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    winss::WaitMultiplexer multiplexer;
+
+    EXPECT_CALL(*windows, WaitForMultipleObjects(1, _, _, _))
+        .WillOnce(Return(WAIT_OBJECT_0));
+
+    winss::HandleWrapper handle(reinterpret_cast<HANDLE>(10000), false);
+
+    int first = 0;
+    auto callback1 = [&first](winss::WaitMultiplexer&,
+        const winss::HandleWrapper&) {
+        first++;
+    };
+    int second = 0;
+    auto callback2 = [&second](winss::WaitMultiplexer&,
+        const winss::HandleWrapper&) {
+        second++;
+    };
+
+    multiplexer.AddTriggeredCallback(handle, callback1);
+    multiplexer.AddTriggeredCallback(handle, callback2);
+
+    EXPECT_EQ(0, multiplexer.Start());
+    EXPECT_EQ(1, first);
+    EXPECT_EQ(0, second);
+}
+
+TEST_F(WaitMultiplexerTest, RemoveTriggeredMovesLast) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    winss::WaitMultiplexer multiplexer;
+
+    HANDLE handle3 = reinterpret_cast<HANDLE>(30000);
+
+    EXPECT_CALL(*windows, WaitForMultipleObjects(2, _, _, _))
+        .WillOnce(Invoke([handle3](DWORD, const HANDLE* handles, bool,
+            DWORD) {
+        EXPECT_EQ(handle3, handles[0]);
+        return WAIT_OBJECT_0;
+    }));
+    EXPECT_CALL(*windows, WaitForMultipleObjects(1, _, _, _))
+        .WillOnce(Return(WAIT_FAILED));
+
+    winss::HandleWrapper wrapper1(reinterpret_cast<HANDLE>(10000), false);
+    winss::HandleWrapper wrapper2(reinterpret_cast<HANDLE>(20000), false);
+    winss::HandleWrapper wrapper3(handle3, false);
+
+    int triggered = 0;
+    auto callback = [](winss::WaitMultiplexer&,
+        const winss::HandleWrapper&) {
+        ADD_FAILURE();
+    };
+    auto callback3 = [&triggered, handle3](winss::WaitMultiplexer&,
+        const winss::HandleWrapper& handle) {
+        EXPECT_TRUE(handle3 == handle);
+        triggered++;
+    };
+
+    multiplexer.AddTriggeredCallback(wrapper1, callback);
+    multiplexer.AddTriggeredCallback(wrapper2, callback);
+    multiplexer.AddTriggeredCallback(wrapper3, callback3);
+    EXPECT_TRUE(multiplexer.RemoveTriggeredCallback(wrapper1));
+
+    EXPECT_EQ(0, multiplexer.Start());
+    EXPECT_EQ(1, triggered);
+    EXPECT_TRUE(multiplexer.RemoveTriggeredCallback(wrapper2));
+    EXPECT_FALSE(multiplexer.RemoveTriggeredCallback(wrapper3));
+}
+
 TEST_F(WaitMultiplexerTest, RemoveTimeout) {
     winss::WaitMultiplexer multiplexer;
 
@@ -131,6 +265,169 @@ TEST_F(WaitMultiplexerTest, Start) {
     EXPECT_EQ(1, triggered);
 }
 
+TEST_F(WaitMultiplexerTest, StartMoreThanMaximumWaitObjects) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    windows->SetupDefaults();
+    winss::WaitMultiplexer multiplexer;
+
+    HANDLE target = reinterpret_cast<HANDLE>(10150);
+
+    EXPECT_CALL(*windows, WaitForMultipleObjects(_, _, _, _))
+        .WillRepeatedly(Invoke([target](DWORD handles_count, const HANDLE* h,
+            bool, DWORD) {
+        EXPECT_GE(static_cast<DWORD>(MAXIMUM_WAIT_OBJECTS), handles_count);
+
+        for (DWORD i = 0; i < handles_count; ++i) {
+            if (h[i] == target) {
+                return WAIT_OBJECT_0 + i;
+            }
+        }
+
+        return static_cast<DWORD>(WAIT_FAILED);
+    }));
+
+    int triggered = 0;
+    auto callback = [&triggered, target](winss::WaitMultiplexer&,
+        const winss::HandleWrapper& handle) {
+        EXPECT_TRUE(target == handle);
+        triggered++;
+    };
+
+    for (int i = 0; i < 200; ++i) {
+        HANDLE handle = reinterpret_cast<HANDLE>(10000 + i);
+        multiplexer.AddTriggeredCallback(
+            winss::HandleWrapper(handle, false), callback);
+    }
+
+    EXPECT_EQ(0, multiplexer.Start());
+    EXPECT_EQ(1, triggered);
+}
+
+TEST_F(WaitMultiplexerTest, StartFairDispatch) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    winss::WaitMultiplexer multiplexer;
+    multiplexer.SetDispatchMode(DISPATCH_FAIR);
+
+    HANDLE busy = reinterpret_cast<HANDLE>(10000);
+    std::vector<HANDLE> handles = {
+        busy,
+        reinterpret_cast<HANDLE>(20000),
+        reinterpret_cast<HANDLE>(30000),
+        reinterpret_cast<HANDLE>(40000),
+        reinterpret_cast<HANDLE>(50000)
+    };
+    std::set<HANDLE> signalled = { handles[0], handles[2], handles[4] };
+
+    int cycle = 0;
+    EXPECT_CALL(*windows, WaitForMultipleObjects(_, _, _, _))
+        .WillRepeatedly(Invoke([&](DWORD handles_count, const HANDLE* h,
+            bool, DWORD timeout) {
+        if (timeout != 0) {
+            cycle++;
+        }
+
+        for (DWORD i = 0; i < handles_count; ++i) {
+            if (signalled.count(h[i])) {
+                return WAIT_OBJECT_0 + i;
+            }
+        }
+
+        return static_cast<DWORD>(timeout == 0 ? WAIT_TIMEOUT : WAIT_FAILED);
+    }));
+
+    std::vector<std::pair<int, HANDLE>> served;
+    int busy_count = 0;
+    winss::TriggeredCallback callback = [&](winss::WaitMultiplexer& m,
+        const winss::HandleWrapper& handle) {
+        for (HANDLE h : handles) {
+            if (h == handle) {
+                served.emplace_back(cycle, h);
+                if (h == busy && ++busy_count < 2) {
+                    m.AddTriggeredCallback(handle, callback);
+                } else {
+                    signalled.erase(h);
+                }
+            }
+        }
+    };
+
+    for (HANDLE h : handles) {
+        multiplexer.AddTriggeredCallback(winss::HandleWrapper(h, false),
+            callback);
+    }
+
+    EXPECT_EQ(0, multiplexer.Start());
+
+    ASSERT_EQ(4, served.size());
+    EXPECT_EQ(std::make_pair(1, busy), served[0]);
+    EXPECT_EQ(1, served[1].first);
+    EXPECT_EQ(1, served[2].first);
+    EXPECT_NE(served[1].second, served[2].second);
+    EXPECT_NE(busy, served[1].second);
+    EXPECT_NE(busy, served[2].second);
+    EXPECT_EQ(std::make_pair(2, busy), served[3]);
+}
+
+TEST_F(WaitMultiplexerTest, StartBatchDispatch) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    winss::WaitMultiplexer multiplexer;
+    multiplexer.SetDispatchMode(DISPATCH_BATCH);
+
+    std::vector<HANDLE> handles = {
+        reinterpret_cast<HANDLE>(10000),
+        reinterpret_cast<HANDLE>(20000),
+        reinterpret_cast<HANDLE>(30000),
+        reinterpret_cast<HANDLE>(40000),
+        reinterpret_cast<HANDLE>(50000)
+    };
+    std::set<HANDLE> signalled = { handles[1], handles[2], handles[4] };
+
+    int cycle = 0;
+    int polls = 0;
+    EXPECT_CALL(*windows, WaitForMultipleObjects(_, _, _, _))
+        .WillRepeatedly(Invoke([&](DWORD handles_count, const HANDLE* h,
+            bool, DWORD timeout) {
+        if (timeout != 0) {
+            cycle++;
+        } else {
+            polls++;
+        }
+
+        for (DWORD i = 0; i < handles_count; ++i) {
+            if (signalled.count(h[i])) {
+                return WAIT_OBJECT_0 + i;
+            }
+        }
+
+        return static_cast<DWORD>(timeout == 0 ? WAIT_TIMEOUT : WAIT_FAILED);
+    }));
+
+    std::vector<std::pair<int, HANDLE>> served;
+    winss::TriggeredCallback callback = [&](winss::WaitMultiplexer& m,
+        const winss::HandleWrapper& handle) {
+        for (HANDLE h : handles) {
+            if (h == handle) {
+                served.emplace_back(cycle, h);
+                signalled.erase(h);
+            }
+        }
+    };
+
+    for (HANDLE h : handles) {
+        multiplexer.AddTriggeredCallback(winss::HandleWrapper(h, false),
+            callback);
+    }
+
+    EXPECT_EQ(0, multiplexer.Start());
+
+    ASSERT_EQ(3, served.size());
+    EXPECT_EQ(std::make_pair(1, handles[1]), served[0]);
+    EXPECT_EQ(std::make_pair(1, handles[2]), served[1]);
+    EXPECT_EQ(std::make_pair(1, handles[4]), served[2]);
+    EXPECT_EQ(2, polls);
+    EXPECT_EQ(2, cycle);
+}
+
 TEST_F(WaitMultiplexerTest, StartTimeoutEmpty) {
     MockInterface<winss::MockWindowsInterface> windows;
     winss::WaitMultiplexer multiplexer;
@@ -161,6 +458,37 @@ TEST_F(WaitMultiplexerTest, StartTimeoutEmpty) {
     EXPECT_EQ(1, triggered);
 }
 
+TEST_F(WaitMultiplexerTest, StartTimeoutSameTick) {
+    MockInterface<winss::MockWindowsInterface> windows;
+    winss::WaitMultiplexer multiplexer;
+
+    EXPECT_CALL(*windows, WaitForMultipleObjects(_, _, _, INFINITE))
+        .WillOnce(Return(WAIT_FAILED));
+
+    std::vector<int> order;
+    multiplexer.AddTimeoutCallback(0, [&order](winss::WaitMultiplexer&) {
+        order.push_back(1);
+    });
+    multiplexer.AddTimeoutCallback(0, [&order](winss::WaitMultiplexer&) {
+        order.push_back(2);
+    });
+    auto id = multiplexer.AddTimeoutCallback(0,
+        [&order](winss::WaitMultiplexer&) {
+        order.push_back(3);
+    });
+
+    EXPECT_NE(0, id);
+    EXPECT_TRUE(multiplexer.RemoveTimeoutCallbackById(id));
+    EXPECT_FALSE(multiplexer.RemoveTimeoutCallbackById(id));
+
+    multiplexer.AddTriggeredCallback(
+        winss::HandleWrapper(reinterpret_cast<HANDLE>(10000), false),
+        [](winss::WaitMultiplexer&, const winss::HandleWrapper&) {});
+
+    EXPECT_EQ(0, multiplexer.Start());
+    EXPECT_EQ(std::vector<int>({ 1, 2 }), order);
+}
+
 TEST_F(WaitMultiplexerTest, StartTimeout) {
     MockInterface<winss::MockWindowsInterface> windows;
     winss::WaitMultiplexer multiplexer;
@@ -7,7 +7,7 @@ if ($args[0])
 }
 else
 {
-    $items = @("$srcDir\bin", "$srcDir\lib\winss", "$srcDir\test")
+    $items = @("$srcDir\bin", "$srcDir\lib\winss", "$srcDir\test", "$srcDir\benchmark")
 }
 
 Remove-Item build\lint.txt -ErrorAction Ignore